@@ -0,0 +1,37 @@
+#include <iostream>
+#include <limits>
+#include "aggregateavl.h"
+
+using namespace std;
+
+// keeps the larger of two values
+struct MaxOf
+{
+    int operator()(int a, int b) const { return (a < b) ? b : a; }
+};
+
+
+int main(int argc, char *argv[])
+{
+    // Aggregate AVL Tree tests: bytes sent per second
+    AggregateAVLTree<int,long> bytes;
+    for(int t = 0; t < 100; t++) {
+        bytes.insert(std::make_pair(t, (long)(t % 10) * 100));
+    }
+    cout << "Bytes in [10, 20): " << bytes.aggregate(10, 20) << endl;
+    cout << "Bytes in total: " << bytes.aggregate() << endl;
+    bytes.remove(15);
+    bytes.insert(std::make_pair(11, 5000L));
+    cout << "Bytes in [10, 20) after updates: " << bytes.aggregate(10, 20) << endl;
+
+    // worst latency per range of request ids
+    AggregateAVLTree<int,int,MaxOf> latency(numeric_limits<int>::min());
+    latency.insert(std::make_pair(1, 30));
+    latency.insert(std::make_pair(2, 250));
+    latency.insert(std::make_pair(3, 40));
+    latency.insert(std::make_pair(7, 90));
+    cout << "Max latency in [1, 3): " << latency.aggregate(1, 3) << endl;
+    cout << "Max latency in [3, 10): " << latency.aggregate(3, 10) << endl;
+
+    return 0;
+}
@@ -0,0 +1,256 @@
+#ifndef AGGREGATEAVL_H
+#define AGGREGATEAVL_H
+
+#include <iostream>
+#include <exception>
+#include <functional>
+#include <utility>
+#include <cstdlib>
+#include <cstdint>
+#include "avlbst.h"
+
+/**
+* An AVL node that also stores Combine folded over the values of its
+* subtree, in key order. Combine must be associative and default
+* constructible (std::plus, or a small functor struct).
+*/
+template <typename Key, typename Value, typename Combine>
+class AggregateAVLNode : public AVLNode<Key, Value>
+{
+public:
+    AggregateAVLNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent);
+    virtual ~AggregateAVLNode();
+
+    const Value& getAggregate() const;
+    virtual bool refreshAggregate();
+    virtual void swapAggregate(AVLNode<Key, Value>* other);
+
+protected:
+    Value aggregate_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the AggregateAVLNode class.
+  -------------------------------------------------
+*/
+
+/**
+* An explicit constructor; a new node is a leaf, so its aggregate is its
+* own value.
+*/
+template<class Key, class Value, class Combine>
+AggregateAVLNode<Key, Value, Combine>::AggregateAVLNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent) :
+    AVLNode<Key, Value>(key, value, parent), aggregate_(value)
+{
+
+}
+
+/**
+* A destructor which does nothing.
+*/
+template<class Key, class Value, class Combine>
+AggregateAVLNode<Key, Value, Combine>::~AggregateAVLNode()
+{
+
+}
+
+/**
+* A getter for the aggregate of the subtree rooted here.
+*/
+template<class Key, class Value, class Combine>
+const Value& AggregateAVLNode<Key, Value, Combine>::getAggregate() const
+{
+    return aggregate_;
+}
+
+/**
+* Recomputes the aggregate from the value and the children's aggregates,
+* which must already be up to date.
+*/
+template<class Key, class Value, class Combine>
+bool AggregateAVLNode<Key, Value, Combine>::refreshAggregate()
+{
+    Combine combine;
+    AggregateAVLNode<Key, Value, Combine>* left = static_cast<AggregateAVLNode<Key, Value, Combine>*>(this->children_[0]);
+    AggregateAVLNode<Key, Value, Combine>* right = static_cast<AggregateAVLNode<Key, Value, Combine>*>(this->children_[1]);
+    if(left != NULL){
+      aggregate_ = combine(left->aggregate_, this->getValue());
+    }
+    else {
+      aggregate_ = this->getValue();
+    }
+    if(right != NULL){
+      aggregate_ = combine(aggregate_, right->aggregate_);
+    }
+    return true;
+}
+
+/**
+* Trades aggregates with other, which must be an AggregateAVLNode too.
+*/
+template<class Key, class Value, class Combine>
+void AggregateAVLNode<Key, Value, Combine>::swapAggregate(AVLNode<Key, Value>* other)
+{
+    std::swap(aggregate_, static_cast<AggregateAVLNode<Key, Value, Combine>*>(other)->aggregate_);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the AggregateAVLNode class.
+  -----------------------------------------------
+*/
+
+/**
+* An AVLTree that keeps, in every node, Combine folded over the values
+* of its subtree, so a reduction over any key range costs O(log n)
+* instead of a scan: a sum of bytes in a time window, the worst latency
+* in a range of request ids, and so on.
+*
+* Leaf inserts, removals and in-place value updates refresh the path up
+* to the root; rotations, node swaps and the split/join used by range
+* erase refresh the nodes they relink. Values must only be changed
+* through insert(): writing through an iterator leaves aggregates stale,
+* which is why operator[] is read-only here.
+*/
+template <class Key, class Value, class Combine = std::plus<Value> >
+class AggregateAVLTree : public AVLTree<Key, Value>
+{
+public:
+    typedef AggregateAVLNode<Key, Value, Combine> NodeType;
+
+    // identity is what an empty range reduces to
+    explicit AggregateAVLTree(const Value& identity = Value());
+
+    // Combine over the values of keys in [lo, hi)
+    Value aggregate(const Key& lo, const Key& hi) const;
+    // Combine over the whole tree
+    Value aggregate() const;
+    Value const & operator[](const Key& key) const;
+
+protected:
+    virtual NodeType* createNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual size_t nodeSize() const;
+
+protected:
+    Value identity_;
+};
+
+/*
+-----------------------------------------------------
+Begin implementations for the AggregateAVLTree class.
+-----------------------------------------------------
+*/
+
+/**
+* Constructor for an empty tree.
+*/
+template<class Key, class Value, class Combine>
+AggregateAVLTree<Key, Value, Combine>::AggregateAVLTree(const Value& identity) :
+    identity_(identity)
+{
+
+}
+
+/**
+* Reduces the values of keys in [lo, hi) in O(log n). Finds the highest
+* node inside the range, then walks down towards lo and towards hi,
+* taking whole subtrees that lie inside the range from their aggregate.
+* Returns the identity if the range is empty.
+*/
+template<class Key, class Value, class Combine>
+Value AggregateAVLTree<Key, Value, Combine>::aggregate(const Key& lo, const Key& hi) const
+{
+    Combine combine;
+    NodeType* split = static_cast<NodeType*>(this->root_);
+    while(split != NULL){
+      if(split->getKey() < lo){
+        split = static_cast<NodeType*>(split->getRight());
+      }
+      else if(!(split->getKey() < hi)){
+        split = static_cast<NodeType*>(split->getLeft());
+      }
+      else {
+        break;
+      }
+    }
+    if(split == NULL){
+      return identity_;
+    }
+
+    // left boundary: in-range nodes come up in decreasing key order
+    Value left = identity_;
+    NodeType* n = static_cast<NodeType*>(split->getLeft());
+    while(n != NULL){
+      if(n->getKey() < lo){
+        n = static_cast<NodeType*>(n->getRight());
+      }
+      else {
+        NodeType* r = static_cast<NodeType*>(n->getRight());
+        Value part = (r == NULL) ? n->getValue() : combine(n->getValue(), r->getAggregate());
+        left = combine(part, left);
+        n = static_cast<NodeType*>(n->getLeft());
+      }
+    }
+
+    // right boundary: in-range nodes come up in increasing key order
+    Value right = identity_;
+    n = static_cast<NodeType*>(split->getRight());
+    while(n != NULL){
+      if(!(n->getKey() < hi)){
+        n = static_cast<NodeType*>(n->getLeft());
+      }
+      else {
+        NodeType* l = static_cast<NodeType*>(n->getLeft());
+        Value part = (l == NULL) ? n->getValue() : combine(l->getAggregate(), n->getValue());
+        right = combine(right, part);
+        n = static_cast<NodeType*>(n->getRight());
+      }
+    }
+
+    return combine(combine(left, split->getValue()), right);
+}
+
+/**
+* Reduces every value in the tree in O(1).
+*/
+template<class Key, class Value, class Combine>
+Value AggregateAVLTree<Key, Value, Combine>::aggregate() const
+{
+    if(this->root_ == NULL){
+      return identity_;
+    }
+    return static_cast<NodeType*>(this->root_)->getAggregate();
+}
+
+/**
+* Read-only lookup; hides the writable operator[] of the base class,
+* which would bypass the aggregates.
+*/
+template<class Key, class Value, class Combine>
+Value const & AggregateAVLTree<Key, Value, Combine>::operator[](const Key& key) const
+{
+    return BinarySearchTree<Key, Value>::operator[](key);
+}
+
+// HELPER: every node of the tree carries an aggregate
+template<class Key, class Value, class Combine>
+typename AggregateAVLTree<Key, Value, Combine>::NodeType*
+AggregateAVLTree<Key, Value, Combine>::createNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    return new NodeType(key, value, static_cast<AVLNode<Key, Value>*>(parent));
+}
+
+template<class Key, class Value, class Combine>
+size_t AggregateAVLTree<Key, Value, Combine>::nodeSize() const
+{
+    return sizeof(NodeType);
+}
+
+/*
+------------------------------------------------------------
+End implementations for the AggregateAVLTree class.
+------------------------------------------------------------
+*/
+
+#endif
@@ -28,6 +28,14 @@ public:
     void setBalance (int8_t balance);
     void updateBalance(int8_t diff);
 
+    // Recomputes whatever a derived node keeps about its whole subtree.
+    // The tree calls it whenever the node gets new children. Returns
+    // false if the node keeps nothing, so its ancestors need no refresh.
+    virtual bool refreshAggregate();
+    // Trades what refreshAggregate() keeps with other, for when the two
+    // nodes trade places in the tree.
+    virtual void swapAggregate(AVLNode<Key, Value>* other);
+
     // Getters for parent, left, and right. These need to be redefined since they
     // return pointers to AVLNodes - not plain Nodes. See the Node class in bst.h
     // for more information.
@@ -91,6 +99,24 @@ void AVLNode<Key, Value>::updateBalance(int8_t diff)
     balance_ += diff;
 }
 
+/**
+* Plain AVL nodes keep nothing per subtree.
+*/
+template<class Key, class Value>
+bool AVLNode<Key, Value>::refreshAggregate()
+{
+    return false;
+}
+
+/**
+* Nothing to trade for plain AVL nodes.
+*/
+template<class Key, class Value>
+void AVLNode<Key, Value>::swapAggregate(AVLNode<Key, Value>* other)
+{
+
+}
+
 /**
 * An overridden function for getting the parent since a static_cast is necessary to make sure
 * that our node is a AVLNode.
@@ -98,7 +124,7 @@ void AVLNode<Key, Value>::updateBalance(int8_t diff)
 template<class Key, class Value>
 AVLNode<Key, Value> *AVLNode<Key, Value>::getParent() const
 {
-    return static_cast<AVLNode<Key, Value>*>(this->parent_);
+    return static_cast<AVLNode<Key, Value>*>(Node<Key, Value>::getParent());
 }
 
 /**
@@ -107,7 +133,7 @@ AVLNode<Key, Value> *AVLNode<Key, Value>::getParent() const
 template<class Key, class Value>
 AVLNode<Key, Value> *AVLNode<Key, Value>::getLeft() const
 {
-    return static_cast<AVLNode<Key, Value>*>(this->left_);
+    return static_cast<AVLNode<Key, Value>*>(this->children_[0]);
 }
 
 /**
@@ -116,7 +142,7 @@ AVLNode<Key, Value> *AVLNode<Key, Value>::getLeft() const
 template<class Key, class Value>
 AVLNode<Key, Value> *AVLNode<Key, Value>::getRight() const
 {
-    return static_cast<AVLNode<Key, Value>*>(this->right_);
+    return static_cast<AVLNode<Key, Value>*>(this->children_[1]);
 }
 
 
@@ -131,16 +157,48 @@ template <class Key, class Value>
 class AVLTree : public BinarySearchTree<Key, Value>
 {
 public:
+    typedef typename BinarySearchTree<Key, Value>::iterator iterator;
+
     virtual void insert (const std::pair<const Key, Value> &new_item); // TODO
+    using BinarySearchTree<Key, Value>::insert;
     virtual void remove(const Key& key);  // TODO
+    using BinarySearchTree<Key, Value>::erase;
+    // O(1): every operation restores the AVL property before returning
+    virtual bool isBalanced() const;
+    // moves every item with a key >= key into rest, replacing its contents
+    void split(const Key& key, AVLTree<Key, Value>& rest);
+    // moves every item of other into this tree; other's keys must all be
+    // smaller, or all be larger, than the keys in this tree
+    void join(AVLTree<Key, Value>& other);
 protected:
     virtual void nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2);
+    // refreshes the subtree aggregates from node up to the root
+    virtual void refreshPath(Node<Key, Value>* node);
+    virtual void removeNode(Node<Key, Value>* node);
+    virtual void removeRange(Node<Key, Value>* first, Node<Key, Value>* last);
+    virtual AVLNode<Key, Value>* createNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual size_t nodeSize() const;
+    virtual Node<Key, Value>* attachLeaf(Node<Key, Value>* parent, bool left, const std::pair<const Key, Value> &new_item);
 
     //HELPERS:
+    AVLNode<Key, Value>* insertLeaf(AVLNode<Key, Value>* p, bool left, const std::pair<const Key, Value> &new_item);
     void insertFix(AVLNode<Key, Value>* p, AVLNode<Key, Value>* n);
     void rotateLeft(AVLNode<Key, Value>* node);
     void rotateRight(AVLNode<Key, Value>* node);
     void removeFix(AVLNode<Key, Value>* n, int diff);
+
+    // Split/join on detached subtrees. Heights are passed along (and
+    // derived from balances on the way down) so no node stores one.
+    static int subtreeHeight(AVLNode<Key, Value>* n);
+    static AVLNode<Key, Value>* attachRight(AVLNode<Key, Value>* t, int ha, AVLNode<Key, Value>* sub, int hs, int& h);
+    static AVLNode<Key, Value>* attachLeft(AVLNode<Key, Value>* t, int hc, AVLNode<Key, Value>* sub, int hs, int& h);
+    static AVLNode<Key, Value>* joinRight(AVLNode<Key, Value>* t, int ht, AVLNode<Key, Value>* k, AVLNode<Key, Value>* r, int hr, int& h);
+    static AVLNode<Key, Value>* joinLeft(AVLNode<Key, Value>* l, int hl, AVLNode<Key, Value>* k, AVLNode<Key, Value>* t, int ht, int& h);
+    static AVLNode<Key, Value>* joinAVL(AVLNode<Key, Value>* l, int hl, AVLNode<Key, Value>* k, AVLNode<Key, Value>* r, int hr, int& h);
+    static AVLNode<Key, Value>* joinAVL(AVLNode<Key, Value>* l, int hl, AVLNode<Key, Value>* r, int hr, int& h);
+    static AVLNode<Key, Value>* splitLast(AVLNode<Key, Value>* t, int ht, AVLNode<Key, Value>*& last, int& h);
+    static void splitAVL(AVLNode<Key, Value>* t, int ht, const Key& key,
+                         AVLNode<Key, Value>*& less, int& hl, AVLNode<Key, Value>*& rest, int& hr);
 };
 
 /*
@@ -153,25 +211,34 @@ void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
     // COPIED FROM: binary search tree insert
     AVLNode<Key, Value>* current = static_cast<AVLNode<Key, Value>*>(this->root_);
 
-    // variables
-    AVLNode<Key,Value>* n;
-    AVLNode<Key,Value>* p;
-    int diff = 0;
-
     // Check if tree is empty
     if(this->root_==NULL){
-      AVLNode<Key, Value>* newNode = new AVLNode<Key,Value>(new_item.first, new_item.second, NULL);
+      AVLNode<Key, Value>* newNode = createNode(new_item.first, new_item.second, NULL);
       this->root_ = newNode;
+      this->leftmost_ = newNode;
+      this->rightmost_ = newNode;
       // leave the function
       return;
     }
 
+    // Fast path: a new maximum goes straight under the cached rightmost node
+    if(this->rightmost_->getKey() < new_item.first){
+      insertLeaf(static_cast<AVLNode<Key, Value>*>(this->rightmost_), false, new_item);
+      return;
+    }
+    // and a new minimum under the cached leftmost node
+    if(new_item.first < this->leftmost_->getKey()){
+      insertLeaf(static_cast<AVLNode<Key, Value>*>(this->leftmost_), true, new_item);
+      return;
+    }
+
     // While true
     while(true){
       // if keys are equal 
       if(new_item.first == current->getKey()) {
         // update value of key
         current->setValue(new_item.second);
+        this->refreshPath(current);
         // leave the function
         return;
       }
@@ -179,17 +246,8 @@ void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
       else if(new_item.first < current->getKey()) {
         // check if left subtree is NULL
         if(current->getLeft()==NULL){
-          // create new node (DYNAMIC ALLOCATION)
-          AVLNode<Key, Value>* newNode = new AVLNode<Key, Value>(new_item.first, new_item.second, current);
-          // set current node (newNode's parent)'s left node
-          current->setLeft(newNode);
-          
-          n = current->getLeft();
-          p = current;
-          diff--;
-
-          // leave the loop
-          break;
+          insertLeaf(current, true, new_item);
+          return;
         }
         // recurse to left subtree
         else {
@@ -200,17 +258,8 @@ void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
       else {
         // check if right subtree is NULL
         if(current->getRight()==NULL){
-          // create new node (DYNAMIC ALLOCATION)
-          AVLNode<Key, Value>* newNode = new AVLNode<Key, Value>(new_item.first, new_item.second, current);
-          // set current node (newNode's parent)'s right node
-          current->setRight(newNode);
-
-          n = current->getRight();
-          p = current;
-          diff++;
-
-          // leave the loop
-          break;
+          insertLeaf(current, false, new_item);
+          return;
         }
         // recurse to right subtree
         else {
@@ -218,6 +267,64 @@ void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
         }
       }
     }
+}
+
+/*
+ * Leaf slots found by hinted/sorted inserts go through the same
+ * bottom-up rebalancing as a regular insert.
+ */
+template<class Key, class Value>
+Node<Key, Value>* AVLTree<Key, Value>::attachLeaf(Node<Key, Value>* parent, bool left, const std::pair<const Key, Value> &new_item)
+{
+    return insertLeaf(static_cast<AVLNode<Key, Value>*>(parent), left, new_item);
+}
+
+/**
+ * Return true iff the tree is balanced. Every insert, removal, split and
+ * join rebalances before it returns, so there is nothing to walk.
+ */
+template<class Key, class Value>
+bool AVLTree<Key, Value>::isBalanced() const
+{
+    return true;
+}
+
+// HELPER: every AVL tree node is allocated here
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::createNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    return new AVLNode<Key, Value>(key, value, static_cast<AVLNode<Key, Value>*>(parent));
+}
+
+template<class Key, class Value>
+size_t AVLTree<Key, Value>::nodeSize() const
+{
+    return sizeof(AVLNode<Key, Value>);
+}
+
+// HELPER: attach a new leaf under p and rebalance bottom-up
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::insertLeaf(AVLNode<Key, Value>* p, bool left, const std::pair<const Key, Value> &new_item)
+{
+    // create new node (DYNAMIC ALLOCATION)
+    AVLNode<Key, Value>* n = createNode(new_item.first, new_item.second, p);
+    int diff = 0;
+    if(left){
+      p->setLeft(n);
+      diff--;
+      if(p == this->leftmost_){
+        this->leftmost_ = n;
+      }
+    }
+    else {
+      p->setRight(n);
+      diff++;
+      if(p == this->rightmost_){
+        this->rightmost_ = n;
+      }
+    }
+
+    this->refreshPath(p);
 
     // Process after inserting the node
     if(p->getBalance()==-1){
@@ -231,6 +338,7 @@ void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
       // Call insertFix(p, n)
       insertFix(p, n);
     }
+    return n;
 }
 
 // HELPER: insertFix
@@ -342,15 +450,27 @@ template<class Key, class Value>
 void AVLTree<Key, Value>:: remove(const Key& key)
 {
     // TODO
-    AVLNode<Key, Value>* p;
-    int diff = 0;
-    // COPIED FROM bst.h
-
     // key does not exist
-    AVLNode<Key, Value>* remove = static_cast<AVLNode<Key, Value>*>(this->internalFind(key));
+    Node<Key, Value>* remove = this->internalFind(key);
     if(remove == NULL){
       return;
     }
+    removeNode(remove);
+}
+
+/*
+ * Unlinks and deletes a node of this tree, then rebalances upward.
+ * Balance updates are left to removeFix so each node is adjusted once.
+ */
+template<class Key, class Value>
+void AVLTree<Key, Value>::removeNode(Node<Key, Value>* node)
+{
+    AVLNode<Key, Value>* p;
+    int diff = 0;
+    // COPIED FROM bst.h
+
+    AVLNode<Key, Value>* remove = static_cast<AVLNode<Key, Value>*>(node);
+    this->retireExtremes(remove);
 
     // --- CASE 1: NO CHILDREN
     if(remove->getLeft()==NULL && remove->getRight()==NULL){
@@ -361,11 +481,9 @@ void AVLTree<Key, Value>:: remove(const Key& key)
       }
       else if(removeParent->getKey() >remove->getKey()){
         diff++;
-        removeParent->updateBalance(diff);
         removeParent->setLeft(NULL);
       } else {
         diff--;
-        removeParent->updateBalance(diff);
         removeParent->setRight(NULL);
       }
       // remove node
@@ -373,6 +491,7 @@ void AVLTree<Key, Value>:: remove(const Key& key)
       p = removeParent;
 
       // patch tree
+      this->refreshPath(p);
       removeFix(p, diff);
 
       return;
@@ -407,8 +526,6 @@ void AVLTree<Key, Value>:: remove(const Key& key)
       AVLNode<Key,Value>* leftChild = remove->getLeft();
       AVLNode<Key,Value>* rightChild = remove->getRight();
 
-      removeParent->updateBalance(diff);
-
       if(rightChild!=NULL && leftChild!=NULL){
         removeParent->setLeft(leftChild);
         leftChild->setParent(removeParent);
@@ -433,6 +550,7 @@ void AVLTree<Key, Value>:: remove(const Key& key)
       p = removeParent;
 
       // patch tree
+      this->refreshPath(p);
       removeFix(p, diff);
 
       return;
@@ -454,10 +572,8 @@ void AVLTree<Key, Value>:: remove(const Key& key)
       //update diff
       if(removeParent->getLeft()==remove){
         diff++;
-        removeParent->updateBalance(diff);
       } else if(removeParent->getRight()==remove){
         diff--;
-        removeParent->updateBalance(diff);
       }
 
         // remove has left child
@@ -517,6 +633,7 @@ void AVLTree<Key, Value>:: remove(const Key& key)
       p = removeParent;
 
       // patch tree
+      this->refreshPath(p);
       removeFix(p, diff);
 
       return;
@@ -544,8 +661,9 @@ void AVLTree<Key, Value>::removeFix(AVLNode<Key, Value>* n, int diff){
     }
   }
 
-  int nBalance = n->getBalance();
+  // balance of n once the shorter subtree is accounted for
   n->updateBalance(diff);
+  int nBalance = n->getBalance();
 
   // diff = -1
   if(diff==-1){
@@ -646,10 +764,10 @@ void AVLTree<Key, Value>::removeFix(AVLNode<Key, Value>* n, int diff){
         rotateRight(c);
         rotateLeft(n);
 
-        // cases
+        // cases (mirror of the left-heavy case)
         if(gBalance==1){
-          n->setBalance(0);
-          c->setBalance(-1);
+          n->setBalance(-1);
+          c->setBalance(0);
           g->setBalance(0);
         } else if(gBalance==0){
           n->setBalance(0);
@@ -657,8 +775,8 @@ void AVLTree<Key, Value>::removeFix(AVLNode<Key, Value>* n, int diff){
           g->setBalance(0);
         } else {
           // gBalance = -1
-          n->setBalance(1);
-          c->setBalance(0);
+          n->setBalance(0);
+          c->setBalance(1);
           g->setBalance(0);
         }
         removeFix(p, ndiff);
@@ -685,6 +803,22 @@ void AVLTree<Key, Value>::nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>*
     int8_t tempB = n1->getBalance();
     n1->setBalance(n2->getBalance());
     n2->setBalance(tempB);
+    // subtree aggregates, like balances, belong to the positions
+    n1->swapAggregate(n2);
+}
+
+/**
+* Recomputes the subtree aggregates from node up to the root, bottom-up.
+* Plain AVL nodes keep none, so for them this stops after one call.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::refreshPath(Node<Key, Value>* node)
+{
+    for(Node<Key, Value>* n = node; n != NULL; n = n->getParent()){
+      if(!static_cast<AVLNode<Key, Value>*>(n)->refreshAggregate()){
+        return;
+      }
+    }
 }
 
 // HELPER: rotate left
@@ -717,7 +851,8 @@ void AVLTree<Key, Value>::rotateLeft(AVLNode<Key, Value>* node){
   if(b!=NULL){
     b->setParent(node);
   }
-  
+  node->refreshAggregate();
+  child->refreshAggregate();
 }
 
 // HELPER: rotate right
@@ -750,6 +885,372 @@ void AVLTree<Key, Value>::rotateRight(AVLNode<Key, Value>* node){
   if(c!=NULL){
     c->setParent(node);
   }
+  node->refreshAggregate();
+  child->refreshAggregate();
+}
+
+/*
+ * Range removal: split the tree at first and at last, free the middle
+ * piece and join the two outer pieces. Each split/join rebalances only
+ * along one root-to-leaf path, so the whole range costs O(log n) plus
+ * the O(k) deletes, instead of k separate removeFix passes.
+ */
+template<class Key, class Value>
+void AVLTree<Key, Value>::removeRange(Node<Key, Value>* first, Node<Key, Value>* last)
+{
+    AVLNode<Key, Value>* less;
+    AVLNode<Key, Value>* rest;
+    AVLNode<Key, Value>* middle;
+    AVLNode<Key, Value>* greater = NULL;
+    int hLess, hRest, hMiddle, hGreater = 0, h;
+
+    AVLNode<Key, Value>* root = static_cast<AVLNode<Key, Value>*>(this->root_);
+    splitAVL(root, subtreeHeight(root), first->getKey(), less, hLess, rest, hRest);
+    if(last != NULL){
+      splitAVL(rest, hRest, last->getKey(), middle, hMiddle, greater, hGreater);
+    }
+    else {
+      middle = rest;
+    }
+    this->deleteSubtree(middle);
+    this->root_ = joinAVL(less, hLess, greater, hGreater, h);
+}
+
+/**
+* Splits the tree in O(log n): keys below key stay, the rest move into
+* rest. Nodes are relinked, not copied, so outstanding iterators stay
+* valid (in whichever tree now holds their node).
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::split(const Key& key, AVLTree<Key, Value>& rest)
+{
+    if(&rest == this){
+      return;
+    }
+    rest.clear();
+
+    AVLNode<Key, Value>* less;
+    AVLNode<Key, Value>* greater;
+    int hLess, hGreater;
+    AVLNode<Key, Value>* root = static_cast<AVLNode<Key, Value>*>(this->root_);
+    splitAVL(root, subtreeHeight(root), key, less, hLess, greater, hGreater);
+
+    rest.root_ = greater;
+    rest.rightmost_ = (greater != NULL) ? this->rightmost_ : NULL;
+    rest.leftmost_ = greater;
+    while(rest.leftmost_ != NULL && rest.leftmost_->getLeft() != NULL){
+      rest.leftmost_ = rest.leftmost_->getLeft();
+    }
+
+    this->root_ = less;
+    if(less == NULL){
+      this->leftmost_ = NULL;
+    }
+    this->rightmost_ = less;
+    while(this->rightmost_ != NULL && this->rightmost_->getRight() != NULL){
+      this->rightmost_ = this->rightmost_->getRight();
+    }
+}
+
+/**
+* Joins the two trees in O(log n) by relinking; other is left empty.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::join(AVLTree<Key, Value>& other)
+{
+    if(&other == this || other.root_ == NULL){
+      return;
+    }
+
+    AVLNode<Key, Value>* mine = static_cast<AVLNode<Key, Value>*>(this->root_);
+    AVLNode<Key, Value>* theirs = static_cast<AVLNode<Key, Value>*>(other.root_);
+    int h;
+    if(mine == NULL){
+      this->root_ = theirs;
+      this->leftmost_ = other.leftmost_;
+      this->rightmost_ = other.rightmost_;
+    }
+    else if(other.rightmost_->getKey() < this->leftmost_->getKey()){
+      this->root_ = joinAVL(theirs, subtreeHeight(theirs), mine, subtreeHeight(mine), h);
+      this->leftmost_ = other.leftmost_;
+    }
+    else {
+      this->root_ = joinAVL(mine, subtreeHeight(mine), theirs, subtreeHeight(theirs), h);
+      this->rightmost_ = other.rightmost_;
+    }
+
+    other.root_ = NULL;
+    other.leftmost_ = NULL;
+    other.rightmost_ = NULL;
+}
+
+// HELPER: height of a subtree, following the taller child down
+template<class Key, class Value>
+int AVLTree<Key, Value>::subtreeHeight(AVLNode<Key, Value>* n)
+{
+  int h = 0;
+  while(n!=NULL){
+    h++;
+    n = (n->getBalance() > 0) ? n->getRight() : n->getLeft();
+  }
+  return h;
+}
+
+// HELPER: make sub (height hs) the right child of t, whose left child
+// has height ha, and restore the AVL property at t. sub may be at most
+// two taller than the left side. Returns the new subtree root.
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::attachRight(AVLNode<Key, Value>* t, int ha, AVLNode<Key, Value>* sub, int hs, int& h)
+{
+  BinarySearchTree<Key, Value>::linkRight(t, sub);
+  if(hs <= ha + 1){
+    t->setBalance(hs - ha);
+    t->refreshAggregate();
+    h = std::max(ha, hs) + 1;
+    return t;
+  }
+
+  // right side is two taller: rotate
+  AVLNode<Key, Value>* x = sub->getLeft();
+  int hx = hs - 1 - (sub->getBalance() > 0 ? 1 : 0);
+  int hy = hs - 1 - (sub->getBalance() < 0 ? 1 : 0);
+
+  // zig zig -- single rotation
+  if(hy >= hx){
+    BinarySearchTree<Key, Value>::linkRight(t, x);
+    t->setBalance(hx - ha);
+    t->refreshAggregate();
+    int ht = std::max(ha, hx) + 1;
+    BinarySearchTree<Key, Value>::linkLeft(sub, t);
+    sub->setBalance(hy - ht);
+    sub->refreshAggregate();
+    h = std::max(ht, hy) + 1;
+    return sub;
+  }
+
+  // zig zag -- double rotation around x
+  AVLNode<Key, Value>* g1 = x->getLeft();
+  AVLNode<Key, Value>* g2 = x->getRight();
+  int h1 = hx - 1 - (x->getBalance() > 0 ? 1 : 0);
+  int h2 = hx - 1 - (x->getBalance() < 0 ? 1 : 0);
+  BinarySearchTree<Key, Value>::linkRight(t, g1);
+  t->setBalance(h1 - ha);
+  t->refreshAggregate();
+  int ht = std::max(ha, h1) + 1;
+  BinarySearchTree<Key, Value>::linkLeft(sub, g2);
+  sub->setBalance(hy - h2);
+  sub->refreshAggregate();
+  int hsub = std::max(h2, hy) + 1;
+  BinarySearchTree<Key, Value>::linkLeft(x, t);
+  BinarySearchTree<Key, Value>::linkRight(x, sub);
+  x->setBalance(hsub - ht);
+  x->refreshAggregate();
+  h = std::max(ht, hsub) + 1;
+  return x;
+}
+
+// HELPER: mirror of attachRight
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::attachLeft(AVLNode<Key, Value>* t, int hc, AVLNode<Key, Value>* sub, int hs, int& h)
+{
+  BinarySearchTree<Key, Value>::linkLeft(t, sub);
+  if(hs <= hc + 1){
+    t->setBalance(hc - hs);
+    t->refreshAggregate();
+    h = std::max(hc, hs) + 1;
+    return t;
+  }
+
+  AVLNode<Key, Value>* y = sub->getRight();
+  int hx = hs - 1 - (sub->getBalance() > 0 ? 1 : 0);
+  int hy = hs - 1 - (sub->getBalance() < 0 ? 1 : 0);
+
+  // zig zig -- single rotation
+  if(hx >= hy){
+    BinarySearchTree<Key, Value>::linkLeft(t, y);
+    t->setBalance(hc - hy);
+    t->refreshAggregate();
+    int ht = std::max(hc, hy) + 1;
+    BinarySearchTree<Key, Value>::linkRight(sub, t);
+    sub->setBalance(ht - hx);
+    sub->refreshAggregate();
+    h = std::max(ht, hx) + 1;
+    return sub;
+  }
+
+  // zig zag -- double rotation around y
+  AVLNode<Key, Value>* g1 = y->getLeft();
+  AVLNode<Key, Value>* g2 = y->getRight();
+  int h1 = hy - 1 - (y->getBalance() > 0 ? 1 : 0);
+  int h2 = hy - 1 - (y->getBalance() < 0 ? 1 : 0);
+  BinarySearchTree<Key, Value>::linkLeft(t, g2);
+  t->setBalance(hc - h2);
+  t->refreshAggregate();
+  int ht = std::max(hc, h2) + 1;
+  BinarySearchTree<Key, Value>::linkRight(sub, g1);
+  sub->setBalance(h1 - hx);
+  sub->refreshAggregate();
+  int hsub = std::max(hx, h1) + 1;
+  BinarySearchTree<Key, Value>::linkLeft(y, sub);
+  BinarySearchTree<Key, Value>::linkRight(y, t);
+  y->setBalance(ht - hsub);
+  y->refreshAggregate();
+  h = std::max(ht, hsub) + 1;
+  return y;
+}
+
+// HELPER: join when t (height ht) is more than one taller than r:
+// walk down t's right spine to a subtree of about r's height
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::joinRight(AVLNode<Key, Value>* t, int ht, AVLNode<Key, Value>* k, AVLNode<Key, Value>* r, int hr, int& h)
+{
+  AVLNode<Key, Value>* c = t->getRight();
+  int ha = ht - 1 - (t->getBalance() > 0 ? 1 : 0);
+  int hc = ht - 1 - (t->getBalance() < 0 ? 1 : 0);
+
+  AVLNode<Key, Value>* sub;
+  int hs;
+  if(hc <= hr + 1){
+    BinarySearchTree<Key, Value>::linkLeft(k, c);
+    BinarySearchTree<Key, Value>::linkRight(k, r);
+    k->setBalance(hr - hc);
+    k->refreshAggregate();
+    sub = k;
+    hs = std::max(hc, hr) + 1;
+  }
+  else {
+    sub = joinRight(c, hc, k, r, hr, hs);
+  }
+  return attachRight(t, ha, sub, hs, h);
+}
+
+// HELPER: mirror of joinRight, walking down t's left spine
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::joinLeft(AVLNode<Key, Value>* l, int hl, AVLNode<Key, Value>* k, AVLNode<Key, Value>* t, int ht, int& h)
+{
+  AVLNode<Key, Value>* a = t->getLeft();
+  int ha = ht - 1 - (t->getBalance() > 0 ? 1 : 0);
+  int hc = ht - 1 - (t->getBalance() < 0 ? 1 : 0);
+
+  AVLNode<Key, Value>* sub;
+  int hs;
+  if(ha <= hl + 1){
+    BinarySearchTree<Key, Value>::linkLeft(k, l);
+    BinarySearchTree<Key, Value>::linkRight(k, a);
+    k->setBalance(ha - hl);
+    k->refreshAggregate();
+    sub = k;
+    hs = std::max(ha, hl) + 1;
+  }
+  else {
+    sub = joinLeft(l, hl, k, a, ha, hs);
+  }
+  return attachLeft(t, hc, sub, hs, h);
+}
+
+// HELPER: join l < k < r into one AVL tree, returns the detached root
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::joinAVL(AVLNode<Key, Value>* l, int hl, AVLNode<Key, Value>* k, AVLNode<Key, Value>* r, int hr, int& h)
+{
+  AVLNode<Key, Value>* root;
+  if(hl > hr + 1){
+    root = joinRight(l, hl, k, r, hr, h);
+  }
+  else if(hr > hl + 1){
+    root = joinLeft(l, hl, k, r, hr, h);
+  }
+  else {
+    BinarySearchTree<Key, Value>::linkLeft(k, l);
+    BinarySearchTree<Key, Value>::linkRight(k, r);
+    k->setBalance(hr - hl);
+    k->refreshAggregate();
+    h = std::max(hl, hr) + 1;
+    root = k;
+  }
+  root->setParent(NULL);
+  return root;
+}
+
+// HELPER: join l < r without a middle node, borrowing l's maximum
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::joinAVL(AVLNode<Key, Value>* l, int hl, AVLNode<Key, Value>* r, int hr, int& h)
+{
+  if(l==NULL){
+    h = hr;
+    if(r!=NULL){
+      r->setParent(NULL);
+    }
+    return r;
+  }
+  if(r==NULL){
+    h = hl;
+    l->setParent(NULL);
+    return l;
+  }
+  AVLNode<Key, Value>* last;
+  int hRest;
+  AVLNode<Key, Value>* rest = splitLast(l, hl, last, hRest);
+  return joinAVL(rest, hRest, last, r, hr, h);
+}
+
+// HELPER: detach the maximum node of t, returns the remaining tree
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::splitLast(AVLNode<Key, Value>* t, int ht, AVLNode<Key, Value>*& last, int& h)
+{
+  AVLNode<Key, Value>* a = t->getLeft();
+  if(t->getRight()==NULL){
+    last = t;
+    h = ht - 1;
+    if(a!=NULL){
+      a->setParent(NULL);
+    }
+    return a;
+  }
+  int ha = ht - 1 - (t->getBalance() > 0 ? 1 : 0);
+  int hc = ht - 1 - (t->getBalance() < 0 ? 1 : 0);
+  int hRest;
+  AVLNode<Key, Value>* rest = splitLast(t->getRight(), hc, last, hRest);
+  if(a!=NULL){
+    a->setParent(NULL);
+  }
+  return joinAVL(a, ha, t, rest, hRest, h);
+}
+
+// HELPER: split t into keys < key (less) and keys >= key (rest)
+template<class Key, class Value>
+void AVLTree<Key, Value>::splitAVL(AVLNode<Key, Value>* t, int ht, const Key& key,
+                                   AVLNode<Key, Value>*& less, int& hl, AVLNode<Key, Value>*& rest, int& hr)
+{
+  if(t==NULL){
+    less = NULL;
+    rest = NULL;
+    hl = 0;
+    hr = 0;
+    return;
+  }
+
+  AVLNode<Key, Value>* a = t->getLeft();
+  AVLNode<Key, Value>* c = t->getRight();
+  int ha = ht - 1 - (t->getBalance() > 0 ? 1 : 0);
+  int hc = ht - 1 - (t->getBalance() < 0 ? 1 : 0);
+  if(a!=NULL){
+    a->setParent(NULL);
+  }
+  if(c!=NULL){
+    c->setParent(NULL);
+  }
+
+  AVLNode<Key, Value>* m;
+  int hm;
+  if(t->getKey() < key){
+    // t and its left subtree are all smaller
+    splitAVL(c, hc, key, m, hm, rest, hr);
+    less = joinAVL(a, ha, t, m, hm, hl);
+  }
+  else {
+    splitAVL(a, ha, key, less, hl, m, hm);
+    rest = joinAVL(m, hm, t, c, hc, hr);
+  }
 }
 
 #endif
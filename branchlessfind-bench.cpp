@@ -0,0 +1,91 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include "avlbst.h"
+
+using namespace std;
+
+// Compares find() on uint64_t keys, which take the branchless descent,
+// with the same keys wrapped in a class, which take the generic one.
+// Usage: branchlessfind-bench [number of lookups]
+
+// a uint64_t that is not an arithmetic type, so the tree treats it
+// like any other key
+struct WrappedKey
+{
+    WrappedKey(uint64_t v) : value(v) {}
+    bool operator==(const WrappedKey& rhs) const { return value == rhs.value; }
+    bool operator<(const WrappedKey& rhs) const { return value < rhs.value; }
+    bool operator>(const WrappedKey& rhs) const { return value > rhs.value; }
+    uint64_t value;
+};
+
+ostream& operator<<(ostream& os, const WrappedKey& key)
+{
+    return os << key.value;
+}
+
+static double secondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+template<typename Key>
+double timeFinds(const vector<uint64_t>& keys, const vector<uint64_t>& probes, uint64_t& found)
+{
+    AVLTree<Key, uint64_t> tree;
+    for(size_t i = 0; i < keys.size(); i++) {
+        tree.insert(std::make_pair(Key(keys[i]), keys[i]));
+    }
+    vector<Key> lookups(probes.begin(), probes.end());
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    found = 0;
+    for(size_t i = 0; i < lookups.size(); i++) {
+        if(tree.find(lookups[i]) != tree.end()) {
+            found++;
+        }
+    }
+    return secondsSince(start);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t lookups = (argc > 1) ? strtoull(argv[1], NULL, 10) : 2000000;
+    // from cache resident to well past the last level cache
+    size_t sizes[] = { 1000, 100000, 2000000 };
+    mt19937_64 rng(48);
+
+    cout << "lookups = " << lookups << endl;
+    cout << setw(10) << "n" << setw(12) << "generic" << setw(12) << "branchless" << setw(10) << "speedup"
+         << "   (M lookups/s)" << endl;
+    cout << fixed << setprecision(2);
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s];
+        // insert in random order; about half of the lookups miss (odd keys)
+        vector<uint64_t> keys(n);
+        for(size_t i = 0; i < n; i++) {
+            keys[i] = 2 * i;
+        }
+        shuffle(keys.begin(), keys.end(), rng);
+        vector<uint64_t> probes(lookups);
+        for(size_t i = 0; i < lookups; i++) {
+            probes[i] = rng() % (2 * n);
+        }
+
+        uint64_t genericFound, branchlessFound;
+        double genericTime = timeFinds<WrappedKey>(keys, probes, genericFound);
+        double branchlessTime = timeFinds<uint64_t>(keys, probes, branchlessFound);
+        if(genericFound != branchlessFound) {
+            cout << "mismatch: " << genericFound << " != " << branchlessFound << endl;
+            return 1;
+        }
+        cout << setw(10) << n << setw(12) << lookups / genericTime / 1e6 << setw(12) << lookups / branchlessTime / 1e6
+             << setw(9) << genericTime / branchlessTime << "x" << endl;
+    }
+    return 0;
+}
@@ -44,5 +44,71 @@ int main(int argc, char *argv[])
     cout << "Erasing b" << endl;
     at.remove('b');
 
+    // Ascending keys take the append fast path, hints skip the descent
+    AVLTree<int,int> ht;
+    for(int i = 0; i < 10; i += 2) {
+        ht.insert(std::make_pair(i, i));
+    }
+    AVLTree<int,int>::iterator hint = ht.find(4);
+    ht.insert(hint, std::make_pair(3, 3));
+    ht.insert(ht.end(), std::make_pair(20, 20));
+
+    cout << "\nHinted AVLTree contents:" << endl;
+    for(AVLTree<int,int>::iterator it = ht.begin(); it != ht.end(); ++it) {
+        cout << it->first << " ";
+    }
+    cout << endl;
+
+    // Double-ended priority queue use of the cached extremes
+    cout << "min " << ht.min()->first << ", max " << ht.max()->first << endl;
+    cout << "pop_min " << ht.pop_min().first << ", pop_max " << ht.pop_max().first << endl;
+    cout << "min " << ht.min()->first << ", max " << ht.max()->first << endl;
+
+    // Scan-test-delete with erase(iterator), then a range erase
+    for(int i = 10; i < 30; i++) {
+        ht.insert(std::make_pair(i, i));
+    }
+    for(AVLTree<int,int>::iterator it = ht.begin(); it != ht.end(); ) {
+        if(it->first % 3 == 0) {
+            it = ht.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    ht.erase(ht.find(11), ht.find(26));
+    cout << "After erase:";
+    for(AVLTree<int,int>::iterator it = ht.begin(); it != ht.end(); ++it) {
+        cout << " " << it->first;
+    }
+    cout << endl;
+
+    // Batched lookups
+    std::vector<int> keys;
+    keys.push_back(8);
+    keys.push_back(9);
+    keys.push_back(28);
+    std::vector<AVLTree<int,int>::iterator> found;
+    ht.find_batch(keys, found);
+    for(size_t i = 0; i < keys.size(); i++) {
+        cout << keys[i] << (found[i] != ht.end() ? " found" : " not found") << endl;
+    }
+
+    // Sorted batches
+    std::vector<std::pair<int,int> > items;
+    for(int i = 30; i < 40; i += 3) {
+        items.push_back(std::make_pair(i, i * 10));
+    }
+    ht.insert_sorted(items);
+    ht.find_sorted(keys, found);
+    for(size_t i = 0; i < keys.size(); i++) {
+        cout << keys[i] << (found[i] != ht.end() ? " found" : " not found") << endl;
+    }
+    cout << "After insert_sorted:";
+    for(AVLTree<int,int>::iterator it = ht.begin(); it != ht.end(); ++it) {
+        cout << " " << it->first;
+    }
+    cout << endl;
+
     return 0;
 }
@@ -5,6 +5,21 @@
 #include <exception>
 #include <cstdlib>
 #include <utility>
+#include <vector>
+#include <type_traits>
+#include <mutex>
+#include "memoryusage.h"
+
+// Number of lookups find_batch() keeps in flight at once. Enough to
+// cover memory latency, small enough that the slots stay in registers/L1.
+#define BST_BATCH_WIDTH 16
+
+// Hint the CPU to start loading a node we are about to visit.
+#if defined(__GNUC__) || defined(__clang__)
+#define BST_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define BST_PREFETCH(addr)
+#endif
 
 /**
  * A templated class for a Node in a search tree.
@@ -29,6 +44,9 @@ public:
     virtual Node<Key, Value>* getParent() const;
     virtual Node<Key, Value>* getLeft() const;
     virtual Node<Key, Value>* getRight() const;
+    // non-virtual child access by side (false: left, true: right), for
+    // descents that pick the side arithmetically instead of branching
+    Node<Key, Value>* getChild(bool right) const;
 
     void setParent(Node<Key, Value>* parent);
     void setLeft(Node<Key, Value>* left);
@@ -38,8 +56,8 @@ public:
 protected:
     std::pair<const Key, Value> item_;
     Node<Key, Value>* parent_;
-    Node<Key, Value>* left_;
-    Node<Key, Value>* right_;
+    // left, right
+    Node<Key, Value>* children_[2];
 };
 
 /*
@@ -54,10 +72,10 @@ protected:
 template<typename Key, typename Value>
 Node<Key, Value>::Node(const Key& key, const Value& value, Node<Key, Value>* parent) :
     item_(key, value),
-    parent_(parent),
-    left_(NULL),
-    right_(NULL)
+    parent_(parent)
 {
+    children_[0] = NULL;
+    children_[1] = NULL;
 
 }
 
@@ -132,7 +150,7 @@ Node<Key, Value>* Node<Key, Value>::getParent() const
 template<typename Key, typename Value>
 Node<Key, Value>* Node<Key, Value>::getLeft() const
 {
-    return left_;
+    return children_[0];
 }
 
 /**
@@ -141,7 +159,16 @@ Node<Key, Value>* Node<Key, Value>::getLeft() const
 template<typename Key, typename Value>
 Node<Key, Value>* Node<Key, Value>::getRight() const
 {
-    return right_;
+    return children_[1];
+}
+
+/**
+* A non-virtual getter for the left (false) or right (true) child.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* Node<Key, Value>::getChild(bool right) const
+{
+    return children_[right];
 }
 
 /**
@@ -159,7 +186,7 @@ void Node<Key, Value>::setParent(Node<Key, Value>* parent)
 template<typename Key, typename Value>
 void Node<Key, Value>::setLeft(Node<Key, Value>* left)
 {
-    left_ = left;
+    children_[0] = left;
 }
 
 /**
@@ -168,7 +195,7 @@ void Node<Key, Value>::setLeft(Node<Key, Value>* left)
 template<typename Key, typename Value>
 void Node<Key, Value>::setRight(Node<Key, Value>* right)
 {
-    right_ = right;
+    children_[1] = right;
 }
 
 /**
@@ -186,6 +213,97 @@ void Node<Key, Value>::setValue(const Value& value)
   ---------------------------------------
 */
 
+/**
+* The node a plain BinarySearchTree allocates. It also remembers the
+* height of its subtree and whether its two subtrees differ in height by
+* more than one, so the tree can answer isBalanced() without a walk.
+*/
+template <typename Key, typename Value>
+class BSTNode : public Node<Key, Value>
+{
+public:
+    BSTNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual ~BSTNode();
+
+    int getHeight() const;
+    void setHeight(int height);
+    bool isUnbalanced() const;
+    void setUnbalanced(bool unbalanced);
+
+protected:
+    // one word together, so behind a 4-byte key (a set node's) they fill
+    // the padding instead of adding to it
+    unsigned height_ : 31;
+    unsigned unbalanced_ : 1;
+};
+
+/*
+  -----------------------------------------
+  Begin implementations for the BSTNode class.
+  -----------------------------------------
+*/
+
+/**
+* Explicit constructor; a new node is a (balanced) leaf.
+*/
+template<typename Key, typename Value>
+BSTNode<Key, Value>::BSTNode(const Key& key, const Value& value, Node<Key, Value>* parent) :
+    Node<Key, Value>(key, value, parent), height_(1), unbalanced_(false)
+{
+
+}
+
+/**
+* A destructor which does nothing.
+*/
+template<typename Key, typename Value>
+BSTNode<Key, Value>::~BSTNode()
+{
+
+}
+
+/**
+* A getter for the height of the subtree rooted here, 1 for a leaf.
+*/
+template<typename Key, typename Value>
+int BSTNode<Key, Value>::getHeight() const
+{
+    return height_;
+}
+
+/**
+* A setter for the height.
+*/
+template<typename Key, typename Value>
+void BSTNode<Key, Value>::setHeight(int height)
+{
+    height_ = height;
+}
+
+/**
+* True if the subtrees of this node differ in height by more than one.
+*/
+template<typename Key, typename Value>
+bool BSTNode<Key, Value>::isUnbalanced() const
+{
+    return unbalanced_;
+}
+
+/**
+* A setter for the imbalance flag.
+*/
+template<typename Key, typename Value>
+void BSTNode<Key, Value>::setUnbalanced(bool unbalanced)
+{
+    unbalanced_ = unbalanced;
+}
+
+/*
+  ---------------------------------------
+  End implementations for the BSTNode class.
+  ---------------------------------------
+*/
+
 /**
 * A templated unbalanced binary search tree.
 */
@@ -198,9 +316,14 @@ public:
     virtual void insert(const std::pair<const Key, Value>& keyValuePair); //TODO
     virtual void remove(const Key& key); //TODO
     void clear(); //TODO
-    bool isBalanced() const; //TODO
+    // engines answer from what they maintain: O(1) in every tree here
+    virtual bool isBalanced() const; //TODO
     void print() const;
     bool empty() const;
+    // read-only root, for tools that walk the nodes themselves
+    const Node<Key, Value>* getRoot() const;
+    // bytes used by the nodes and what their keys and values own; O(n)
+    MemoryUsage memory_usage() const;
 
     template<typename PPKey, typename PPValue>
     friend void prettyPrintBST(BinarySearchTree<PPKey, PPValue> & tree);
@@ -231,12 +354,31 @@ public:
     iterator begin() const;
     iterator end() const;
     iterator find(const Key& key) const;
+    // looks up many keys at once, out[i] is find(keys[i])
+    void find_batch(const std::vector<Key>& keys, std::vector<iterator>& out) const;
+    // batches of ascending keys, each search starting from the previous result
+    void find_sorted(const std::vector<Key>& keys, std::vector<iterator>& out) const;
+    void insert_sorted(const std::vector<std::pair<Key, Value> >& items);
     Value& operator[](const Key& key);
     Value const & operator[](const Key& key) const;
+    // hinted insert: the new item is placed just before hint if it belongs there
+    virtual iterator insert(iterator hint, const std::pair<const Key, Value>& keyValuePair);
+    // O(1) access to the extremes, end() if the tree is empty
+    iterator min() const;
+    iterator max() const;
+    // remove and return the smallest/largest item
+    std::pair<Key, Value> pop_min();
+    std::pair<Key, Value> pop_max();
+    // remove by position, return the iterator following the removed range
+    iterator erase(iterator pos);
+    iterator erase(iterator first, iterator last);
 
 protected:
     // Mandatory helper functions
     Node<Key, Value>* internalFind(const Key& k) const; // TODO
+    // the descents behind internalFind: generic keys, arithmetic keys
+    Node<Key, Value>* internalFind(const Key& key, std::false_type) const;
+    Node<Key, Value>* internalFind(const Key& key, std::true_type) const;
     Node<Key, Value> *getSmallestNode() const;  // TODO
     static Node<Key, Value>* predecessor(Node<Key, Value>* current); // TODO
     // Note:  static means these functions don't have a "this" pointer
@@ -251,12 +393,66 @@ protected:
     static Node<Key, Value>* successor(Node<Key, Value>* current); // TODO
     // delete subtree -- recursive function
     void deleteSubtree(Node<Key,Value>* current);
-    // isbalancedhelper -- recursive function
-    int isBalancedHelper(Node<Key,Value>* current) const;
+    // height bookkeeping of the plain BST, which makes isBalanced() O(1)
+    static int heightOf(Node<Key, Value>* n);
+    bool refreshHeight(Node<Key, Value>* n) const;
+    void updateHeights(Node<Key, Value>* n, bool stopEarly) const;
+    void settleHeights() const;
+    static void swapHeights(Node<Key, Value>* n1, Node<Key, Value>* n2);
+    void forgetHeight(Node<Key, Value>* n);
+    size_t countUnbalanced(Node<Key, Value>* root) const;
+    // finds the leaf slot a key can be attached to next to the hint, if any
+    Node<Key, Value>* hintedParent(iterator hint, const Key& key, bool& left, Node<Key, Value>*& existing) const;
+    // lets derived trees build iterators from nodes and back
+    iterator iteratorAt(Node<Key, Value>* node) const;
+    static Node<Key, Value>* nodeAt(const iterator& it);
+    // allocates every node of the tree, so derived trees can use their own node type
+    virtual Node<Key, Value>* createNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    // sizeof the nodes createNode allocates, for memory_usage()
+    virtual size_t nodeSize() const;
+    // search for key starting at finger instead of the root
+    Node<Key, Value>* fingerFind(Node<Key, Value>* finger, const Key& key, Node<Key, Value>*& last) const;
+    // adds a leaf in a known free slot (used by hinted and sorted inserts)
+    virtual Node<Key, Value>* attachLeaf(Node<Key, Value>* parent, bool left, const std::pair<const Key, Value>& item);
+    // keeps the cached extremes valid before a node is unlinked
+    void retireExtremes(Node<Key, Value>* node);
+    // told that the items under node (and so under its ancestors) changed
+    virtual void refreshPath(Node<Key, Value>* node);
+    // removes a node that is known to be in the tree
+    virtual void removeNode(Node<Key, Value>* node);
+    // unlinks and deletes the nodes in [first, last) (last may be NULL)
+    virtual void removeRange(Node<Key, Value>* first, Node<Key, Value>* last);
+    // split/join helpers for range operations
+    static void linkLeft(Node<Key, Value>* parent, Node<Key, Value>* child);
+    static void linkRight(Node<Key, Value>* parent, Node<Key, Value>* child);
+    static void splitAt(Node<Key, Value>* root, const Key& key, Node<Key, Value>*& less, Node<Key, Value>*& rest);
+    static Node<Key, Value>* joinTrees(Node<Key, Value>* less, Node<Key, Value>* greater);
 
+    /**
+    * What a plain BST keeps besides its BSTNodes to answer isBalanced().
+    */
+    struct HeightState
+    {
+        // nodes whose subtree heights differ by more than one
+        size_t unbalancedCount;
+        // deepest nodes of the left/right spine whose heights appends at
+        // the extremes left stale, NULL if none; settled before anything else
+        Node<Key, Value>* staleLeft;
+        Node<Key, Value>* staleRight;
+        // held while a const isBalanced() settles those spines, so
+        // concurrent readers do not write the heights at the same time
+        std::mutex settleLock;
+    };
 
 protected:
     Node<Key, Value>* root_;
+    // cached extremes, so begin()/min()/max() and monotonic inserts
+    // skip the spine walk
+    Node<Key, Value>* leftmost_;
+    Node<Key, Value>* rightmost_;
+    // the height bookkeeping, NULL until createNode allocates a BSTNode,
+    // so trees with other node types never carry it
+    HeightState* heights_;
     // You should not need other data members
 };
 
@@ -368,6 +564,9 @@ BinarySearchTree<Key, Value>::BinarySearchTree()
 {
     // TODO
     root_ = NULL;
+    leftmost_ = NULL;
+    rightmost_ = NULL;
+    heights_ = NULL;
 }
 
 template<typename Key, typename Value>
@@ -400,7 +599,7 @@ template<class Key, class Value>
 typename BinarySearchTree<Key, Value>::iterator
 BinarySearchTree<Key, Value>::begin() const
 {
-    BinarySearchTree<Key, Value>::iterator begin(getSmallestNode());
+    BinarySearchTree<Key, Value>::iterator begin(leftmost_);
     return begin;
 }
 
@@ -428,6 +627,125 @@ BinarySearchTree<Key, Value>::find(const Key & k) const
     return it;
 }
 
+/**
+* Looks up every key in keys and stores the results in out (resized to
+* match), out[i] being what find(keys[i]) would return.
+*
+* A single find is a chain of dependent cache misses. Here up to
+* BST_BATCH_WIDTH lookups advance in lockstep, one level per round, and
+* each one prefetches its next node before the others take their turn,
+* so the misses of different lookups overlap instead of queueing.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::find_batch(const std::vector<Key>& keys, std::vector<iterator>& out) const
+{
+    out.resize(keys.size());
+    if(keys.empty()){
+      return;
+    }
+
+    Node<Key, Value>* node[BST_BATCH_WIDTH];
+    size_t index[BST_BATCH_WIDTH];
+    size_t next = 0;
+    int active = 0;
+
+    // fill the slots
+    while(active < BST_BATCH_WIDTH && next < keys.size()){
+      node[active] = root_;
+      index[active] = next++;
+      active++;
+    }
+    BST_PREFETCH(root_);
+
+    while(active > 0){
+      for(int i = 0; i < active; ){
+        Node<Key, Value>* current = node[i];
+        const Key& key = keys[index[i]];
+        bool done = false;
+
+        if(current == NULL){
+          out[index[i]] = iterator(NULL);
+          done = true;
+        }
+        else if(key == current->getKey()){
+          out[index[i]] = iterator(current);
+          done = true;
+        }
+        else {
+          current = (key < current->getKey()) ? current->getLeft() : current->getRight();
+          BST_PREFETCH(current);
+          node[i] = current;
+        }
+
+        if(!done){
+          i++;
+        }
+        // finished: start the next key in this slot, or close the gap
+        else if(next < keys.size()){
+          node[i] = root_;
+          index[i] = next++;
+          i++;
+        }
+        else {
+          active--;
+          node[i] = node[active];
+          index[i] = index[active];
+        }
+      }
+    }
+}
+
+/**
+* Looks up an ascending batch of keys, out[i] being find(keys[i]).
+* Each search starts at the node where the previous one ended and only
+* climbs as far as needed, so k sorted lookups cost O(k log(n/k))
+* instead of O(k log n). Out-of-order keys still work, they just
+* restart at the root.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::find_sorted(const std::vector<Key>& keys, std::vector<iterator>& out) const
+{
+    out.resize(keys.size());
+    Node<Key, Value>* finger = NULL;
+    for(size_t i = 0; i < keys.size(); i++){
+      Node<Key, Value>* last;
+      Node<Key, Value>* found = fingerFind(finger, keys[i], last);
+      out[i] = iterator(found);
+      finger = (found != NULL) ? found : last;
+    }
+}
+
+/**
+* Inserts (or overwrites) an ascending batch of items. Each position is
+* found by a finger search from the previously inserted node and filled
+* through attachLeaf(), so an AVLTree rebalances from the new leaf only,
+* which is O(1) amortized per item.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::insert_sorted(const std::vector<std::pair<Key, Value> >& items)
+{
+    Node<Key, Value>* finger = NULL;
+    for(size_t i = 0; i < items.size(); i++){
+      const std::pair<const Key, Value> item(items[i].first, items[i].second);
+      if(empty()){
+        insert(item);
+        finger = root_;
+        continue;
+      }
+
+      Node<Key, Value>* last;
+      Node<Key, Value>* found = fingerFind(finger, item.first, last);
+      if(found != NULL){
+        found->setValue(item.second);
+        refreshPath(found);
+        finger = found;
+      }
+      else {
+        finger = attachLeaf(last, item.first < last->getKey(), item);
+      }
+    }
+}
+
 /**
  * @precondition The key exists in the map
  * Returns the value associated with the key
@@ -447,6 +765,52 @@ Value const & BinarySearchTree<Key, Value>::operator[](const Key& key) const
     return curr->getValue();
 }
 
+/**
+* Returns an iterator to the smallest item, or end() if the tree is empty
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::min() const
+{
+    return iterator(leftmost_);
+}
+
+/**
+* Returns an iterator to the largest item, or end() if the tree is empty
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::max() const
+{
+    return iterator(rightmost_);
+}
+
+/**
+ * @precondition The tree is not empty
+ * Removes the smallest item and returns a copy of it
+ */
+template<class Key, class Value>
+std::pair<Key, Value> BinarySearchTree<Key, Value>::pop_min()
+{
+    if(leftmost_ == NULL) throw std::out_of_range("Empty tree");
+    std::pair<Key, Value> item(leftmost_->getKey(), leftmost_->getValue());
+    removeNode(leftmost_);
+    return item;
+}
+
+/**
+ * @precondition The tree is not empty
+ * Removes the largest item and returns a copy of it
+ */
+template<class Key, class Value>
+std::pair<Key, Value> BinarySearchTree<Key, Value>::pop_max()
+{
+    if(rightmost_ == NULL) throw std::out_of_range("Empty tree");
+    std::pair<Key, Value> item(rightmost_->getKey(), rightmost_->getValue());
+    removeNode(rightmost_);
+    return item;
+}
+
 /**
 * An insert method to insert into a Binary Search Tree.
 * The tree will not remain balanced when inserting.
@@ -461,12 +825,32 @@ void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &key
 
     // Check if tree is empty
     if(empty()){
-      Node<Key, Value>* newNode = new Node<Key,Value>(keyValuePair.first, keyValuePair.second, NULL);
+      Node<Key, Value>* newNode = createNode(keyValuePair.first, keyValuePair.second, NULL);
       root_ = newNode;
+      leftmost_ = newNode;
+      rightmost_ = newNode;
       // leave the function
       return;
     }
 
+    // Fast path: a new maximum goes straight under the cached rightmost node
+    if(rightmost_->getKey() < keyValuePair.first){
+      Node<Key, Value>* newNode = createNode(keyValuePair.first, keyValuePair.second, rightmost_);
+      rightmost_->setRight(newNode);
+      // stays O(1): the spine's heights are settled when next needed
+      heights_->staleRight = rightmost_;
+      rightmost_ = newNode;
+      return;
+    }
+    // and a new minimum under the cached leftmost node
+    if(keyValuePair.first < leftmost_->getKey()){
+      Node<Key, Value>* newNode = createNode(keyValuePair.first, keyValuePair.second, leftmost_);
+      leftmost_->setLeft(newNode);
+      heights_->staleLeft = leftmost_;
+      leftmost_ = newNode;
+      return;
+    }
+
     // While true
     while(true){
       // if keys are equal 
@@ -481,9 +865,10 @@ void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &key
         // check if left subtree is NULL
         if(current->getLeft()==NULL){
           // create new node (DYNAMIC ALLOCATION)
-          Node<Key, Value>* newNode = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, current);
+          Node<Key, Value>* newNode = createNode(keyValuePair.first, keyValuePair.second, current);
           // set current node (newNode's parent)'s left node
           current->setLeft(newNode);
+          updateHeights(current, true);
 
           // leave the loop and function
           break;
@@ -498,9 +883,10 @@ void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &key
         // check if right subtree is NULL
         if(current->getRight()==NULL){
           // create new node (DYNAMIC ALLOCATION)
-          Node<Key, Value>* newNode = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, current);
+          Node<Key, Value>* newNode = createNode(keyValuePair.first, keyValuePair.second, current);
           // set current node (newNode's parent)'s right node
           current->setRight(newNode);
+          updateHeights(current, true);
 
           // leave the loop and function
           break;
@@ -513,6 +899,98 @@ void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &key
     }
 }
 
+/**
+* Inserts with std::map-style hint semantics: if the key belongs right
+* before hint (or past the maximum when hint is end()), the node is
+* attached without a search from the root. A bad hint falls back to
+* the regular insert. Returns an iterator to the inserted/updated item.
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::insert(iterator hint, const std::pair<const Key, Value> &keyValuePair)
+{
+    bool left = false;
+    Node<Key, Value>* existing = NULL;
+    Node<Key, Value>* parent = hintedParent(hint, keyValuePair.first, left, existing);
+
+    // key already sits next to the hint
+    if(existing != NULL){
+      existing->setValue(keyValuePair.second);
+      refreshPath(existing);
+      return iterator(existing);
+    }
+    // hint is not usable, do a regular insert
+    if(parent == NULL){
+      insert(keyValuePair);
+      return find(keyValuePair.first);
+    }
+
+    return iterator(attachLeaf(parent, left, keyValuePair));
+}
+
+/**
+* Finger search: find key starting from finger (the root if finger is
+* NULL or key is smaller than the finger). We climb only until the
+* current subtree's key range must contain key, then search down.
+* Returns the node or NULL; last is set to the final node visited,
+* which is the parent slot for key when it is missing.
+*/
+template<class Key, class Value>
+Node<Key, Value>*
+BinarySearchTree<Key, Value>::fingerFind(Node<Key, Value>* finger, const Key& key, Node<Key, Value>*& last) const
+{
+    Node<Key, Value>* current = finger;
+    if(current == NULL || key < current->getKey()){
+      current = root_;
+    }
+    else {
+      while(current->getParent() != NULL && current->getKey() < key){
+        Node<Key, Value>* parent = current->getParent();
+        // everything in current's subtree is below parent: key fits here
+        if(parent->getLeft() == current && key < parent->getKey()){
+          break;
+        }
+        current = parent;
+      }
+    }
+
+    last = current;
+    while(current != NULL){
+      last = current;
+      if(key == current->getKey()){
+        return current;
+      }
+      current = (key < current->getKey()) ? current->getLeft() : current->getRight();
+    }
+    return NULL;
+}
+
+/**
+* Hangs a new leaf for item in the given free slot of parent and keeps
+* the cached extremes up to date. Balanced trees override this to fix
+* the tree up from the new leaf.
+*/
+template<class Key, class Value>
+Node<Key, Value>*
+BinarySearchTree<Key, Value>::attachLeaf(Node<Key, Value>* parent, bool left, const std::pair<const Key, Value>& item)
+{
+    Node<Key, Value>* newNode = createNode(item.first, item.second, parent);
+    if(left){
+      parent->setLeft(newNode);
+      if(parent == leftmost_){
+        leftmost_ = newNode;
+      }
+    }
+    else {
+      parent->setRight(newNode);
+      if(parent == rightmost_){
+        rightmost_ = newNode;
+      }
+    }
+    updateHeights(parent, true);
+    return newNode;
+}
+
 
 /**
 * A remove method to remove a specific key from a Binary Search Tree.
@@ -528,6 +1006,100 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
     if(remove == NULL){
       return;
     }
+    removeNode(remove);
+}
+
+/**
+* Removes the item at pos without looking it up again. Nodes are moved,
+* not copied, during removal, so the successor found beforehand is
+* still valid afterwards.
+*/
+template<typename Key, typename Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::erase(iterator pos)
+{
+    Node<Key, Value>* next = successor(pos.current_);
+    removeNode(pos.current_);
+    return iterator(next);
+}
+
+/**
+* Removes every item in [first, last). The range is cut out of the tree
+* in one piece (whole subtrees at a time) instead of node by node.
+*/
+template<typename Key, typename Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::erase(iterator first, iterator last)
+{
+    if(first == last){
+      return last;
+    }
+    // a single item is cheaper to remove directly
+    if(successor(first.current_) == last.current_){
+      return erase(first);
+    }
+
+    Node<Key, Value>* before = predecessor(first.current_);
+    removeRange(first.current_, last.current_);
+
+    // the items around the gap become the new extremes
+    if(before == NULL){
+      leftmost_ = last.current_;
+    }
+    if(last.current_ == NULL){
+      rightmost_ = before;
+    }
+    return last;
+}
+
+/**
+* Unbalanced range removal: split off everything before first, split off
+* everything from last on, free the middle and join the outer parts.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::removeRange(Node<Key, Value>* first, Node<Key, Value>* last)
+{
+    Node<Key, Value>* less;
+    Node<Key, Value>* rest;
+    Node<Key, Value>* middle;
+    Node<Key, Value>* greater = NULL;
+
+    settleHeights();
+    splitAt(root_, first->getKey(), less, rest);
+    if(last != NULL){
+      splitAt(rest, last->getKey(), middle, greater);
+    }
+    else {
+      middle = rest;
+    }
+    heights_->unbalancedCount -= countUnbalanced(middle);
+    deleteSubtree(middle);
+    root_ = joinTrees(less, greater);
+
+    // every relinked node lies on the path from the root down to the
+    // first node after the gap (or the last one before it)
+    Node<Key, Value>* bottom = greater;
+    while(bottom != NULL && bottom->getLeft() != NULL){
+      bottom = bottom->getLeft();
+    }
+    if(bottom == NULL){
+      bottom = less;
+      while(bottom != NULL && bottom->getRight() != NULL){
+        bottom = bottom->getRight();
+      }
+    }
+    updateHeights(bottom, false);
+}
+
+/**
+* Unlinks and deletes a node of this tree. Shared by remove(), pop_min()
+* and pop_max() so callers that already hold the node skip the lookup.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::removeNode(Node<Key, Value>* remove)
+{
+    settleHeights();
+    retireExtremes(remove);
 
     // --- CASE 1: NO CHILDREN
     if(remove->getLeft()==NULL && remove->getRight()==NULL){
@@ -543,6 +1115,7 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
       }
       // remove node
       delete remove;
+      updateHeights(removeParent, true);
       return;
     }
 
@@ -554,12 +1127,14 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
         // promote child
         Node<Key,Value>* child = remove->getLeft();
         nodeSwap(remove, child);
+        swapHeights(remove, child);
       }
       // --- CASE 3: right child only
       else if(remove->getLeft()==NULL){
         // promote child
         Node<Key,Value>* child = remove->getRight();
         nodeSwap(remove, child);
+        swapHeights(remove, child);
       }
 
       // fix the relations
@@ -589,7 +1164,9 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
         removeParent->setLeft(NULL);
         removeParent->setRight(NULL);
       }
+      forgetHeight(remove);
       delete remove;
+      updateHeights(removeParent, true);
       return;
 
     }
@@ -599,7 +1176,9 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
     // two children
     if(remove->getLeft()!=NULL && remove->getRight()!=NULL) {
       // promote predecessor
-      nodeSwap(remove, predecessor(remove));
+      Node<Key,Value>* pred = predecessor(remove);
+      nodeSwap(remove, pred);
+      swapHeights(remove, pred);
     }
 
     // variables
@@ -660,7 +1239,9 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
         }
       }
 
+    forgetHeight(remove);
     delete remove;
+    updateHeights(removeParent, true);
 }
 
 
@@ -680,11 +1261,8 @@ BinarySearchTree<Key, Value>::predecessor(Node<Key, Value>* current)
     }
     // if left child does not exist
     else {
-      current = current->getParent();
-      // if you get to root, there is no predecessor
-      if(current==NULL){
-        return NULL;
-      }
+      // climb while we are a left child; the first parent we reach
+      // from its right side is the predecessor
       // if you get to root, there is no predecessor
       while(current->getParent()!=NULL && current->getParent()->getLeft()==current){
         current = current->getParent();
@@ -727,6 +1305,140 @@ BinarySearchTree<Key, Value>::successor(Node<Key, Value>* current)
     }
 }
 
+/**
+* Finds where a key can be attached as a leaf next to the hint.
+* Returns the parent to attach under (left tells the side), or NULL if
+* the hint is not adjacent to the key. If the key is already stored
+* next to the hint, existing is set instead.
+*/
+template<class Key, class Value>
+Node<Key, Value>*
+BinarySearchTree<Key, Value>::hintedParent(iterator hint, const Key& key, bool& left, Node<Key, Value>*& existing) const
+{
+    Node<Key, Value>* h = hint.current_;
+    existing = NULL;
+
+    if(empty()){
+      return NULL;
+    }
+    // end(): only a new maximum fits
+    if(h == NULL){
+      if(rightmost_->getKey() < key){
+        left = false;
+        return rightmost_;
+      }
+      return NULL;
+    }
+    if(key == h->getKey()){
+      existing = h;
+      return NULL;
+    }
+
+    // key goes before the hint: it must come after the hint's predecessor
+    if(key < h->getKey()){
+      Node<Key, Value>* p = predecessor(h);
+      if(p != NULL && key == p->getKey()){
+        existing = p;
+        return NULL;
+      }
+      if(p != NULL && key < p->getKey()){
+        return NULL;
+      }
+      // either the hint's left slot or the predecessor's right slot is free
+      if(h->getLeft() == NULL){
+        left = true;
+        return h;
+      }
+      left = false;
+      return p;
+    }
+
+    // key goes after the hint: it must come before the hint's successor
+    Node<Key, Value>* s = successor(h);
+    if(s != NULL && key == s->getKey()){
+      existing = s;
+      return NULL;
+    }
+    if(s != NULL && s->getKey() < key){
+      return NULL;
+    }
+    if(h->getRight() == NULL){
+      left = false;
+      return h;
+    }
+    left = true;
+    return s;
+}
+
+/**
+* Wraps a node in an iterator (the iterator constructor is only
+* visible to BinarySearchTree itself).
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::iteratorAt(Node<Key, Value>* node) const
+{
+    return iterator(node);
+}
+
+/**
+* The node an iterator refers to (NULL for end()).
+*/
+template<class Key, class Value>
+Node<Key, Value>*
+BinarySearchTree<Key, Value>::nodeAt(const iterator& it)
+{
+    return it.current_;
+}
+
+/**
+* Allocates a new node, which carries the height bookkeeping behind
+* isBalanced(), and with the first one the tree's share of it.
+* Overridden by trees with richer node types.
+*/
+template<class Key, class Value>
+Node<Key, Value>*
+BinarySearchTree<Key, Value>::createNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    if(heights_ == NULL){
+      // value-initialized: nothing unbalanced, no stale spines
+      heights_ = new HeightState();
+    }
+    return new BSTNode<Key, Value>(key, value, parent);
+}
+
+template<class Key, class Value>
+size_t BinarySearchTree<Key, Value>::nodeSize() const
+{
+    return sizeof(BSTNode<Key, Value>);
+}
+
+/**
+* Called whenever a value is overwritten in place or a node is added or
+* removed below node. Trees that keep per-subtree data recompute it here;
+* this one keeps none.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::refreshPath(Node<Key, Value>* node)
+{
+
+}
+
+/**
+* Must be called before node is unlinked. Moves the cached extremes
+* off the node so they stay valid after the removal.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::retireExtremes(Node<Key, Value>* node)
+{
+    if(node == leftmost_){
+      leftmost_ = successor(node);
+    }
+    if(node == rightmost_){
+      rightmost_ = predecessor(node);
+    }
+}
+
 
 /**
 * A method to remove all contents of the tree and
@@ -738,6 +1450,97 @@ void BinarySearchTree<Key, Value>::clear()
     // TODO
     deleteSubtree(root_);
     root_ = NULL;
+    leftmost_ = NULL;
+    rightmost_ = NULL;
+    delete heights_;
+    heights_ = NULL;
+}
+
+
+// added helper function: set a child and its parent link together
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::linkLeft(Node<Key, Value>* parent, Node<Key, Value>* child)
+{
+  parent->setLeft(child);
+  if(child!=NULL){
+    child->setParent(parent);
+  }
+}
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::linkRight(Node<Key, Value>* parent, Node<Key, Value>* child)
+{
+  parent->setRight(child);
+  if(child!=NULL){
+    child->setParent(parent);
+  }
+}
+
+// added helper function: split a subtree into keys < key and keys >= key.
+// Walks the search path once; nodes left of the path go to less, the
+// rest to rest. Iterative, so degenerate trees are fine.
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::splitAt(Node<Key, Value>* root, const Key& key, Node<Key, Value>*& less, Node<Key, Value>*& rest)
+{
+  less = NULL;
+  rest = NULL;
+  // open slots: right child of lessTail, left child of restTail
+  Node<Key, Value>* lessTail = NULL;
+  Node<Key, Value>* restTail = NULL;
+  Node<Key, Value>* current = root;
+
+  while(current!=NULL){
+    if(current->getKey() < key){
+      // current and its left subtree are all smaller
+      if(lessTail==NULL){
+        less = current;
+        current->setParent(NULL);
+      }
+      else {
+        linkRight(lessTail, current);
+      }
+      lessTail = current;
+      current = current->getRight();
+    }
+    else {
+      // current and its right subtree are all >= key
+      if(restTail==NULL){
+        rest = current;
+        current->setParent(NULL);
+      }
+      else {
+        linkLeft(restTail, current);
+      }
+      restTail = current;
+      current = current->getLeft();
+    }
+  }
+  if(lessTail!=NULL){
+    lessTail->setRight(NULL);
+  }
+  if(restTail!=NULL){
+    restTail->setLeft(NULL);
+  }
+}
+
+// added helper function: join two subtrees where every key in less is
+// smaller than every key in greater, by hanging greater off less's maximum
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::joinTrees(Node<Key, Value>* less, Node<Key, Value>* greater)
+{
+  if(less==NULL){
+    if(greater!=NULL){
+      greater->setParent(NULL);
+    }
+    return greater;
+  }
+  Node<Key, Value>* current = less;
+  while(current->getRight()!=NULL){
+    current = current->getRight();
+  }
+  linkRight(current, greater);
+  less->setParent(NULL);
+  return less;
 }
 
 
@@ -753,6 +1556,34 @@ void BinarySearchTree<Key, Value>::deleteSubtree(Node<Key,Value>* current){
 }
 
 
+/**
+* Returns the root node, or NULL if the tree is empty.
+*/
+template<typename Key, typename Value>
+const Node<Key, Value>*
+BinarySearchTree<Key, Value>::getRoot() const
+{
+    return root_;
+}
+
+/**
+* Reports the memory held by the nodes: their bookkeeping, the stored
+* pairs, the allocator's share of each node, and the heap memory keys and
+* values own (see HeapBytes). Walks the whole tree.
+*/
+template<typename Key, typename Value>
+MemoryUsage BinarySearchTree<Key, Value>::memory_usage() const
+{
+    MemoryUsage usage;
+    size_t nodes = 0;
+    for(iterator it = begin(); it != end(); ++it){
+      usage.addEntry<Key, Value>(*it);
+      nodes++;
+    }
+    usage.addNodes<Key, Value>(nodes, nodeSize());
+    return usage;
+}
+
 /**
 * A helper function to find the smallest node in the tree.
 */
@@ -761,25 +1592,27 @@ Node<Key, Value>*
 BinarySearchTree<Key, Value>::getSmallestNode() const
 {
     // TODO
-    // return NULL if tree is empty
-    if(empty()){
-      return NULL;
-    }
-
-    Node<Key, Value>* current = root_;
-    while(current->getLeft()!=NULL){
-      current = current->getLeft();
-    }
-    return current;
+    // the leftmost node is cached (NULL if tree is empty)
+    return leftmost_;
 }
 
 /**
 * Helper function to find a node with given key, k and
 * return a pointer to it or NULL if no item with that key
-* exists
+* exists. Arithmetic keys (uint64_t, int, double, ...) take the
+* branchless descent.
 */
 template<typename Key, typename Value>
 Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) const
+{
+    return internalFind(key, std::integral_constant<bool, std::is_arithmetic<Key>::value>());
+}
+
+/**
+* The generic descent: stops at the first node with an equal key.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key, std::false_type) const
 {
     // TODO
     Node<Key, Value>* current = root_;
@@ -811,36 +1644,174 @@ Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) con
 }
 
 /**
- * Return true iff the BST is balanced.
+* The descent for arithmetic keys. Comparing them is cheap, so it is the
+* branches that cost: on random lookups every "left or right" is a coin
+* flip the CPU mispredicts. Here the side is an index into the child
+* array and the candidate is kept with a conditional move, so the only
+* branch left is the well-predicted loop test. The equality check waits
+* for the end: the last node whose key is not less than key is the only
+* possible match. The walk always goes down to a leaf, which on a
+* balanced tree is at most a level or two more than stopping early.
+*
+* Without branches the CPU no longer starts loading the next node on a
+* guess, so both children are prefetched while the key is compared;
+* without that, trees bigger than the cache get slower, not faster.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key, std::true_type) const
+{
+    Node<Key, Value>* current = root_;
+    Node<Key, Value>* candidate = NULL;
+    while(current != NULL){
+      BST_PREFETCH(current->getChild(false));
+      BST_PREFETCH(current->getChild(true));
+      bool right = current->getKey() < key;
+      candidate = right ? candidate : current;
+      current = current->getChild(right);
+    }
+    if(candidate != NULL && key == candidate->getKey()){
+      return candidate;
+    }
+    return NULL;
+}
+
+/**
+ * Return true iff the BST is balanced. Inserts and removals keep every
+ * node's height and a count of the unbalanced nodes up to date, so this
+ * is O(1), plus one walk up any spine grown by appends since the last
+ * call.
+ *
+ * That walk writes heights from a const method, so it runs under the
+ * HeightState's settleLock: any number of threads may call isBalanced()
+ * (and other const methods) at once, as long as none of them mutates the
+ * tree. Mutators settle without the lock; they need exclusive access
+ * anyway. A tree that never allocated a node has no HeightState and is
+ * balanced.
  */
 template<typename Key, typename Value>
 bool BinarySearchTree<Key, Value>::isBalanced() const
 {
-    return isBalancedHelper(root_) != -1;
+    if(heights_ == NULL){
+      return true;
+    }
+    std::lock_guard<std::mutex> guard(heights_->settleLock);
+    settleHeights();
+    return heights_->unbalancedCount == 0;
 }
 
+// HELPER: stored height of a possibly empty subtree
 template<typename Key, typename Value>
-int BinarySearchTree<Key, Value>::isBalancedHelper(Node<Key,Value>* current) const
+int BinarySearchTree<Key, Value>::heightOf(Node<Key, Value>* n)
 {
-  // Path ends here
-  if(current==NULL){
-    return 0;
+  return (n == NULL) ? 0 : static_cast<BSTNode<Key, Value>*>(n)->getHeight();
+}
+
+// HELPER: recompute n's height and imbalance flag from its children,
+// keeping the count in step; returns true if the height changed
+template<typename Key, typename Value>
+bool BinarySearchTree<Key, Value>::refreshHeight(Node<Key, Value>* n) const
+{
+  BSTNode<Key, Value>* b = static_cast<BSTNode<Key, Value>*>(n);
+  int leftHeight = heightOf(n->getLeft());
+  int rightHeight = heightOf(n->getRight());
+  bool unbalanced = std::abs(leftHeight - rightHeight) > 1;
+  if(unbalanced != b->isUnbalanced()){
+    b->setUnbalanced(unbalanced);
+    if(unbalanced){
+      heights_->unbalancedCount++;
+    }
+    else {
+      heights_->unbalancedCount--;
+    }
+  }
+  int height = std::max(leftHeight, rightHeight) + 1;
+  if(height == b->getHeight()){
+    return false;
+  }
+  b->setHeight(height);
+  return true;
+}
+
+// HELPER: refresh n and its ancestors. With stopEarly the walk ends at the
+// first node whose height did not change, as nothing above it can have.
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::updateHeights(Node<Key, Value>* n, bool stopEarly) const
+{
+  settleHeights();
+  while(n != NULL){
+    if(!refreshHeight(n) && stopEarly){
+      return;
+    }
+    n = n->getParent();
   }
-  
-  int leftDepth = isBalancedHelper(current->getLeft());
-  if(leftDepth == -1){
-    return -1;
+}
+
+// HELPER: bring the spines grown by appends at the extremes up to date.
+// Each stale spine is one path to the root, refreshed bottom-up like any
+// other insert; the two only share the root, which the second walk
+// recomputes if it gets there.
+// Const callers hold the settleLock (see isBalanced()).
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::settleHeights() const
+{
+  Node<Key, Value>* left = heights_->staleLeft;
+  Node<Key, Value>* right = heights_->staleRight;
+  heights_->staleLeft = NULL;
+  heights_->staleRight = NULL;
+  if(left != NULL){
+    updateHeights(left, true);
   }
-  int rightDepth = isBalancedHelper(current->getRight());
-  if(rightDepth == -1){
-    return -1;
+  if(right != NULL){
+    updateHeights(right, true);
   }
+}
 
-  if(std::abs(leftDepth-rightDepth) > 1){
-    return -1;
+// HELPER: heights belong to positions, so they move with nodeSwap
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::swapHeights(Node<Key, Value>* n1, Node<Key, Value>* n2)
+{
+  BSTNode<Key, Value>* a = static_cast<BSTNode<Key, Value>*>(n1);
+  BSTNode<Key, Value>* b = static_cast<BSTNode<Key, Value>*>(n2);
+  int height = a->getHeight();
+  bool unbalanced = a->isUnbalanced();
+  a->setHeight(b->getHeight());
+  a->setUnbalanced(b->isUnbalanced());
+  b->setHeight(height);
+  b->setUnbalanced(unbalanced);
+}
+
+// HELPER: take a node about to be deleted out of the count
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::forgetHeight(Node<Key, Value>* n)
+{
+  if(static_cast<BSTNode<Key, Value>*>(n)->isUnbalanced()){
+    heights_->unbalancedCount--;
   }
+}
 
-  return std::max(leftDepth, rightDepth) + 1;
+// HELPER: number of unbalanced nodes in a detached subtree
+template<typename Key, typename Value>
+size_t BinarySearchTree<Key, Value>::countUnbalanced(Node<Key, Value>* root) const
+{
+  size_t count = 0;
+  std::vector<Node<Key, Value>*> pending;
+  if(root != NULL){
+    pending.push_back(root);
+  }
+  while(!pending.empty()){
+    Node<Key, Value>* n = pending.back();
+    pending.pop_back();
+    if(static_cast<BSTNode<Key, Value>*>(n)->isUnbalanced()){
+      count++;
+    }
+    if(n->getLeft() != NULL){
+      pending.push_back(n->getLeft());
+    }
+    if(n->getRight() != NULL){
+      pending.push_back(n->getRight());
+    }
+  }
+  return count;
 }
 
 
@@ -0,0 +1,64 @@
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include "bstset.h"
+
+using namespace std;
+
+
+int main(int argc, char *argv[])
+{
+    // AVL set tests
+    AVLSet<int> s;
+    for(int i = 10; i >= 1; i--) {
+        s.insert(i * 10);
+    }
+    s.insert(50);
+    s.remove(30);
+
+    cout << "AVLSet contents:";
+    for(AVLSet<int>::iterator it = s.begin(); it != s.end(); ++it) {
+        cout << " " << *it;
+    }
+    cout << endl;
+    cout << "contains 40: " << s.contains(40) << ", contains 30: " << s.contains(30) << endl;
+    cout << "lower_bound(35) = " << *s.lower_bound(35) << ", upper_bound(40) = " << *s.upper_bound(40) << endl;
+
+    vector<int> keys;
+    s.range(25, 75, keys);
+    cout << "keys in [25, 75):";
+    for(size_t i = 0; i < keys.size(); i++) {
+        cout << " " << keys[i];
+    }
+    cout << endl;
+    s.erase(s.lower_bound(60), s.upper_bound(80));
+    cout << "after erasing [60, 80]: min " << *s.min() << ", max " << *s.max()
+         << ", balanced " << s.isBalanced() << endl;
+
+    // BST set tests
+    BSTSet<int> b;
+    b.insert(2);
+    b.insert(1);
+    b.insert(3);
+    cout << "BSTSet contents:";
+    for(BSTSet<int>::iterator it = b.begin(); it != b.end(); ++it) {
+        cout << " " << *it;
+    }
+    cout << endl;
+    b.print();
+
+    // Per-node footprint compared with a map to char
+    cout << "Bytes per node:" << endl;
+    cout << "AVLNode<uint64_t,char>      " << sizeof(AVLNode<uint64_t,char>) << endl;
+    cout << "AVLNode<uint64_t,SetMember> " << sizeof(AVLNode<uint64_t,SetMember>) << endl;
+    cout << "AVLNode<int,char>           " << sizeof(AVLNode<int,char>) << endl;
+    cout << "AVLNode<int,SetMember>      " << sizeof(AVLNode<int,SetMember>) << endl;
+    cout << "BSTNode<int,char>           " << sizeof(BSTNode<int,char>) << endl;
+    cout << "BSTNode<int,SetMember>      " << sizeof(BSTNode<int,SetMember>) << endl;
+    cout << "BSTNode<uint64_t,char>      " << sizeof(BSTNode<uint64_t,char>) << endl;
+    cout << "BSTNode<uint64_t,SetMember> " << sizeof(BSTNode<uint64_t,SetMember>) << endl;
+    cout << "set memory: ";
+    s.memory_usage().print(cout);
+
+    return 0;
+}
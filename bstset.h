@@ -0,0 +1,692 @@
+#ifndef BSTSET_H
+#define BSTSET_H
+
+#include <iostream>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "bst.h"
+#include "avlbst.h"
+
+/**
+* The value type of set entries: there is none. Trees instantiated with
+* it get the key-only Node below.
+*/
+struct SetMember
+{
+
+};
+
+/**
+* Printing a set entry's value prints nothing.
+*/
+inline std::ostream& operator<<(std::ostream& os, const SetMember& member)
+{
+    return os;
+}
+
+/**
+* The node of a tree used as a set: only the key is stored, no value
+* slot. The key comes after the links so that what a derived node adds
+* (a BST height) can use the padding behind a small key, and the low
+* bits of the parent link, free since nodes are 8-byte aligned, hold a
+* small tag a derived node can use instead of a field (the AVL balance,
+* as CompactAVLTree packs it). Per node, on 64-bit:
+*
+*   AVLNode<uint64_t, SetMember>   40 bytes (AVLNode<uint64_t, char>: 56)
+*   AVLNode<uint32_t, SetMember>   40 bytes (AVLNode<uint32_t, char>: 48)
+*   BSTNode<uint32_t, SetMember>   40 bytes (BSTNode<uint32_t, char>: 48)
+*   BSTNode<uint64_t, SetMember>   48 bytes (BSTNode<uint64_t, char>: 56)
+*
+* A BST height needs a whole word, so with 8-byte keys it still rounds
+* the node up.
+*
+* The tree algorithms only use getKey() and the links, so they work on
+* this node unchanged. getItem() is not provided: the iterators of
+* BinarySearchTree<Key, SetMember> cannot be dereferenced, use the key
+* iterators of TreeSet instead.
+*/
+template <typename Key>
+class Node<Key, SetMember>
+{
+public:
+    Node(const Key& key, const SetMember& value, Node<Key, SetMember>* parent);
+    virtual ~Node();
+
+    const Key& getKey() const;
+    const SetMember& getValue() const;
+
+    virtual Node<Key, SetMember>* getParent() const;
+    virtual Node<Key, SetMember>* getLeft() const;
+    virtual Node<Key, SetMember>* getRight() const;
+    Node<Key, SetMember>* getChild(bool right) const;
+
+    void setParent(Node<Key, SetMember>* parent);
+    void setLeft(Node<Key, SetMember>* left);
+    void setRight(Node<Key, SetMember>* right);
+    void setValue(const SetMember& value);
+
+protected:
+    // the tag kept in the low bits of the parent link
+    static const uintptr_t TAG_MASK = 7;
+    uint8_t getTag() const;
+    void setTag(uint8_t tag);
+
+protected:
+    // parent address | tag
+    uintptr_t parent_;
+    // left, right
+    Node<Key, SetMember>* children_[2];
+    const Key key_;
+    // what getValue() returns for every entry
+    static const SetMember member_;
+};
+
+/*
+  -----------------------------------------
+  Begin implementations for the Node<Key, SetMember> class.
+  -----------------------------------------
+*/
+
+template<typename Key>
+const SetMember Node<Key, SetMember>::member_ = SetMember();
+
+/**
+* Explicit constructor for a node; the value is dropped.
+*/
+template<typename Key>
+Node<Key, SetMember>::Node(const Key& key, const SetMember& value, Node<Key, SetMember>* parent) :
+    parent_(reinterpret_cast<uintptr_t>(parent)),
+    key_(key)
+{
+    children_[0] = NULL;
+    children_[1] = NULL;
+}
+
+/**
+* Destructor, which does not need to do anything.
+*/
+template<typename Key>
+Node<Key, SetMember>::~Node()
+{
+
+}
+
+/**
+* A const getter for the key.
+*/
+template<typename Key>
+const Key& Node<Key, SetMember>::getKey() const
+{
+    return key_;
+}
+
+/**
+* A getter for the (empty) value.
+*/
+template<typename Key>
+const SetMember& Node<Key, SetMember>::getValue() const
+{
+    return member_;
+}
+
+/**
+* An implementation of the virtual function for retreiving the parent.
+*/
+template<typename Key>
+Node<Key, SetMember>* Node<Key, SetMember>::getParent() const
+{
+    return reinterpret_cast<Node<Key, SetMember>*>(parent_ & ~TAG_MASK);
+}
+
+/**
+* An implementation of the virtual function for retreiving the left child.
+*/
+template<typename Key>
+Node<Key, SetMember>* Node<Key, SetMember>::getLeft() const
+{
+    return children_[0];
+}
+
+/**
+* An implementation of the virtual function for retreiving the right child.
+*/
+template<typename Key>
+Node<Key, SetMember>* Node<Key, SetMember>::getRight() const
+{
+    return children_[1];
+}
+
+/**
+* A non-virtual getter for the left (false) or right (true) child.
+*/
+template<typename Key>
+Node<Key, SetMember>* Node<Key, SetMember>::getChild(bool right) const
+{
+    return children_[right];
+}
+
+/**
+* A setter for setting the parent of a node.
+*/
+template<typename Key>
+void Node<Key, SetMember>::setParent(Node<Key, SetMember>* parent)
+{
+    parent_ = reinterpret_cast<uintptr_t>(parent) | (parent_ & TAG_MASK);
+}
+
+/**
+* A setter for setting the left child of a node.
+*/
+template<typename Key>
+void Node<Key, SetMember>::setLeft(Node<Key, SetMember>* left)
+{
+    children_[0] = left;
+}
+
+/**
+* A setter for setting the right child of a node.
+*/
+template<typename Key>
+void Node<Key, SetMember>::setRight(Node<Key, SetMember>* right)
+{
+    children_[1] = right;
+}
+
+/**
+* Setting the value of a set entry does nothing.
+*/
+template<typename Key>
+void Node<Key, SetMember>::setValue(const SetMember& value)
+{
+
+}
+
+/**
+* The tag stored next to the parent link, 0 for a new node.
+*/
+template<typename Key>
+uint8_t Node<Key, SetMember>::getTag() const
+{
+    return static_cast<uint8_t>(parent_ & TAG_MASK);
+}
+
+/**
+* A setter for the tag; the parent link is kept.
+*/
+template<typename Key>
+void Node<Key, SetMember>::setTag(uint8_t tag)
+{
+    parent_ = (parent_ & ~TAG_MASK) | (tag & TAG_MASK);
+}
+
+/*
+  ---------------------------------------
+  End implementations for the Node<Key, SetMember> class.
+  ---------------------------------------
+*/
+
+/**
+* The AVL node of a set: the balance (-2 to 2 while rebalancing) lives in
+* the tag of the parent link, biased by AVL_SET_BALANCE_BIAS, so the node
+* is the links and the key only.
+*/
+#define AVL_SET_BALANCE_BIAS 4
+
+template <typename Key>
+class AVLNode<Key, SetMember> : public Node<Key, SetMember>
+{
+public:
+    AVLNode(const Key& key, const SetMember& value, AVLNode<Key, SetMember>* parent);
+    virtual ~AVLNode();
+
+    int8_t getBalance() const;
+    void setBalance(int8_t balance);
+    void updateBalance(int8_t diff);
+
+    virtual bool refreshAggregate();
+    virtual void swapAggregate(AVLNode<Key, SetMember>* other);
+
+    virtual AVLNode<Key, SetMember>* getParent() const override;
+    virtual AVLNode<Key, SetMember>* getLeft() const override;
+    virtual AVLNode<Key, SetMember>* getRight() const override;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the AVLNode<Key, SetMember> class.
+  -------------------------------------------------
+*/
+
+/**
+* An explicit constructor; a new node is balanced.
+*/
+template<typename Key>
+AVLNode<Key, SetMember>::AVLNode(const Key& key, const SetMember& value, AVLNode<Key, SetMember>* parent) :
+    Node<Key, SetMember>(key, value, parent)
+{
+    this->setTag(AVL_SET_BALANCE_BIAS);
+}
+
+/**
+* A destructor which does nothing.
+*/
+template<typename Key>
+AVLNode<Key, SetMember>::~AVLNode()
+{
+
+}
+
+/**
+* A getter for the balance, unpacked from the tag.
+*/
+template<typename Key>
+int8_t AVLNode<Key, SetMember>::getBalance() const
+{
+    return static_cast<int8_t>(this->getTag()) - AVL_SET_BALANCE_BIAS;
+}
+
+/**
+* A setter for the balance, packed into the tag.
+*/
+template<typename Key>
+void AVLNode<Key, SetMember>::setBalance(int8_t balance)
+{
+    this->setTag(static_cast<uint8_t>(balance + AVL_SET_BALANCE_BIAS));
+}
+
+/**
+* Adds diff to the balance.
+*/
+template<typename Key>
+void AVLNode<Key, SetMember>::updateBalance(int8_t diff)
+{
+    setBalance(getBalance() + diff);
+}
+
+/**
+* Set nodes keep nothing per subtree.
+*/
+template<typename Key>
+bool AVLNode<Key, SetMember>::refreshAggregate()
+{
+    return false;
+}
+
+/**
+* Nothing to trade either.
+*/
+template<typename Key>
+void AVLNode<Key, SetMember>::swapAggregate(AVLNode<Key, SetMember>* other)
+{
+
+}
+
+/**
+* The parent, as an AVLNode.
+*/
+template<typename Key>
+AVLNode<Key, SetMember>* AVLNode<Key, SetMember>::getParent() const
+{
+    return static_cast<AVLNode<Key, SetMember>*>(Node<Key, SetMember>::getParent());
+}
+
+/**
+* The left child, as an AVLNode.
+*/
+template<typename Key>
+AVLNode<Key, SetMember>* AVLNode<Key, SetMember>::getLeft() const
+{
+    return static_cast<AVLNode<Key, SetMember>*>(this->children_[0]);
+}
+
+/**
+* The right child, as an AVLNode.
+*/
+template<typename Key>
+AVLNode<Key, SetMember>* AVLNode<Key, SetMember>::getRight() const
+{
+    return static_cast<AVLNode<Key, SetMember>*>(this->children_[1]);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the AVLNode<Key, SetMember> class.
+  -----------------------------------------------
+*/
+
+/**
+* An ordered set of keys on top of a search tree whose value type is
+* SetMember, so each node stores only its key. Tree is the engine, e.g.
+* BinarySearchTree<Key, SetMember> or AVLTree<Key, SetMember>; it is
+* inherited protected so only the set interface shows.
+*/
+template <typename Key, typename Tree>
+class TreeSet : protected Tree
+{
+public:
+    void insert(const Key& key);
+    bool contains(const Key& key) const;
+    using Tree::remove;
+    using Tree::clear;
+    using Tree::empty;
+    using Tree::isBalanced;
+    using Tree::print;
+    // bytes used by the nodes and what their keys own; O(n)
+    MemoryUsage memory_usage() const;
+
+public:
+    /**
+    * An iterator over the keys of the set, in order.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        const Key& operator*() const;
+        const Key* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class TreeSet<Key, Tree>;
+        explicit iterator(const typename Tree::iterator& it);
+        typename Tree::iterator it_;
+    };
+
+public:
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    // end() if the set is empty
+    iterator min() const;
+    iterator max() const;
+    // range queries: the first key not less than / greater than key
+    iterator lower_bound(const Key& key) const;
+    iterator upper_bound(const Key& key) const;
+    // the keys in [low, high), appended to out
+    void range(const Key& low, const Key& high, std::vector<Key>& out) const;
+    // remove by position, return the iterator following the removed range
+    iterator erase(iterator pos);
+    iterator erase(iterator first, iterator last);
+};
+
+/**
+* An unbalanced binary search tree used as an ordered set.
+*/
+template <typename Key>
+class BSTSet : public TreeSet<Key, BinarySearchTree<Key, SetMember> >
+{
+
+};
+
+/**
+* An AVL tree used as an ordered set.
+*/
+template <typename Key>
+class AVLSet : public TreeSet<Key, AVLTree<Key, SetMember> >
+{
+
+};
+
+/*
+--------------------------------------------------------------
+Begin implementations for the TreeSet::iterator class.
+---------------------------------------------------------------
+*/
+
+/**
+* Explicit constructor that wraps an iterator of the underlying tree.
+*/
+template<class Key, class Tree>
+TreeSet<Key, Tree>::iterator::iterator(const typename Tree::iterator& it) :
+    it_(it)
+{
+
+}
+
+/**
+* A default constructor that initializes the iterator to end().
+*/
+template<class Key, class Tree>
+TreeSet<Key, Tree>::iterator::iterator()
+{
+
+}
+
+/**
+* Provides access to the key.
+*/
+template<class Key, class Tree>
+const Key&
+TreeSet<Key, Tree>::iterator::operator*() const
+{
+    return Tree::nodeAt(it_)->getKey();
+}
+
+/**
+* Provides access to the address of the key.
+*/
+template<class Key, class Tree>
+const Key*
+TreeSet<Key, Tree>::iterator::operator->() const
+{
+    return &(Tree::nodeAt(it_)->getKey());
+}
+
+/**
+* Checks if 'this' iterator's internals have the same value
+* as 'rhs'
+*/
+template<class Key, class Tree>
+bool
+TreeSet<Key, Tree>::iterator::operator==(const iterator& rhs) const
+{
+    return it_ == rhs.it_;
+}
+
+/**
+* Checks if 'this' iterator's internals have a different value
+* as 'rhs'
+*/
+template<class Key, class Tree>
+bool
+TreeSet<Key, Tree>::iterator::operator!=(const iterator& rhs) const
+{
+    return it_ != rhs.it_;
+}
+
+/**
+* Advances to the next key.
+*/
+template<class Key, class Tree>
+typename TreeSet<Key, Tree>::iterator&
+TreeSet<Key, Tree>::iterator::operator++()
+{
+    ++it_;
+    return *this;
+}
+
+/*
+-------------------------------------------------------------
+End implementations for the TreeSet::iterator class.
+-------------------------------------------------------------
+*/
+
+/*
+-----------------------------------------------------
+Begin implementations for the TreeSet class.
+-----------------------------------------------------
+*/
+
+/**
+* Adds key to the set; nothing happens if it is already there.
+*/
+template<class Key, class Tree>
+void TreeSet<Key, Tree>::insert(const Key& key)
+{
+    Tree::insert(std::pair<const Key, SetMember>(key, SetMember()));
+}
+
+/**
+* Returns true if key is in the set.
+*/
+template<class Key, class Tree>
+bool TreeSet<Key, Tree>::contains(const Key& key) const
+{
+    return this->internalFind(key) != NULL;
+}
+
+/**
+* Reports the memory held by the nodes. The payload of a node is just
+* its key.
+*/
+template<class Key, class Tree>
+MemoryUsage TreeSet<Key, Tree>::memory_usage() const
+{
+    MemoryUsage usage;
+    size_t nodes = 0;
+    for(iterator it = begin(); it != end(); ++it){
+      usage.addEntry<Key, SetMember>(*it, SetMember());
+      nodes++;
+    }
+    usage.addNodes(nodes, this->nodeSize(), sizeof(Key));
+    return usage;
+}
+
+/**
+* Returns an iterator to the smallest key.
+*/
+template<class Key, class Tree>
+typename TreeSet<Key, Tree>::iterator
+TreeSet<Key, Tree>::begin() const
+{
+    return iterator(Tree::begin());
+}
+
+/**
+* Returns an iterator whose value means INVALID
+*/
+template<class Key, class Tree>
+typename TreeSet<Key, Tree>::iterator
+TreeSet<Key, Tree>::end() const
+{
+    return iterator(Tree::end());
+}
+
+/**
+* Returns an iterator to key, or end() if it is not in the set.
+*/
+template<class Key, class Tree>
+typename TreeSet<Key, Tree>::iterator
+TreeSet<Key, Tree>::find(const Key& key) const
+{
+    return iterator(Tree::find(key));
+}
+
+/**
+* Returns an iterator to the smallest key in O(1).
+*/
+template<class Key, class Tree>
+typename TreeSet<Key, Tree>::iterator
+TreeSet<Key, Tree>::min() const
+{
+    return iterator(Tree::min());
+}
+
+/**
+* Returns an iterator to the largest key in O(1).
+*/
+template<class Key, class Tree>
+typename TreeSet<Key, Tree>::iterator
+TreeSet<Key, Tree>::max() const
+{
+    return iterator(Tree::max());
+}
+
+/**
+* Returns an iterator to the first key that is not less than key, or
+* end() if there is none. One walk down from the root.
+*/
+template<class Key, class Tree>
+typename TreeSet<Key, Tree>::iterator
+TreeSet<Key, Tree>::lower_bound(const Key& key) const
+{
+    Node<Key, SetMember>* current = this->root_;
+    Node<Key, SetMember>* bound = NULL;
+    while(current != NULL){
+      if(current->getKey() < key){
+        current = current->getRight();
+      }
+      else {
+        bound = current;
+        current = current->getLeft();
+      }
+    }
+    return iterator(this->iteratorAt(bound));
+}
+
+/**
+* Returns an iterator to the first key that is greater than key, or
+* end() if there is none.
+*/
+template<class Key, class Tree>
+typename TreeSet<Key, Tree>::iterator
+TreeSet<Key, Tree>::upper_bound(const Key& key) const
+{
+    Node<Key, SetMember>* current = this->root_;
+    Node<Key, SetMember>* bound = NULL;
+    while(current != NULL){
+      if(key < current->getKey()){
+        bound = current;
+        current = current->getLeft();
+      }
+      else {
+        current = current->getRight();
+      }
+    }
+    return iterator(this->iteratorAt(bound));
+}
+
+/**
+* Appends the keys in [low, high) to out, in order.
+*/
+template<class Key, class Tree>
+void TreeSet<Key, Tree>::range(const Key& low, const Key& high, std::vector<Key>& out) const
+{
+    for(iterator it = lower_bound(low); it != end() && *it < high; ++it){
+      out.push_back(*it);
+    }
+}
+
+/**
+* Removes the key at pos and returns the iterator following it.
+*/
+template<class Key, class Tree>
+typename TreeSet<Key, Tree>::iterator
+TreeSet<Key, Tree>::erase(iterator pos)
+{
+    return iterator(Tree::erase(pos.it_));
+}
+
+/**
+* Removes the keys in [first, last) and returns last.
+*/
+template<class Key, class Tree>
+typename TreeSet<Key, Tree>::iterator
+TreeSet<Key, Tree>::erase(iterator first, iterator last)
+{
+    return iterator(Tree::erase(first.it_, last.it_));
+}
+
+/*
+---------------------------------------------------
+End implementations for the TreeSet class.
+---------------------------------------------------
+*/
+
+#endif
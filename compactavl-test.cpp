@@ -0,0 +1,53 @@
+#include <iostream>
+#include <cstdint>
+#include <string>
+#include "avlbst.h"
+#include "compactavl.h"
+
+using namespace std;
+
+
+int main(int argc, char *argv[])
+{
+    // Compact AVL Tree tests
+    CompactAVLTree<char,int> ct;
+    ct.insert(std::make_pair('a',1));
+    ct.insert(std::make_pair('b',2));
+    ct.insert(std::make_pair('c',3));
+
+    cout << "CompactAVLTree contents:" << endl;
+    for(CompactAVLTree<char,int>::iterator it = ct.begin(); it != ct.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    if(ct.find('b') != ct.end()) {
+        cout << "Found b" << endl;
+    }
+    else {
+        cout << "Did not find b" << endl;
+    }
+    cout << "Erasing b" << endl;
+    ct.remove('b');
+    cout << "Size " << ct.size() << ", balanced " << ct.isBalanced() << endl;
+
+    // Split storage: values in a slab beside the nodes
+    CompactAVLTree<int,string,CompactSplitStorage<int,string> > st;
+    st.insert(std::make_pair(2,string("two")));
+    st.insert(std::make_pair(1,string("one")));
+    st.insert(std::make_pair(3,string("three")));
+    st.find(3)->second = "THREE";
+    st.remove(1);
+    cout << "\nSplit storage contents:" << endl;
+    for(CompactAVLTree<int,string,CompactSplitStorage<int,string> >::iterator it = st.begin(); it != st.end(); ++it) {
+        cout << (*it).first << " " << it->second << endl;
+    }
+    cout << "st[2] = " << st[2] << endl;
+
+    // Per-node footprint with 8-byte keys and values
+    cout << "\nBytes per node (uint64_t -> uint64_t):" << endl;
+    cout << "AVLNode        " << sizeof(AVLNode<uint64_t,uint64_t>) << endl;
+    cout << "CompactAVLNode " << sizeof(CompactAVLNode<uint64_t,uint64_t>) << endl;
+    cout << "CompactAVLKeyNode " << sizeof(CompactAVLKeyNode<uint64_t>) << " (+ "
+         << sizeof(uint64_t) << " in the value slab)" << endl;
+
+    return 0;
+}
@@ -0,0 +1,1286 @@
+#ifndef COMPACTAVL_H
+#define COMPACTAVL_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <new>
+#include "memoryusage.h"
+
+/**
+* The links of a compact AVL node. Nodes live in one contiguous vector and
+* refer to each other by 32-bit index instead of by pointer. The balance
+* is packed into the two spare high bits of the parent link, and there is
+* no vtable.
+*/
+class CompactAVLLinks
+{
+public:
+    // Index used for "no node"; also the largest index that fits in 30 bits.
+    static const uint32_t NIL = 0x3FFFFFFF;
+
+    explicit CompactAVLLinks(uint32_t parent);
+
+    uint32_t getParent() const;
+    uint32_t getLeft() const;
+    uint32_t getRight() const;
+    void setParent(uint32_t parent);
+    void setLeft(uint32_t left);
+    void setRight(uint32_t right);
+
+    int8_t getBalance() const;
+    void setBalance(int8_t balance);
+
+protected:
+    uint32_t parent_;   // low 30 bits: parent index, high 2 bits: balance + 1
+    uint32_t left_;
+    uint32_t right_;
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the CompactAVLLinks class.
+  -----------------------------------------------
+*/
+
+/**
+* Explicit constructor for the links of a new leaf with balance 0.
+*/
+inline CompactAVLLinks::CompactAVLLinks(uint32_t parent) :
+    parent_(parent | (1u << 30)),
+    left_(NIL),
+    right_(NIL)
+{
+
+}
+
+/**
+* A getter for the parent index (NIL for the root).
+*/
+inline uint32_t CompactAVLLinks::getParent() const
+{
+    return parent_ & NIL;
+}
+
+/**
+* A getter for the left child index.
+*/
+inline uint32_t CompactAVLLinks::getLeft() const
+{
+    return left_;
+}
+
+/**
+* A getter for the right child index.
+*/
+inline uint32_t CompactAVLLinks::getRight() const
+{
+    return right_;
+}
+
+/**
+* A setter for the parent index which keeps the packed balance.
+*/
+inline void CompactAVLLinks::setParent(uint32_t parent)
+{
+    parent_ = (parent_ & ~NIL) | parent;
+}
+
+/**
+* A setter for the left child index.
+*/
+inline void CompactAVLLinks::setLeft(uint32_t left)
+{
+    left_ = left;
+}
+
+/**
+* A setter for the right child index.
+*/
+inline void CompactAVLLinks::setRight(uint32_t right)
+{
+    right_ = right;
+}
+
+/**
+* A getter for the balance, unpacked from the high bits of the parent link.
+*/
+inline int8_t CompactAVLLinks::getBalance() const
+{
+    return static_cast<int8_t>(parent_ >> 30) - 1;
+}
+
+/**
+* A setter for the balance. Only -1, 0 and 1 fit, so callers must finish
+* any rotation before storing the result.
+*/
+inline void CompactAVLLinks::setBalance(int8_t balance)
+{
+    parent_ = (parent_ & NIL) | (static_cast<uint32_t>(balance + 1) << 30);
+}
+
+/*
+  ---------------------------------------------
+  End implementations for the CompactAVLLinks class.
+  ---------------------------------------------
+*/
+
+/**
+* A node for the compact AVL tree holding its key/value pair inline. With
+* 8-byte keys and values a node is 32 bytes instead of the 56 (plus
+* allocator header) of a heap-allocated AVLNode.
+*/
+template <typename Key, typename Value>
+class CompactAVLNode : public CompactAVLLinks
+{
+public:
+    CompactAVLNode(const Key& key, const Value& value, uint32_t parent);
+
+    const std::pair<const Key, Value>& getItem() const;
+    std::pair<const Key, Value>& getItem();
+    const Key& getKey() const;
+    const Value& getValue() const;
+    Value& getValue();
+    void setValue(const Value &value);
+
+protected:
+    std::pair<const Key, Value> item_;
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the CompactAVLNode class.
+  -----------------------------------------------
+*/
+
+/**
+* Explicit constructor for a node. New nodes are leaves with balance 0.
+*/
+template<typename Key, typename Value>
+CompactAVLNode<Key, Value>::CompactAVLNode(const Key& key, const Value& value, uint32_t parent) :
+    CompactAVLLinks(parent),
+    item_(key, value)
+{
+
+}
+
+/**
+* A const getter for the item.
+*/
+template<typename Key, typename Value>
+const std::pair<const Key, Value>& CompactAVLNode<Key, Value>::getItem() const
+{
+    return item_;
+}
+
+/**
+* A non-const getter for the item.
+*/
+template<typename Key, typename Value>
+std::pair<const Key, Value>& CompactAVLNode<Key, Value>::getItem()
+{
+    return item_;
+}
+
+/**
+* A const getter for the key.
+*/
+template<typename Key, typename Value>
+const Key& CompactAVLNode<Key, Value>::getKey() const
+{
+    return item_.first;
+}
+
+/**
+* A const getter for the value.
+*/
+template<typename Key, typename Value>
+const Value& CompactAVLNode<Key, Value>::getValue() const
+{
+    return item_.second;
+}
+
+/**
+* A non-const getter for the value.
+*/
+template<typename Key, typename Value>
+Value& CompactAVLNode<Key, Value>::getValue()
+{
+    return item_.second;
+}
+
+/**
+* A setter for the value of a node.
+*/
+template<typename Key, typename Value>
+void CompactAVLNode<Key, Value>::setValue(const Value& value)
+{
+    item_.second = value;
+}
+
+/*
+  ---------------------------------------------
+  End implementations for the CompactAVLNode class.
+  ---------------------------------------------
+*/
+
+/**
+* A node for the compact AVL tree holding only its key; the value lives
+* in a separate slab at the same index (see CompactSplitStorage).
+*/
+template <typename Key>
+class CompactAVLKeyNode : public CompactAVLLinks
+{
+public:
+    CompactAVLKeyNode(const Key& key, uint32_t parent);
+
+    const Key& getKey() const;
+
+protected:
+    const Key key_;
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the CompactAVLKeyNode class.
+  -----------------------------------------------
+*/
+
+/**
+* Explicit constructor for a node. New nodes are leaves with balance 0.
+*/
+template<typename Key>
+CompactAVLKeyNode<Key>::CompactAVLKeyNode(const Key& key, uint32_t parent) :
+    CompactAVLLinks(parent),
+    key_(key)
+{
+
+}
+
+/**
+* A const getter for the key.
+*/
+template<typename Key>
+const Key& CompactAVLKeyNode<Key>::getKey() const
+{
+    return key_;
+}
+
+/*
+  ---------------------------------------------
+  End implementations for the CompactAVLKeyNode class.
+  ---------------------------------------------
+*/
+
+/**
+* Storage policy for CompactAVLTree keeping each key/value pair inside its
+* node. Iterators hand out references to the std::pair itself. This is the
+* default, and the better choice while values are small.
+*
+* A storage policy decides the node type and owns whatever lives outside
+* the node vector; the tree calls it whenever a slot is added, released or
+* its item is needed.
+*/
+template <typename Key, typename Value>
+class CompactInlineStorage
+{
+public:
+    typedef CompactAVLNode<Key, Value> NodeType;
+    typedef std::pair<const Key, Value>& reference;
+    typedef std::pair<const Key, Value>* pointer;
+
+    void append(std::vector<NodeType>& nodes, const std::pair<const Key, Value>& item, uint32_t parent);
+    void release(uint32_t i, uint32_t last);
+    void clear();
+    void reserve(size_t n);
+
+    Value& value(std::vector<NodeType>& nodes, uint32_t i);
+    reference item(std::vector<NodeType>& nodes, uint32_t i);
+    pointer address(std::vector<NodeType>& nodes, uint32_t i);
+    void addUsage(MemoryUsage& usage, const std::vector<NodeType>& nodes) const;
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the CompactInlineStorage class.
+  -----------------------------------------------
+*/
+
+/**
+* Appends a new leaf holding item.
+*/
+template<typename Key, typename Value>
+void CompactInlineStorage<Key, Value>::append(std::vector<NodeType>& nodes, const std::pair<const Key, Value>& item, uint32_t parent)
+{
+    nodes.push_back(NodeType(item.first, item.second, parent));
+}
+
+/**
+* Slot i takes over the node in slot last; the value moves with its node.
+*/
+template<typename Key, typename Value>
+void CompactInlineStorage<Key, Value>::release(uint32_t i, uint32_t last)
+{
+
+}
+
+/**
+* Nothing is held outside the nodes.
+*/
+template<typename Key, typename Value>
+void CompactInlineStorage<Key, Value>::clear()
+{
+
+}
+
+/**
+* Nothing is held outside the nodes.
+*/
+template<typename Key, typename Value>
+void CompactInlineStorage<Key, Value>::reserve(size_t n)
+{
+
+}
+
+/**
+* The value of the node at index i.
+*/
+template<typename Key, typename Value>
+Value& CompactInlineStorage<Key, Value>::value(std::vector<NodeType>& nodes, uint32_t i)
+{
+    return nodes[i].getValue();
+}
+
+/**
+* The item of the node at index i, as iterators return it.
+*/
+template<typename Key, typename Value>
+typename CompactInlineStorage<Key, Value>::reference
+CompactInlineStorage<Key, Value>::item(std::vector<NodeType>& nodes, uint32_t i)
+{
+    return nodes[i].getItem();
+}
+
+/**
+* The address of the item of the node at index i.
+*/
+template<typename Key, typename Value>
+typename CompactInlineStorage<Key, Value>::pointer
+CompactInlineStorage<Key, Value>::address(std::vector<NodeType>& nodes, uint32_t i)
+{
+    return &nodes[i].getItem();
+}
+
+/**
+* Counts the node storage. All nodes share one block, so the slack is the
+* unused capacity plus the allocator's share of that block.
+*/
+template<typename Key, typename Value>
+void CompactInlineStorage<Key, Value>::addUsage(MemoryUsage& usage, const std::vector<NodeType>& nodes) const
+{
+    for(size_t i = 0; i < nodes.size(); i++){
+      usage.addEntry<Key, Value>(nodes[i].getItem());
+    }
+    size_t payload = sizeof(std::pair<const Key, Value>);
+    size_t capacity = nodes.capacity() * sizeof(NodeType);
+    usage.headerBytes += nodes.size() * (sizeof(NodeType) - payload);
+    usage.payloadBytes += nodes.size() * payload;
+    usage.slackBytes += (nodes.capacity() - nodes.size()) * sizeof(NodeType)
+                        + mallocBlockBytes(capacity) - capacity;
+}
+
+/*
+  ---------------------------------------------
+  End implementations for the CompactInlineStorage class.
+  ---------------------------------------------
+*/
+
+/**
+* What a CompactSplitStorage iterator points at: the key and value of one
+* entry, accessed like a std::pair through first and second.
+*/
+template <typename Key, typename Value>
+struct CompactSplitItem
+{
+    CompactSplitItem(const Key& key, Value& value) :
+        first(key), second(value)
+    {
+
+    }
+
+    // a copy of the entry as a real pair
+    operator std::pair<const Key, Value>() const
+    {
+        return std::pair<const Key, Value>(first, second);
+    }
+
+    const Key& first;
+    Value& second;
+};
+
+/**
+* What a CompactSplitStorage iterator's operator-> returns: it holds the
+* item, so it->first and it->second work as they do on a pair pointer.
+*/
+template <typename Key, typename Value>
+class CompactSplitItemPointer
+{
+public:
+    explicit CompactSplitItemPointer(const CompactSplitItem<Key, Value>& item) :
+        item_(item)
+    {
+
+    }
+
+    const CompactSplitItem<Key, Value>* operator->() const
+    {
+        return &item_;
+    }
+
+protected:
+    CompactSplitItem<Key, Value> item_;
+};
+
+/**
+* Storage policy for CompactAVLTree keeping keys and links in small, hot
+* nodes and the values in a separate slab. The value of the node at index
+* i is slab entry i, so no extra link is stored: the slab moves in step
+* with the node vector when a remove compacts it. Searches and rotations
+* read and write only the nodes, so with large values many more of them
+* fit in cache. Iterators hand out a CompactSplitItem instead of a
+* reference to a std::pair.
+*/
+template <typename Key, typename Value>
+class CompactSplitStorage
+{
+public:
+    typedef CompactAVLKeyNode<Key> NodeType;
+    typedef CompactSplitItem<Key, Value> reference;
+    typedef CompactSplitItemPointer<Key, Value> pointer;
+
+    void append(std::vector<NodeType>& nodes, const std::pair<const Key, Value>& item, uint32_t parent);
+    void release(uint32_t i, uint32_t last);
+    void clear();
+    void reserve(size_t n);
+
+    Value& value(std::vector<NodeType>& nodes, uint32_t i);
+    reference item(std::vector<NodeType>& nodes, uint32_t i);
+    pointer address(std::vector<NodeType>& nodes, uint32_t i);
+    void addUsage(MemoryUsage& usage, const std::vector<NodeType>& nodes) const;
+
+protected:
+    std::vector<Value> values_;
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the CompactSplitStorage class.
+  -----------------------------------------------
+*/
+
+/**
+* Appends a new leaf holding item's key, and its value to the slab.
+*/
+template<typename Key, typename Value>
+void CompactSplitStorage<Key, Value>::append(std::vector<NodeType>& nodes, const std::pair<const Key, Value>& item, uint32_t parent)
+{
+    nodes.push_back(NodeType(item.first, parent));
+    values_.push_back(item.second);
+}
+
+/**
+* Slot i takes over the node in slot last, so its value follows it.
+*/
+template<typename Key, typename Value>
+void CompactSplitStorage<Key, Value>::release(uint32_t i, uint32_t last)
+{
+    if(i != last){
+      values_[i] = values_[last];
+    }
+    values_.pop_back();
+}
+
+/**
+* Empties the slab.
+*/
+template<typename Key, typename Value>
+void CompactSplitStorage<Key, Value>::clear()
+{
+    values_.clear();
+}
+
+/**
+* Pre-sizes the slab along with the nodes.
+*/
+template<typename Key, typename Value>
+void CompactSplitStorage<Key, Value>::reserve(size_t n)
+{
+    values_.reserve(n);
+}
+
+/**
+* The value of the node at index i.
+*/
+template<typename Key, typename Value>
+Value& CompactSplitStorage<Key, Value>::value(std::vector<NodeType>& nodes, uint32_t i)
+{
+    return values_[i];
+}
+
+/**
+* The key and value of the node at index i, as iterators return them.
+*/
+template<typename Key, typename Value>
+typename CompactSplitStorage<Key, Value>::reference
+CompactSplitStorage<Key, Value>::item(std::vector<NodeType>& nodes, uint32_t i)
+{
+    return reference(nodes[i].getKey(), values_[i]);
+}
+
+/**
+* A pointer-like handle on the item of the node at index i.
+*/
+template<typename Key, typename Value>
+typename CompactSplitStorage<Key, Value>::pointer
+CompactSplitStorage<Key, Value>::address(std::vector<NodeType>& nodes, uint32_t i)
+{
+    return pointer(item(nodes, i));
+}
+
+/**
+* Counts the node storage and the slab. Keys and values both count as
+* payload; each of the two blocks adds its own slack.
+*/
+template<typename Key, typename Value>
+void CompactSplitStorage<Key, Value>::addUsage(MemoryUsage& usage, const std::vector<NodeType>& nodes) const
+{
+    for(size_t i = 0; i < nodes.size(); i++){
+      usage.addEntry<Key, Value>(nodes[i].getKey(), values_[i]);
+    }
+    size_t nodeCapacity = nodes.capacity() * sizeof(NodeType);
+    size_t valueCapacity = values_.capacity() * sizeof(Value);
+    usage.headerBytes += nodes.size() * (sizeof(NodeType) - sizeof(Key));
+    usage.payloadBytes += nodes.size() * (sizeof(Key) + sizeof(Value));
+    usage.slackBytes += (nodes.capacity() - nodes.size()) * sizeof(NodeType)
+                        + mallocBlockBytes(nodeCapacity) - nodeCapacity
+                        + (values_.capacity() - values_.size()) * sizeof(Value)
+                        + mallocBlockBytes(valueCapacity) - valueCapacity;
+}
+
+/*
+  ---------------------------------------------
+  End implementations for the CompactSplitStorage class.
+  ---------------------------------------------
+*/
+
+/**
+* An AVL tree with the same public interface as AVLTree, storing its
+* nodes in a contiguous vector with 32-bit links.
+*
+* Inserting never invalidates iterators (they hold an index, not an
+* address). Removing moves the last node into the freed slot to keep the
+* storage dense, so iterators other than the one returned are invalid
+* after a remove.
+*
+* The Storage policy decides where values live: CompactInlineStorage (the
+* default) keeps them in the nodes, CompactSplitStorage in a separate slab
+* so that searches only touch keys and links.
+*/
+template <typename Key, typename Value, typename Storage = CompactInlineStorage<Key, Value> >
+class CompactAVLTree
+{
+public:
+    typedef typename Storage::NodeType NodeType;
+    typedef typename Storage::reference reference;
+    typedef typename Storage::pointer pointer;
+    static const uint32_t NIL = CompactAVLLinks::NIL;
+
+    CompactAVLTree();
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool isBalanced() const;
+    bool empty() const;
+    size_t size() const;
+    // pre-size the node storage, so bulk loads do not over-allocate
+    void reserve(size_t n);
+    // bytes used by the node storage and what keys and values own; O(n)
+    MemoryUsage memory_usage() const;
+
+public:
+    /**
+    * An iterator over the contents of the tree, in key order.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        reference operator*() const;
+        pointer operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class CompactAVLTree<Key, Value, Storage>;
+        iterator(std::vector<NodeType>* nodes, Storage* storage, uint32_t index);
+        std::vector<NodeType>* nodes_;
+        Storage* storage_;
+        uint32_t current_;
+    };
+
+public:
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    uint32_t internalFind(const Key& key) const;
+    uint32_t successor(uint32_t current) const;
+    uint32_t predecessor(uint32_t current) const;
+
+    //HELPERS:
+    NodeType& node(uint32_t i);
+    const NodeType& node(uint32_t i) const;
+    uint32_t newNode(const std::pair<const Key, Value>& item, uint32_t parent);
+    void replaceChild(uint32_t parent, uint32_t oldChild, uint32_t newChild);
+    void releaseNode(uint32_t i);
+    void insertFix(uint32_t p, uint32_t n);
+    void removeFix(uint32_t n, int diff);
+    void rotateLeft(uint32_t n);
+    void rotateRight(uint32_t n);
+
+protected:
+    // mutable so const begin()/find() can hand out mutable iterators,
+    // like BinarySearchTree does with its node pointers
+    mutable std::vector<NodeType> nodes_;
+    mutable Storage storage_;
+    uint32_t root_;
+};
+
+template<typename Key, typename Value, typename Storage>
+const uint32_t CompactAVLTree<Key, Value, Storage>::NIL;
+
+/*
+--------------------------------------------------------------
+Begin implementations for the CompactAVLTree::iterator class.
+---------------------------------------------------------------
+*/
+
+/**
+* Explicit constructor that initializes an iterator with a node index.
+*/
+template<class Key, class Value, class Storage>
+CompactAVLTree<Key, Value, Storage>::iterator::iterator(std::vector<NodeType>* nodes, Storage* storage, uint32_t index) :
+    nodes_(nodes), storage_(storage), current_(index)
+{
+
+}
+
+/**
+* A default constructor that initializes the iterator to end().
+*/
+template<class Key, class Value, class Storage>
+CompactAVLTree<Key, Value, Storage>::iterator::iterator() :
+    nodes_(NULL), storage_(NULL), current_(NIL)
+{
+
+}
+
+/**
+* Provides access to the item.
+*/
+template<class Key, class Value, class Storage>
+typename CompactAVLTree<Key, Value, Storage>::reference
+CompactAVLTree<Key, Value, Storage>::iterator::operator*() const
+{
+    return storage_->item(*nodes_, current_);
+}
+
+/**
+* Provides access to the address of the item.
+*/
+template<class Key, class Value, class Storage>
+typename CompactAVLTree<Key, Value, Storage>::pointer
+CompactAVLTree<Key, Value, Storage>::iterator::operator->() const
+{
+    return storage_->address(*nodes_, current_);
+}
+
+/**
+* Checks if 'this' iterator's internals have the same value
+* as 'rhs'
+*/
+template<class Key, class Value, class Storage>
+bool
+CompactAVLTree<Key, Value, Storage>::iterator::operator==(const iterator& rhs) const
+{
+    return current_ == rhs.current_;
+}
+
+/**
+* Checks if 'this' iterator's internals have a different value
+* as 'rhs'
+*/
+template<class Key, class Value, class Storage>
+bool
+CompactAVLTree<Key, Value, Storage>::iterator::operator!=(const iterator& rhs) const
+{
+    return current_ != rhs.current_;
+}
+
+/**
+* Advances the iterator's location using an in-order sequencing
+*/
+template<class Key, class Value, class Storage>
+typename CompactAVLTree<Key, Value, Storage>::iterator&
+CompactAVLTree<Key, Value, Storage>::iterator::operator++()
+{
+    std::vector<NodeType>& nodes = *nodes_;
+    if(nodes[current_].getRight() != NIL){
+      current_ = nodes[current_].getRight();
+      while(nodes[current_].getLeft() != NIL){
+        current_ = nodes[current_].getLeft();
+      }
+      return *this;
+    }
+    // climb while we are a right child
+    uint32_t parent = nodes[current_].getParent();
+    while(parent != NIL && nodes[parent].getRight() == current_){
+      current_ = parent;
+      parent = nodes[parent].getParent();
+    }
+    current_ = parent;
+    return *this;
+}
+
+/*
+-------------------------------------------------------------
+End implementations for the CompactAVLTree::iterator class.
+-------------------------------------------------------------
+*/
+
+/*
+-----------------------------------------------------
+Begin implementations for the CompactAVLTree class.
+-----------------------------------------------------
+*/
+
+/**
+* Default constructor for an empty tree.
+*/
+template<class Key, class Value, class Storage>
+CompactAVLTree<Key, Value, Storage>::CompactAVLTree() :
+    root_(NIL)
+{
+
+}
+
+/**
+ * Returns true if tree is empty
+*/
+template<class Key, class Value, class Storage>
+bool CompactAVLTree<Key, Value, Storage>::empty() const
+{
+    return root_ == NIL;
+}
+
+/**
+ * Returns the number of items (the storage is always dense)
+*/
+template<class Key, class Value, class Storage>
+size_t CompactAVLTree<Key, Value, Storage>::size() const
+{
+    return nodes_.size();
+}
+
+template<class Key, class Value, class Storage>
+void CompactAVLTree<Key, Value, Storage>::reserve(size_t n)
+{
+    nodes_.reserve(n);
+    storage_.reserve(n);
+}
+
+/**
+* Reports the memory held by the node storage and, with split storage,
+* the value slab.
+*/
+template<class Key, class Value, class Storage>
+MemoryUsage CompactAVLTree<Key, Value, Storage>::memory_usage() const
+{
+    MemoryUsage usage;
+    storage_.addUsage(usage, nodes_);
+    return usage;
+}
+
+/**
+* Removes all contents of the tree.
+*/
+template<class Key, class Value, class Storage>
+void CompactAVLTree<Key, Value, Storage>::clear()
+{
+    nodes_.clear();
+    storage_.clear();
+    root_ = NIL;
+}
+
+/**
+* Returns an iterator to the "smallest" item in the tree
+*/
+template<class Key, class Value, class Storage>
+typename CompactAVLTree<Key, Value, Storage>::iterator
+CompactAVLTree<Key, Value, Storage>::begin() const
+{
+    uint32_t current = root_;
+    if(current != NIL){
+      while(node(current).getLeft() != NIL){
+        current = node(current).getLeft();
+      }
+    }
+    return iterator(&nodes_, &storage_, current);
+}
+
+/**
+* Returns an iterator whose value means INVALID
+*/
+template<class Key, class Value, class Storage>
+typename CompactAVLTree<Key, Value, Storage>::iterator
+CompactAVLTree<Key, Value, Storage>::end() const
+{
+    return iterator(&nodes_, &storage_, NIL);
+}
+
+/**
+* Returns an iterator to the item with the given key, k
+* or the end iterator if k does not exist in the tree
+*/
+template<class Key, class Value, class Storage>
+typename CompactAVLTree<Key, Value, Storage>::iterator
+CompactAVLTree<Key, Value, Storage>::find(const Key& key) const
+{
+    return iterator(&nodes_, &storage_, internalFind(key));
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value, class Storage>
+Value& CompactAVLTree<Key, Value, Storage>::operator[](const Key& key)
+{
+    uint32_t curr = internalFind(key);
+    if(curr == NIL) throw std::out_of_range("Invalid key");
+    return storage_.value(nodes_, curr);
+}
+template<class Key, class Value, class Storage>
+Value const & CompactAVLTree<Key, Value, Storage>::operator[](const Key& key) const
+{
+    uint32_t curr = internalFind(key);
+    if(curr == NIL) throw std::out_of_range("Invalid key");
+    return storage_.value(nodes_, curr);
+}
+
+/**
+ * Return true iff the tree is balanced. Inserts and removals rebalance
+ * before they return, so this is O(1).
+ */
+template<class Key, class Value, class Storage>
+bool CompactAVLTree<Key, Value, Storage>::isBalanced() const
+{
+    return true;
+}
+
+/**
+* Helper function to find a node with given key and return its index,
+* or NIL if no item with that key exists
+*/
+template<class Key, class Value, class Storage>
+uint32_t CompactAVLTree<Key, Value, Storage>::internalFind(const Key& key) const
+{
+    uint32_t current = root_;
+    while(current != NIL){
+      const NodeType& n = node(current);
+      if(key == n.getKey()){
+        return current;
+      }
+      current = (key < n.getKey()) ? n.getLeft() : n.getRight();
+    }
+    return NIL;
+}
+
+template<class Key, class Value, class Storage>
+uint32_t CompactAVLTree<Key, Value, Storage>::successor(uint32_t current) const
+{
+    if(node(current).getRight() != NIL){
+      current = node(current).getRight();
+      while(node(current).getLeft() != NIL){
+        current = node(current).getLeft();
+      }
+      return current;
+    }
+    uint32_t parent = node(current).getParent();
+    while(parent != NIL && node(parent).getRight() == current){
+      current = parent;
+      parent = node(parent).getParent();
+    }
+    return parent;
+}
+
+template<class Key, class Value, class Storage>
+uint32_t CompactAVLTree<Key, Value, Storage>::predecessor(uint32_t current) const
+{
+    if(node(current).getLeft() != NIL){
+      current = node(current).getLeft();
+      while(node(current).getRight() != NIL){
+        current = node(current).getRight();
+      }
+      return current;
+    }
+    uint32_t parent = node(current).getParent();
+    while(parent != NIL && node(parent).getLeft() == current){
+      current = parent;
+      parent = node(parent).getParent();
+    }
+    return parent;
+}
+
+// HELPER: node access by index
+template<class Key, class Value, class Storage>
+typename CompactAVLTree<Key, Value, Storage>::NodeType&
+CompactAVLTree<Key, Value, Storage>::node(uint32_t i)
+{
+    return nodes_[i];
+}
+
+template<class Key, class Value, class Storage>
+const typename CompactAVLTree<Key, Value, Storage>::NodeType&
+CompactAVLTree<Key, Value, Storage>::node(uint32_t i) const
+{
+    return nodes_[i];
+}
+
+// HELPER: append a new leaf to the node storage
+template<class Key, class Value, class Storage>
+uint32_t CompactAVLTree<Key, Value, Storage>::newNode(const std::pair<const Key, Value>& item, uint32_t parent)
+{
+    if(nodes_.size() >= NIL){
+      throw std::length_error("CompactAVLTree is full");
+    }
+    storage_.append(nodes_, item, parent);
+    return static_cast<uint32_t>(nodes_.size() - 1);
+}
+
+// HELPER: point parent's link (or the root) at newChild instead of oldChild
+template<class Key, class Value, class Storage>
+void CompactAVLTree<Key, Value, Storage>::replaceChild(uint32_t parent, uint32_t oldChild, uint32_t newChild)
+{
+    if(parent == NIL){
+      root_ = newChild;
+    }
+    else if(node(parent).getLeft() == oldChild){
+      node(parent).setLeft(newChild);
+    }
+    else {
+      node(parent).setRight(newChild);
+    }
+    if(newChild != NIL){
+      node(newChild).setParent(parent);
+    }
+}
+
+// HELPER: free an unlinked slot by moving the last node into it
+template<class Key, class Value, class Storage>
+void CompactAVLTree<Key, Value, Storage>::releaseNode(uint32_t i)
+{
+    uint32_t last = static_cast<uint32_t>(nodes_.size() - 1);
+    if(i != last){
+      NodeType& moved = node(last);
+      // re-point everything that refers to the last slot
+      uint32_t parent = moved.getParent();
+      if(parent == NIL){
+        root_ = i;
+      }
+      else if(node(parent).getLeft() == last){
+        node(parent).setLeft(i);
+      }
+      else {
+        node(parent).setRight(i);
+      }
+      if(moved.getLeft() != NIL){
+        node(moved.getLeft()).setParent(i);
+      }
+      if(moved.getRight() != NIL){
+        node(moved.getRight()).setParent(i);
+      }
+      // the key is const, so the slot is rebuilt rather than assigned
+      nodes_[i].~NodeType();
+      new (&nodes_[i]) NodeType(moved);
+    }
+    storage_.release(i, last);
+    nodes_.pop_back();
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ */
+template<class Key, class Value, class Storage>
+void CompactAVLTree<Key, Value, Storage>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    if(root_ == NIL){
+      root_ = newNode(keyValuePair, NIL);
+      return;
+    }
+
+    uint32_t current = root_;
+    while(true){
+      if(keyValuePair.first == node(current).getKey()){
+        storage_.value(nodes_, current) = keyValuePair.second;
+        return;
+      }
+      bool left = keyValuePair.first < node(current).getKey();
+      uint32_t next = left ? node(current).getLeft() : node(current).getRight();
+      if(next != NIL){
+        current = next;
+        continue;
+      }
+
+      // attach the new leaf (indices stay valid if the vector grows)
+      uint32_t n = newNode(keyValuePair, current);
+      int balance = node(current).getBalance();
+      if(left){
+        node(current).setLeft(n);
+        balance--;
+      }
+      else {
+        node(current).setRight(n);
+        balance++;
+      }
+      node(current).setBalance(balance);
+      // parent went from even to leaning: its height grew
+      if(balance != 0){
+        insertFix(current, n);
+      }
+      return;
+    }
+}
+
+// HELPER: p's subtree (containing child n) grew by one; fix upward
+template<class Key, class Value, class Storage>
+void CompactAVLTree<Key, Value, Storage>::insertFix(uint32_t p, uint32_t n)
+{
+    uint32_t g = node(p).getParent();
+    if(g == NIL){
+      return;
+    }
+
+    bool pIsLeft = node(g).getLeft() == p;
+    int gBalance = node(g).getBalance() + (pIsLeft ? -1 : 1);
+
+    if(gBalance == 0){
+      node(g).setBalance(0);
+      return;
+    }
+    if(gBalance == -1 || gBalance == 1){
+      node(g).setBalance(gBalance);
+      insertFix(g, p); // recurse
+      return;
+    }
+
+    // gBalance is -2 or 2 (never stored, it does not fit the packed bits)
+    int nBalance = node(n).getBalance();
+    if(pIsLeft){
+      // zig-zig
+      if(node(p).getLeft() == n){
+        rotateRight(g);
+        node(p).setBalance(0);
+        node(g).setBalance(0);
+      }
+      // zig-zag
+      else {
+        rotateLeft(p);
+        rotateRight(g);
+        node(p).setBalance(nBalance == 1 ? -1 : 0);
+        node(g).setBalance(nBalance == -1 ? 1 : 0);
+        node(n).setBalance(0);
+      }
+    }
+    else {
+      // zig-zig
+      if(node(p).getRight() == n){
+        rotateLeft(g);
+        node(p).setBalance(0);
+        node(g).setBalance(0);
+      }
+      // zig-zag
+      else {
+        rotateRight(p);
+        rotateLeft(g);
+        node(p).setBalance(nBalance == -1 ? 1 : 0);
+        node(g).setBalance(nBalance == 1 ? -1 : 0);
+        node(n).setBalance(0);
+      }
+    }
+}
+
+/*
+ * Recall: The writeup specifies that if a node has 2 children you
+ * should swap with the predecessor and then remove.
+ */
+template<class Key, class Value, class Storage>
+void CompactAVLTree<Key, Value, Storage>::remove(const Key& key)
+{
+    uint32_t remove = internalFind(key);
+    if(remove == NIL){
+      return;
+    }
+
+    uint32_t fix;
+    int diff;
+    NodeType& r = node(remove);
+
+    if(r.getLeft() != NIL && r.getRight() != NIL){
+      // the predecessor takes over remove's position
+      uint32_t pred = predecessor(remove);
+      uint32_t predParent = node(pred).getParent();
+      if(predParent == remove){
+        // pred is remove's left child: its own left stays attached
+        fix = pred;
+        diff = 1;
+      }
+      else {
+        // unlink pred from the bottom of remove's left subtree
+        replaceChild(predParent, pred, node(pred).getLeft());
+        node(pred).setLeft(r.getLeft());
+        node(r.getLeft()).setParent(pred);
+        fix = predParent;
+        diff = -1;
+      }
+      node(pred).setRight(r.getRight());
+      node(r.getRight()).setParent(pred);
+      node(pred).setBalance(r.getBalance());
+      replaceChild(r.getParent(), remove, pred);
+    }
+    else {
+      uint32_t child = (r.getLeft() != NIL) ? r.getLeft() : r.getRight();
+      fix = r.getParent();
+      diff = (fix != NIL && node(fix).getLeft() == remove) ? 1 : -1;
+      replaceChild(fix, remove, child);
+    }
+
+    removeFix(fix, diff);
+    releaseNode(remove);
+}
+
+// HELPER: one subtree of n shrank (diff = +1: left, -1: right); fix upward
+template<class Key, class Value, class Storage>
+void CompactAVLTree<Key, Value, Storage>::removeFix(uint32_t n, int diff)
+{
+    if(n == NIL){
+      return;
+    }
+
+    // compute next recursive call arguments
+    uint32_t p = node(n).getParent();
+    int ndiff = (p != NIL && node(p).getLeft() == n) ? 1 : -1;
+
+    int nBalance = node(n).getBalance() + diff;
+
+    // height unchanged
+    if(nBalance == -1 || nBalance == 1){
+      node(n).setBalance(nBalance);
+      return;
+    }
+    // height shrank by one
+    if(nBalance == 0){
+      node(n).setBalance(0);
+      removeFix(p, ndiff);
+      return;
+    }
+
+    // out of balance: c = taller of the children
+    uint32_t c = (nBalance < 0) ? node(n).getLeft() : node(n).getRight();
+    int cBalance = node(c).getBalance();
+    int sign = (nBalance < 0) ? -1 : 1;
+
+    // zig zig, subtree height shrinks
+    if(cBalance == sign){
+      if(sign < 0) rotateRight(n); else rotateLeft(n);
+      node(n).setBalance(0);
+      node(c).setBalance(0);
+      removeFix(p, ndiff);
+    }
+    // zig zig, subtree height unchanged
+    else if(cBalance == 0){
+      if(sign < 0) rotateRight(n); else rotateLeft(n);
+      node(n).setBalance(sign);
+      node(c).setBalance(-sign);
+    }
+    // zig zag
+    else {
+      uint32_t g = (sign < 0) ? node(c).getRight() : node(c).getLeft();
+      int gBalance = node(g).getBalance();
+      if(sign < 0){
+        rotateLeft(c);
+        rotateRight(n);
+      }
+      else {
+        rotateRight(c);
+        rotateLeft(n);
+      }
+      node(n).setBalance(gBalance == sign ? -sign : 0);
+      node(c).setBalance(gBalance == -sign ? sign : 0);
+      node(g).setBalance(0);
+      removeFix(p, ndiff);
+    }
+}
+
+// HELPER: rotate left
+template<class Key, class Value, class Storage>
+void CompactAVLTree<Key, Value, Storage>::rotateLeft(uint32_t n)
+{
+    uint32_t child = node(n).getRight();
+    uint32_t b = node(child).getLeft();
+
+    replaceChild(node(n).getParent(), n, child);
+    node(n).setRight(b);
+    if(b != NIL){
+      node(b).setParent(n);
+    }
+    node(child).setLeft(n);
+    node(n).setParent(child);
+}
+
+// HELPER: rotate right
+template<class Key, class Value, class Storage>
+void CompactAVLTree<Key, Value, Storage>::rotateRight(uint32_t n)
+{
+    uint32_t child = node(n).getLeft();
+    uint32_t b = node(child).getRight();
+
+    replaceChild(node(n).getParent(), n, child);
+    node(n).setLeft(b);
+    if(b != NIL){
+      node(b).setParent(n);
+    }
+    node(child).setRight(n);
+    node(n).setParent(child);
+}
+
+/*
+---------------------------------------------------
+End implementations for the CompactAVLTree class.
+---------------------------------------------------
+*/
+
+#endif
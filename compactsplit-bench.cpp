@@ -0,0 +1,75 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include "compactavl.h"
+
+using namespace std;
+
+// Compares find() on a CompactAVLTree holding large values inline with
+// one keeping them in a separate slab (CompactSplitStorage).
+// Usage: compactsplit-bench [number of keys] [number of lookups]
+
+// a 256-byte value, about what a cached record or a small struct of
+// strings and counters takes
+struct Record
+{
+    uint64_t words[32];
+};
+
+static double secondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+template<typename Tree>
+double timeFinds(const char* name, const vector<uint64_t>& keys, const vector<uint64_t>& probes)
+{
+    Tree tree;
+    tree.reserve(keys.size());
+    Record record = Record();
+    for(size_t i = 0; i < keys.size(); i++) {
+        record.words[0] = keys[i];
+        tree.insert(std::make_pair(keys[i], record));
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    uint64_t found = 0;
+    for(size_t i = 0; i < probes.size(); i++) {
+        if(tree.find(probes[i]) != tree.end()) {
+            found++;
+        }
+    }
+    double seconds = secondsSince(start);
+    cout << setw(8) << name << setw(10) << probes.size() / seconds / 1e6 << " M lookups/s ("
+         << found << " hits, " << tree.memory_usage().bytesPerEntry() << " bytes per entry)" << endl;
+    return seconds;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = (argc > 1) ? strtoull(argv[1], NULL, 10) : 1000000;
+    size_t lookups = (argc > 2) ? strtoull(argv[2], NULL, 10) : 2000000;
+
+    // insert in random order; about half of the lookups miss (odd keys)
+    vector<uint64_t> keys(n);
+    for(size_t i = 0; i < n; i++) {
+        keys[i] = 2 * i;
+    }
+    mt19937_64 rng(45);
+    shuffle(keys.begin(), keys.end(), rng);
+    vector<uint64_t> probes(lookups);
+    for(size_t i = 0; i < lookups; i++) {
+        probes[i] = rng() % (2 * n);
+    }
+
+    cout << "n = " << n << ", lookups = " << lookups << ", value " << sizeof(Record) << " bytes" << endl;
+    cout << fixed << setprecision(2);
+    double inlineTime = timeFinds<CompactAVLTree<uint64_t, Record> >("inline", keys, probes);
+    double splitTime = timeFinds<CompactAVLTree<uint64_t, Record, CompactSplitStorage<uint64_t, Record> > >("split", keys, probes);
+    cout << "speedup " << setw(10) << inlineTime / splitTime << "x" << endl;
+    return 0;
+}
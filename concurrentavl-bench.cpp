@@ -0,0 +1,135 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include "avlbst.h"
+#include "concurrentavl.h"
+#include "shardedmap.h"
+
+using namespace std;
+
+// Throughput of ConcurrentAVLTree and ShardedMap against an AVLTree
+// behind one mutex, for 1, 2, 4, ... threads on a read-mostly and an
+// update-heavy mix.
+// Usage: concurrentavl-bench [max threads] [key range] [seconds per run]
+
+/**
+* What we had before: every operation takes the same lock.
+*/
+template <class Key, class Value>
+class LockedAVLTree
+{
+public:
+    void insert(const std::pair<const Key, Value>& keyValuePair)
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        tree_.insert(keyValuePair);
+    }
+    void remove(const Key& key)
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        tree_.remove(key);
+    }
+    bool find(const Key& key, Value& value) const
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        typename AVLTree<Key, Value>::iterator it = tree_.find(key);
+        if(it == tree_.end()) {
+            return false;
+        }
+        value = it->second;
+        return true;
+    }
+
+private:
+    AVLTree<Key, Value> tree_;
+    mutable std::mutex lock_;
+};
+
+// Runs threads workers for the given time; updatePercent of the operations
+// are split evenly between insert and remove. Returns million ops/s.
+template<typename Tree>
+double run(int threads, uint64_t range, int updatePercent, double seconds)
+{
+    Tree tree;
+    mt19937_64 fill(1);
+    for(uint64_t i = 0; i < range / 2; i++) {
+        uint64_t k = fill() % range;
+        tree.insert(std::make_pair(k, k));
+    }
+
+    atomic<bool> stop(false);
+    vector<uint64_t> counts(threads);
+    vector<thread> workers;
+    for(int t = 0; t < threads; t++) {
+        workers.push_back(thread([&, t]() {
+            mt19937_64 rng(t + 100);
+            uint64_t ops = 0;
+            uint64_t value;
+            while(!stop.load(memory_order_relaxed)) {
+                for(int i = 0; i < 64; i++) {
+                    uint64_t r = rng();
+                    uint64_t k = (r >> 8) % range;
+                    int op = r % 100;
+                    if(op < updatePercent / 2) {
+                        tree.insert(std::make_pair(k, k));
+                    }
+                    else if(op < updatePercent) {
+                        tree.remove(k);
+                    }
+                    else {
+                        tree.find(k, value);
+                    }
+                }
+                ops += 64;
+            }
+            counts[t] = ops;
+        }));
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    this_thread::sleep_for(chrono::duration<double>(seconds));
+    stop.store(true);
+    for(int t = 0; t < threads; t++) {
+        workers[t].join();
+    }
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    uint64_t total = 0;
+    for(int t = 0; t < threads; t++) {
+        total += counts[t];
+    }
+    return total / elapsed / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    int maxThreads = (argc > 1) ? atoi(argv[1]) : (int)thread::hardware_concurrency();
+    uint64_t range = (argc > 2) ? strtoull(argv[2], NULL, 10) : 1000000;
+    double seconds = (argc > 3) ? atof(argv[3]) : 1.0;
+    if(maxThreads < 1) {
+        maxThreads = 1;
+    }
+
+    int mixes[2] = { 10, 50 };
+    for(int m = 0; m < 2; m++) {
+        cout << "Key range " << range << ", " << mixes[m] << "% updates (M ops/s)" << endl;
+        cout << setw(8) << "threads" << setw(16) << "mutex AVLTree" << setw(16) << "ConcurrentAVL"
+             << setw(16) << "ShardedMap" << endl;
+        for(int t = 1; t <= maxThreads; t *= 2) {
+            double locked = run<LockedAVLTree<uint64_t,uint64_t> >(t, range, mixes[m], seconds);
+            double concurrent = run<ConcurrentAVLTree<uint64_t,uint64_t> >(t, range, mixes[m], seconds);
+            double sharded = run<ShardedMap<uint64_t,uint64_t> >(t, range, mixes[m], seconds);
+            cout << setw(8) << t << fixed << setprecision(2)
+                 << setw(16) << locked << setw(16) << concurrent << setw(16) << sharded << endl;
+        }
+    }
+
+    return 0;
+}
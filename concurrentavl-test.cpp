@@ -0,0 +1,52 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "concurrentavl.h"
+
+using namespace std;
+
+
+int main(int argc, char *argv[])
+{
+    // Concurrent AVL Tree tests
+    ConcurrentAVLTree<int,int> ct;
+    ct.insert(std::make_pair(2,20));
+    ct.insert(std::make_pair(1,10));
+    ct.insert(std::make_pair(3,30));
+
+    int value;
+    if(ct.find(2, value)) {
+        cout << "Found 2 -> " << value << endl;
+    }
+    ct.remove(2);
+    cout << "After removing 2: " << (ct.find(2, value) ? "found" : "not found") << endl;
+
+    // four writers on interleaved keys, then check what is left
+    vector<thread> writers;
+    for(int t = 0; t < 4; t++) {
+        writers.push_back(thread([&ct, t]() {
+            for(int k = t; k < 4000; k += 4) {
+                ct.insert(std::make_pair(k, k * 10));
+            }
+            for(int k = t; k < 4000; k += 8) {
+                ct.remove(k);
+            }
+        }));
+    }
+    for(size_t t = 0; t < writers.size(); t++) {
+        writers[t].join();
+    }
+
+    int present = 0;
+    bool valuesOk = true;
+    for(int k = 0; k < 4000; k++) {
+        if(ct.find(k, value)) {
+            present++;
+            valuesOk = valuesOk && (value == k * 10);
+        }
+    }
+    cout << "Keys left after concurrent updates: " << present
+         << (valuesOk ? " (values ok)" : " (bad values)") << endl;
+
+    return 0;
+}
@@ -0,0 +1,1132 @@
+#ifndef CONCURRENTAVL_H
+#define CONCURRENTAVL_H
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <algorithm>
+#include <cstdlib>
+#include "epoch.h"
+
+// Version word layout: bit 0 is set once a node is unlinked, bit 1 while
+// a rotation is shrinking its subtree, and the rest counts finished shrinks.
+#define CAVL_UNLINKED 1L
+#define CAVL_SHRINKING 2L
+#define CAVL_SHRINK_INCREMENT 4L
+// Reads of a shrinking node's version before blocking on its lock
+#define CAVL_SPIN_COUNT 100
+// Ancestors a repair pass remembers to revisit, see fixHeightAndRebalance
+#define CAVL_MAX_PENDING 64
+
+/**
+* A node of the concurrent AVL tree. Every field that a reader may see
+* change is atomic; the key never changes. A NULL value marks a routing
+* node, one that was removed while it had two children and so was left
+* in place to keep guiding searches.
+*
+* Writers hold the node's lock while changing any of its links, its
+* height or its value.
+*/
+template <typename Key, typename Value>
+class ConcurrentAVLNode
+{
+public:
+    ConcurrentAVLNode(const Key& key, Value* value, ConcurrentAVLNode<Key, Value>* parent);
+
+    const Key& getKey() const;
+    Value* getValue() const;
+    void setValue(Value* value);
+
+    ConcurrentAVLNode<Key, Value>* getParent() const;
+    ConcurrentAVLNode<Key, Value>* getLeft() const;
+    ConcurrentAVLNode<Key, Value>* getRight() const;
+    ConcurrentAVLNode<Key, Value>* getChild(int dir) const;
+    void setParent(ConcurrentAVLNode<Key, Value>* parent);
+    void setLeft(ConcurrentAVLNode<Key, Value>* left);
+    void setRight(ConcurrentAVLNode<Key, Value>* right);
+    void setChild(int dir, ConcurrentAVLNode<Key, Value>* child);
+
+    int getHeight() const;
+    void setHeight(int height);
+    long getVersion() const;
+    void setVersion(long version);
+
+    std::mutex& getLock();
+
+protected:
+    const Key key_;
+    std::atomic<Value*> value_;
+    std::atomic<ConcurrentAVLNode<Key, Value>*> parent_;
+    std::atomic<ConcurrentAVLNode<Key, Value>*> left_;
+    std::atomic<ConcurrentAVLNode<Key, Value>*> right_;
+    std::atomic<int> height_;
+    std::atomic<long> version_;
+    std::mutex lock_;
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the ConcurrentAVLNode class.
+  -----------------------------------------------
+*/
+
+/**
+* Explicit constructor for a leaf node; the node takes ownership of value.
+*/
+template<typename Key, typename Value>
+ConcurrentAVLNode<Key, Value>::ConcurrentAVLNode(const Key& key, Value* value, ConcurrentAVLNode<Key, Value>* parent) :
+    key_(key), value_(value), parent_(parent), left_(NULL), right_(NULL), height_(1), version_(0)
+{
+
+}
+
+/**
+* A const getter for the key.
+*/
+template<typename Key, typename Value>
+const Key& ConcurrentAVLNode<Key, Value>::getKey() const
+{
+    return key_;
+}
+
+/**
+* A getter for the value, NULL for a routing node.
+*/
+template<typename Key, typename Value>
+Value* ConcurrentAVLNode<Key, Value>::getValue() const
+{
+    return value_.load();
+}
+
+/**
+* A setter for the value. The caller retires the old one.
+*/
+template<typename Key, typename Value>
+void ConcurrentAVLNode<Key, Value>::setValue(Value* value)
+{
+    value_.store(value);
+}
+
+/**
+* A getter for the parent.
+*/
+template<typename Key, typename Value>
+ConcurrentAVLNode<Key, Value>* ConcurrentAVLNode<Key, Value>::getParent() const
+{
+    return parent_.load();
+}
+
+/**
+* A getter for the left child.
+*/
+template<typename Key, typename Value>
+ConcurrentAVLNode<Key, Value>* ConcurrentAVLNode<Key, Value>::getLeft() const
+{
+    return left_.load();
+}
+
+/**
+* A getter for the right child.
+*/
+template<typename Key, typename Value>
+ConcurrentAVLNode<Key, Value>* ConcurrentAVLNode<Key, Value>::getRight() const
+{
+    return right_.load();
+}
+
+/**
+* A getter for the child on side dir: left if dir < 0, right otherwise.
+*/
+template<typename Key, typename Value>
+ConcurrentAVLNode<Key, Value>* ConcurrentAVLNode<Key, Value>::getChild(int dir) const
+{
+    return (dir < 0) ? left_.load() : right_.load();
+}
+
+/**
+* A setter for the parent.
+*/
+template<typename Key, typename Value>
+void ConcurrentAVLNode<Key, Value>::setParent(ConcurrentAVLNode<Key, Value>* parent)
+{
+    parent_.store(parent);
+}
+
+/**
+* A setter for the left child.
+*/
+template<typename Key, typename Value>
+void ConcurrentAVLNode<Key, Value>::setLeft(ConcurrentAVLNode<Key, Value>* left)
+{
+    left_.store(left);
+}
+
+/**
+* A setter for the right child.
+*/
+template<typename Key, typename Value>
+void ConcurrentAVLNode<Key, Value>::setRight(ConcurrentAVLNode<Key, Value>* right)
+{
+    right_.store(right);
+}
+
+/**
+* A setter for the child on side dir: left if dir < 0, right otherwise.
+*/
+template<typename Key, typename Value>
+void ConcurrentAVLNode<Key, Value>::setChild(int dir, ConcurrentAVLNode<Key, Value>* child)
+{
+    if(dir < 0){
+      left_.store(child);
+    }
+    else {
+      right_.store(child);
+    }
+}
+
+/**
+* A getter for the height of the subtree rooted here, 1 for a leaf.
+*/
+template<typename Key, typename Value>
+int ConcurrentAVLNode<Key, Value>::getHeight() const
+{
+    return height_.load();
+}
+
+/**
+* A setter for the height.
+*/
+template<typename Key, typename Value>
+void ConcurrentAVLNode<Key, Value>::setHeight(int height)
+{
+    height_.store(height);
+}
+
+/**
+* A getter for the version word, see CAVL_UNLINKED and CAVL_SHRINKING.
+*/
+template<typename Key, typename Value>
+long ConcurrentAVLNode<Key, Value>::getVersion() const
+{
+    return version_.load();
+}
+
+/**
+* A setter for the version word.
+*/
+template<typename Key, typename Value>
+void ConcurrentAVLNode<Key, Value>::setVersion(long version)
+{
+    version_.store(version);
+}
+
+/**
+* The lock writers hold while changing this node.
+*/
+template<typename Key, typename Value>
+std::mutex& ConcurrentAVLNode<Key, Value>::getLock()
+{
+    return lock_;
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the ConcurrentAVLNode class.
+  -----------------------------------------------
+*/
+
+/**
+* A relaxed-balance AVL tree that any number of threads can use at once
+* (Bronson, Casper, Chafi and Olukotun, "A Practical Concurrent Binary
+* Search Tree", PPoPP 2010).
+*
+* Searches take no locks. They walk down hand-over-hand, reading each
+* node's version before following a link and checking it again after;
+* a rotation marks the node it moves down as shrinking for its duration
+* and bumps the version afterwards, so a search that raced with it sees
+* the change and retries from the last node still valid. Writers lock
+* only the nodes they change, always parent before child, and repair
+* heights and balance on the way back up, one node at a time.
+*
+* Removing a node with two children only clears its value; the routing
+* node left behind is unlinked later, once it has at most one child.
+* Unlinked nodes and replaced values are freed through an EpochManager,
+* since a concurrent search may still be reading them.
+*
+* find, insert and remove mean the same as in AVLTree, but there are no
+* iterators: find copies the value out instead. The Key type must be
+* default constructible, for the sentinel above the root.
+*/
+template <class Key, class Value>
+class ConcurrentAVLTree
+{
+public:
+    ConcurrentAVLTree();
+    virtual ~ConcurrentAVLTree();
+
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    // copies the value for key into value and returns true if key exists
+    bool find(const Key& key, Value& value) const;
+    // not thread-safe: no other operation may run at the same time
+    void clear();
+
+protected:
+    typedef ConcurrentAVLNode<Key, Value> NodeType;
+
+    enum Result { RETRY, DONE, FOUND, NOT_FOUND };
+    // nodeCondition() answers, a non-negative answer is a new height
+    enum Condition { UNLINK_REQUIRED = -1, REBALANCE_REQUIRED = -2, NOTHING_REQUIRED = -3 };
+
+    static int compare(const Key& a, const Key& b);
+    static int height(NodeType* node);
+    static long beginChange(long version);
+    static long endChange(long version);
+    static void waitUntilNotChanging(NodeType* node);
+
+    Result attemptGet(const Key& key, NodeType* node, int dir, long nodeVersion, Value& value) const;
+    void update(const Key& key, Value* newValue);
+    bool attemptInsertIntoEmpty(const Key& key, Value* value);
+    Result attemptUpdate(EpochManager::Guard& guard, const Key& key, Value* newValue,
+                         NodeType* parent, NodeType* node, long nodeVersion);
+    Result attemptNodeUpdate(EpochManager::Guard& guard, Value* newValue, NodeType* parent, NodeType* node);
+    bool attemptUnlink_nl(NodeType* parent, NodeType* node);
+
+    int nodeCondition(NodeType* node);
+    NodeType* fixHeight_nl(NodeType* node);
+    void fixHeightAndRebalance(EpochManager::Guard& guard, NodeType* node);
+    NodeType* rebalance_nl(EpochManager::Guard& guard, NodeType* nParent, NodeType* n);
+    NodeType* rebalanceToRight_nl(NodeType* nParent, NodeType* n, NodeType* nL, int hR0);
+    NodeType* rebalanceToLeft_nl(NodeType* nParent, NodeType* n, NodeType* nR, int hL0);
+    NodeType* rotateRight_nl(NodeType* nParent, NodeType* n, NodeType* nL, int hR, int hLL, NodeType* nLR, int hLR);
+    NodeType* rotateLeft_nl(NodeType* nParent, NodeType* n, int hL, NodeType* nR, NodeType* nRL, int hRL, int hRR);
+    NodeType* rotateRightOverLeft_nl(NodeType* nParent, NodeType* n, NodeType* nL, int hR, int hLL, NodeType* nLR, int hLRL);
+    NodeType* rotateLeftOverRight_nl(NodeType* nParent, NodeType* n, int hL, NodeType* nR, NodeType* nRL, int hRR, int hRLR);
+
+    void clearHelper(NodeType* node);
+
+protected:
+    // sentinel whose right child is the root; it never moves or changes version
+    NodeType* rootHolder_;
+    mutable EpochManager epochs_;
+};
+
+/*
+--------------------------------------------------------------
+Begin implementations for the ConcurrentAVLTree class.
+Methods ending in _nl expect the caller to hold the locks they need.
+---------------------------------------------------------------
+*/
+
+/**
+* Default constructor for a ConcurrentAVLTree, which sets up the sentinel.
+*/
+template<class Key, class Value>
+ConcurrentAVLTree<Key, Value>::ConcurrentAVLTree() :
+    rootHolder_(new NodeType(Key(), NULL, NULL))
+{
+
+}
+
+/**
+* Frees every node and value.
+*/
+template<class Key, class Value>
+ConcurrentAVLTree<Key, Value>::~ConcurrentAVLTree()
+{
+    clear();
+    delete rootHolder_;
+}
+
+/**
+* Inserts the key-value pair, overwriting the value if the key exists.
+*/
+template<class Key, class Value>
+void ConcurrentAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    update(keyValuePair.first, new Value(keyValuePair.second));
+}
+
+/**
+* Removes the key if it exists.
+*/
+template<class Key, class Value>
+void ConcurrentAVLTree<Key, Value>::remove(const Key& key)
+{
+    update(key, NULL);
+}
+
+/**
+* Lock-free lookup. The value is copied while this thread is still
+* inside its epoch, so a concurrent overwrite cannot free it under us.
+*/
+template<class Key, class Value>
+bool ConcurrentAVLTree<Key, Value>::find(const Key& key, Value& value) const
+{
+    EpochManager::Guard guard(epochs_);
+    while(true){
+      Result result = attemptGet(key, rootHolder_, 1, rootHolder_->getVersion(), value);
+      if(result != RETRY){
+        return result == FOUND;
+      }
+    }
+}
+
+/**
+* Deletes every node. Must not overlap any other operation on the tree.
+*/
+template<class Key, class Value>
+void ConcurrentAVLTree<Key, Value>::clear()
+{
+    clearHelper(rootHolder_->getRight());
+    rootHolder_->setRight(NULL);
+    rootHolder_->setHeight(1);
+}
+
+// HELPER: three-way comparison using only operator<
+template<class Key, class Value>
+int ConcurrentAVLTree<Key, Value>::compare(const Key& a, const Key& b)
+{
+    if(a < b){
+      return -1;
+    }
+    if(b < a){
+      return 1;
+    }
+    return 0;
+}
+
+// HELPER: height of a possibly empty subtree
+template<class Key, class Value>
+int ConcurrentAVLTree<Key, Value>::height(NodeType* node)
+{
+    return (node == NULL) ? 0 : node->getHeight();
+}
+
+// HELPER: version to publish while a node's subtree is shrinking
+template<class Key, class Value>
+long ConcurrentAVLTree<Key, Value>::beginChange(long version)
+{
+    return version | CAVL_SHRINKING;
+}
+
+// HELPER: version to publish once the shrink is done
+template<class Key, class Value>
+long ConcurrentAVLTree<Key, Value>::endChange(long version)
+{
+    return (version & ~(CAVL_SHRINKING | CAVL_UNLINKED)) + CAVL_SHRINK_INCREMENT;
+}
+
+/**
+* Waits for a rotation on node to finish. The rotating thread holds the
+* node's lock, so after a short spin we simply queue on that.
+*/
+template<class Key, class Value>
+void ConcurrentAVLTree<Key, Value>::waitUntilNotChanging(NodeType* node)
+{
+    long version = node->getVersion();
+    if((version & CAVL_SHRINKING) == 0){
+      return;
+    }
+    for(int i = 0; i < CAVL_SPIN_COUNT; i++){
+      if(node->getVersion() != version){
+        return;
+      }
+    }
+    std::lock_guard<std::mutex> lock(node->getLock());
+}
+
+/**
+* Searches for key below node, whose version was nodeVersion when we
+* arrived. RETRY means node changed and the caller must re-read its link.
+*/
+template<class Key, class Value>
+typename ConcurrentAVLTree<Key, Value>::Result
+ConcurrentAVLTree<Key, Value>::attemptGet(const Key& key, NodeType* node, int dir, long nodeVersion, Value& value) const
+{
+    while(true){
+      NodeType* child = node->getChild(dir);
+      if(node->getVersion() != nodeVersion){
+        return RETRY;
+      }
+      if(child == NULL){
+        return NOT_FOUND;
+      }
+
+      int childDir = compare(key, child->getKey());
+      if(childDir == 0){
+        Value* found = child->getValue();
+        if(found == NULL){
+          return NOT_FOUND;
+        }
+        value = *found;
+        return FOUND;
+      }
+
+      long childVersion = child->getVersion();
+      if(childVersion & CAVL_SHRINKING){
+        waitUntilNotChanging(child);
+      }
+      else if((childVersion & CAVL_UNLINKED) == 0 && child == node->getChild(dir)){
+        // child is still ours and was valid when its version was read
+        if(node->getVersion() != nodeVersion){
+          return RETRY;
+        }
+        Result result = attemptGet(key, child, childDir, childVersion, value);
+        if(result != RETRY){
+          return result;
+        }
+      }
+    }
+}
+
+/**
+* Shared driver for insert (newValue set) and remove (newValue NULL).
+* On return newValue is owned by the tree.
+*/
+template<class Key, class Value>
+void ConcurrentAVLTree<Key, Value>::update(const Key& key, Value* newValue)
+{
+    EpochManager::Guard guard(epochs_);
+    while(true){
+      NodeType* root = rootHolder_->getRight();
+      if(root == NULL){
+        if(newValue == NULL || attemptInsertIntoEmpty(key, newValue)){
+          return;
+        }
+      }
+      else {
+        long rootVersion = root->getVersion();
+        if(rootVersion & (CAVL_SHRINKING | CAVL_UNLINKED)){
+          waitUntilNotChanging(root);
+        }
+        else if(root == rootHolder_->getRight()){
+          if(attemptUpdate(guard, key, newValue, rootHolder_, root, rootVersion) != RETRY){
+            return;
+          }
+        }
+      }
+    }
+}
+
+/**
+* Installs the first node, unless another thread got there first.
+*/
+template<class Key, class Value>
+bool ConcurrentAVLTree<Key, Value>::attemptInsertIntoEmpty(const Key& key, Value* value)
+{
+    std::lock_guard<std::mutex> lock(rootHolder_->getLock());
+    if(rootHolder_->getRight() != NULL){
+      return false;
+    }
+    rootHolder_->setRight(new NodeType(key, value, rootHolder_));
+    rootHolder_->setHeight(2);
+    return true;
+}
+
+/**
+* Descends from node (reached from parent with version nodeVersion) and
+* applies the update, adding a leaf if the key is missing.
+*/
+template<class Key, class Value>
+typename ConcurrentAVLTree<Key, Value>::Result
+ConcurrentAVLTree<Key, Value>::attemptUpdate(EpochManager::Guard& guard, const Key& key, Value* newValue,
+                                             NodeType* parent, NodeType* node, long nodeVersion)
+{
+    int dir = compare(key, node->getKey());
+    if(dir == 0){
+      return attemptNodeUpdate(guard, newValue, parent, node);
+    }
+
+    while(true){
+      NodeType* child = node->getChild(dir);
+      if(node->getVersion() != nodeVersion){
+        return RETRY;
+      }
+
+      if(child == NULL){
+        if(newValue == NULL){
+          // removing a key that is not there
+          return DONE;
+        }
+        NodeType* damaged;
+        {
+          std::lock_guard<std::mutex> lock(node->getLock());
+          if(node->getVersion() != nodeVersion){
+            return RETRY;
+          }
+          if(node->getChild(dir) != NULL){
+            // lost a race for the empty slot, look again
+            continue;
+          }
+          node->setChild(dir, new NodeType(key, newValue, node));
+          damaged = fixHeight_nl(node);
+        }
+        fixHeightAndRebalance(guard, damaged);
+        return DONE;
+      }
+
+      long childVersion = child->getVersion();
+      if(childVersion & (CAVL_SHRINKING | CAVL_UNLINKED)){
+        waitUntilNotChanging(child);
+      }
+      else if(child == node->getChild(dir)){
+        if(node->getVersion() != nodeVersion){
+          return RETRY;
+        }
+        Result result = attemptUpdate(guard, key, newValue, node, child, childVersion);
+        if(result != RETRY){
+          return result;
+        }
+      }
+    }
+}
+
+/**
+* Applies the update to the node holding the key. A remove unlinks the
+* node when it has at most one child and leaves a routing node otherwise.
+*/
+template<class Key, class Value>
+typename ConcurrentAVLTree<Key, Value>::Result
+ConcurrentAVLTree<Key, Value>::attemptNodeUpdate(EpochManager::Guard& guard, Value* newValue, NodeType* parent, NodeType* node)
+{
+    if(newValue == NULL && node->getValue() == NULL){
+      return DONE;
+    }
+
+    if(newValue == NULL && (node->getLeft() == NULL || node->getRight() == NULL)){
+      Value* prev;
+      NodeType* damaged;
+      {
+        std::lock_guard<std::mutex> parentLock(parent->getLock());
+        if((parent->getVersion() & CAVL_UNLINKED) || node->getParent() != parent){
+          return RETRY;
+        }
+        {
+          std::lock_guard<std::mutex> nodeLock(node->getLock());
+          prev = node->getValue();
+          if(prev == NULL){
+            return DONE;
+          }
+          if(!attemptUnlink_nl(parent, node)){
+            return RETRY;
+          }
+        }
+        damaged = fixHeight_nl(parent);
+      }
+      guard.retire(prev);
+      guard.retire(node);
+      fixHeightAndRebalance(guard, damaged);
+      return DONE;
+    }
+
+    std::lock_guard<std::mutex> lock(node->getLock());
+    if(node->getVersion() & CAVL_UNLINKED){
+      return RETRY;
+    }
+    // a child may have gone since we looked, making an unlink possible
+    if(newValue == NULL && (node->getLeft() == NULL || node->getRight() == NULL)){
+      return RETRY;
+    }
+    Value* prev = node->getValue();
+    node->setValue(newValue);
+    if(prev != NULL){
+      guard.retire(prev);
+    }
+    return DONE;
+}
+
+/**
+* Splices node (at most one child) out from under parent. Both are locked.
+*/
+template<class Key, class Value>
+bool ConcurrentAVLTree<Key, Value>::attemptUnlink_nl(NodeType* parent, NodeType* node)
+{
+    NodeType* parentL = parent->getLeft();
+    NodeType* parentR = parent->getRight();
+    if(parentL != node && parentR != node){
+      return false;
+    }
+
+    NodeType* left = node->getLeft();
+    NodeType* right = node->getRight();
+    if(left != NULL && right != NULL){
+      return false;
+    }
+
+    NodeType* splice = (left != NULL) ? left : right;
+    if(parentL == node){
+      parent->setLeft(splice);
+    }
+    else {
+      parent->setRight(splice);
+    }
+    if(splice != NULL){
+      splice->setParent(parent);
+    }
+
+    node->setVersion(CAVL_UNLINKED);
+    node->setValue(NULL);
+    return true;
+}
+
+/**
+* Reports what node needs: to be unlinked, to be rebalanced, a new
+* height (returned as is), or nothing.
+*/
+template<class Key, class Value>
+int ConcurrentAVLTree<Key, Value>::nodeCondition(NodeType* node)
+{
+    NodeType* nL = node->getLeft();
+    NodeType* nR = node->getRight();
+    if((nL == NULL || nR == NULL) && node->getValue() == NULL){
+      return UNLINK_REQUIRED;
+    }
+
+    int hN = node->getHeight();
+    int hL0 = height(nL);
+    int hR0 = height(nR);
+    int hNRepl = 1 + std::max(hL0, hR0);
+    int bal = hL0 - hR0;
+    if(bal < -1 || bal > 1){
+      return REBALANCE_REQUIRED;
+    }
+    return (hN != hNRepl) ? hNRepl : NOTHING_REQUIRED;
+}
+
+/**
+* Fixes node's height if that is all it needs. Returns the next node to
+* look at: node itself if it needs more, its parent if its height
+* changed, or NULL when the repair is complete.
+*/
+template<class Key, class Value>
+typename ConcurrentAVLTree<Key, Value>::NodeType*
+ConcurrentAVLTree<Key, Value>::fixHeight_nl(NodeType* node)
+{
+    int c = nodeCondition(node);
+    switch(c){
+      case REBALANCE_REQUIRED:
+      case UNLINK_REQUIRED:
+        return node;
+      case NOTHING_REQUIRED:
+        return NULL;
+      default:
+        node->setHeight(c);
+        return node->getParent();
+    }
+}
+
+/**
+* Walks up from node repairing heights, rotating and unlinking routing
+* nodes, locking only the few nodes each step touches. Stops at the
+* sentinel or as soon as a node needs nothing.
+*
+* A rotation can hand back a node below the one it fixed, for example a
+* routing node it left with one child. The parent of the rotated subtree
+* may still need a new height afterwards, so it is kept on a short list
+* and revisited once the work below it is done.
+*/
+template<class Key, class Value>
+void ConcurrentAVLTree<Key, Value>::fixHeightAndRebalance(EpochManager::Guard& guard, NodeType* node)
+{
+    NodeType* pending[CAVL_MAX_PENDING];
+    int numPending = 0;
+
+    while(true){
+      if(node == NULL || node->getParent() == NULL || (node->getVersion() & CAVL_UNLINKED)){
+        if(numPending == 0){
+          return;
+        }
+        node = pending[--numPending];
+        continue;
+      }
+      int condition = nodeCondition(node);
+      if(condition == NOTHING_REQUIRED){
+        node = NULL;
+        continue;
+      }
+
+      if(condition != UNLINK_REQUIRED && condition != REBALANCE_REQUIRED){
+        std::lock_guard<std::mutex> lock(node->getLock());
+        node = fixHeight_nl(node);
+      }
+      else {
+        NodeType* nParent = node->getParent();
+        std::lock_guard<std::mutex> parentLock(nParent->getLock());
+        if((nParent->getVersion() & CAVL_UNLINKED) == 0 && node->getParent() == nParent){
+          std::lock_guard<std::mutex> nodeLock(node->getLock());
+          node = rebalance_nl(guard, nParent, node);
+          if(node != NULL && node != nParent && node != nParent->getParent()
+             && numPending < CAVL_MAX_PENDING
+             && (numPending == 0 || pending[numPending - 1] != nParent)){
+            pending[numPending++] = nParent;
+          }
+        }
+        // otherwise node moved, look at it again
+      }
+    }
+}
+
+/**
+* Does whatever n needs, with nParent and n locked.
+*/
+template<class Key, class Value>
+typename ConcurrentAVLTree<Key, Value>::NodeType*
+ConcurrentAVLTree<Key, Value>::rebalance_nl(EpochManager::Guard& guard, NodeType* nParent, NodeType* n)
+{
+    NodeType* nL = n->getLeft();
+    NodeType* nR = n->getRight();
+
+    if((nL == NULL || nR == NULL) && n->getValue() == NULL){
+      if(attemptUnlink_nl(nParent, n)){
+        guard.retire(n);
+        return fixHeight_nl(nParent);
+      }
+      return n;
+    }
+
+    int hN = n->getHeight();
+    int hL0 = height(nL);
+    int hR0 = height(nR);
+    int hNRepl = 1 + std::max(hL0, hR0);
+    int bal = hL0 - hR0;
+
+    if(bal > 1){
+      return rebalanceToRight_nl(nParent, n, nL, hR0);
+    }
+    else if(bal < -1){
+      return rebalanceToLeft_nl(nParent, n, nR, hL0);
+    }
+    else if(hNRepl != hN){
+      n->setHeight(hNRepl);
+      return fixHeight_nl(nParent);
+    }
+    return NULL;
+}
+
+/**
+* n is left heavy: rotate right, or right over left when nL leans the
+* other way. Locks nL, and nL's right child if a double rotation may be
+* needed.
+*/
+template<class Key, class Value>
+typename ConcurrentAVLTree<Key, Value>::NodeType*
+ConcurrentAVLTree<Key, Value>::rebalanceToRight_nl(NodeType* nParent, NodeType* n, NodeType* nL, int hR0)
+{
+    std::lock_guard<std::mutex> lock(nL->getLock());
+    int hL = nL->getHeight();
+    if(hL - hR0 <= 1){
+      // changed since we looked
+      return n;
+    }
+
+    NodeType* nLR = nL->getRight();
+    int hLL0 = height(nL->getLeft());
+    int hLR0 = height(nLR);
+    if(hLL0 >= hLR0){
+      return rotateRight_nl(nParent, n, nL, hR0, hLL0, nLR, hLR0);
+    }
+
+    {
+      std::lock_guard<std::mutex> lockLR(nLR->getLock());
+      int hLR = nLR->getHeight();
+      if(hLL0 >= hLR){
+        return rotateRight_nl(nParent, n, nL, hR0, hLL0, nLR, hLR);
+      }
+      int hLRL = height(nLR->getLeft());
+      int b = hLL0 - hLRL;
+      if(b >= -1 && b <= 1){
+        return rotateRightOverLeft_nl(nParent, n, nL, hR0, hLL0, nLR, hLRL);
+      }
+    }
+    // nL itself is too unbalanced, fix it first
+    return rebalanceToLeft_nl(n, nL, nLR, hLL0);
+}
+
+/**
+* Mirror image of rebalanceToRight_nl.
+*/
+template<class Key, class Value>
+typename ConcurrentAVLTree<Key, Value>::NodeType*
+ConcurrentAVLTree<Key, Value>::rebalanceToLeft_nl(NodeType* nParent, NodeType* n, NodeType* nR, int hL0)
+{
+    std::lock_guard<std::mutex> lock(nR->getLock());
+    int hR = nR->getHeight();
+    if(hL0 - hR >= -1){
+      return n;
+    }
+
+    NodeType* nRL = nR->getLeft();
+    int hRL0 = height(nRL);
+    int hRR0 = height(nR->getRight());
+    if(hRR0 >= hRL0){
+      return rotateLeft_nl(nParent, n, hL0, nR, nRL, hRL0, hRR0);
+    }
+
+    {
+      std::lock_guard<std::mutex> lockRL(nRL->getLock());
+      int hRL = nRL->getHeight();
+      if(hRR0 >= hRL){
+        return rotateLeft_nl(nParent, n, hL0, nR, nRL, hRL, hRR0);
+      }
+      int hRLR = height(nRL->getRight());
+      int b = hRR0 - hRLR;
+      if(b >= -1 && b <= 1){
+        return rotateLeftOverRight_nl(nParent, n, hL0, nR, nRL, hRR0, hRLR);
+      }
+    }
+    return rebalanceToRight_nl(n, nR, nRL, hRR0);
+}
+
+/**
+* Single right rotation of n under nParent; n shrinks, so its version is
+* marked for the duration. Returns the next node needing attention.
+*/
+template<class Key, class Value>
+typename ConcurrentAVLTree<Key, Value>::NodeType*
+ConcurrentAVLTree<Key, Value>::rotateRight_nl(NodeType* nParent, NodeType* n, NodeType* nL,
+                                              int hR, int hLL, NodeType* nLR, int hLR)
+{
+    long nodeVersion = n->getVersion();
+    NodeType* nPL = nParent->getLeft();
+
+    n->setVersion(beginChange(nodeVersion));
+
+    n->setLeft(nLR);
+    if(nLR != NULL){
+      nLR->setParent(n);
+    }
+    nL->setRight(n);
+    n->setParent(nL);
+    if(nPL == n){
+      nParent->setLeft(nL);
+    }
+    else {
+      nParent->setRight(nL);
+    }
+    nL->setParent(nParent);
+
+    int hNRepl = 1 + std::max(hLR, hR);
+    n->setHeight(hNRepl);
+    nL->setHeight(1 + std::max(hLL, hNRepl));
+
+    n->setVersion(endChange(nodeVersion));
+
+    int balN = hLR - hR;
+    if(balN < -1 || balN > 1){
+      return n;
+    }
+    if((nLR == NULL || hR == 0) && n->getValue() == NULL){
+      return n;
+    }
+    int balL = hLL - hNRepl;
+    if(balL < -1 || balL > 1){
+      return nL;
+    }
+    if(hLL == 0 && nL->getValue() == NULL){
+      return nL;
+    }
+    return fixHeight_nl(nParent);
+}
+
+/**
+* Mirror image of rotateRight_nl.
+*/
+template<class Key, class Value>
+typename ConcurrentAVLTree<Key, Value>::NodeType*
+ConcurrentAVLTree<Key, Value>::rotateLeft_nl(NodeType* nParent, NodeType* n, int hL,
+                                             NodeType* nR, NodeType* nRL, int hRL, int hRR)
+{
+    long nodeVersion = n->getVersion();
+    NodeType* nPL = nParent->getLeft();
+
+    n->setVersion(beginChange(nodeVersion));
+
+    n->setRight(nRL);
+    if(nRL != NULL){
+      nRL->setParent(n);
+    }
+    nR->setLeft(n);
+    n->setParent(nR);
+    if(nPL == n){
+      nParent->setLeft(nR);
+    }
+    else {
+      nParent->setRight(nR);
+    }
+    nR->setParent(nParent);
+
+    int hNRepl = 1 + std::max(hL, hRL);
+    n->setHeight(hNRepl);
+    nR->setHeight(1 + std::max(hNRepl, hRR));
+
+    n->setVersion(endChange(nodeVersion));
+
+    int balN = hRL - hL;
+    if(balN < -1 || balN > 1){
+      return n;
+    }
+    if((nRL == NULL || hL == 0) && n->getValue() == NULL){
+      return n;
+    }
+    int balR = hRR - hNRepl;
+    if(balR < -1 || balR > 1){
+      return nR;
+    }
+    if(hRR == 0 && nR->getValue() == NULL){
+      return nR;
+    }
+    return fixHeight_nl(nParent);
+}
+
+/**
+* Double rotation: nL's right child nLR rises above both nL and n, which
+* both shrink. nParent, n, nL and nLR are locked.
+*/
+template<class Key, class Value>
+typename ConcurrentAVLTree<Key, Value>::NodeType*
+ConcurrentAVLTree<Key, Value>::rotateRightOverLeft_nl(NodeType* nParent, NodeType* n, NodeType* nL,
+                                                      int hR, int hLL, NodeType* nLR, int hLRL)
+{
+    long nodeVersion = n->getVersion();
+    long leftVersion = nL->getVersion();
+    NodeType* nPL = nParent->getLeft();
+    NodeType* nLRL = nLR->getLeft();
+    NodeType* nLRR = nLR->getRight();
+    int hLRR = height(nLRR);
+
+    n->setVersion(beginChange(nodeVersion));
+    nL->setVersion(beginChange(leftVersion));
+
+    n->setLeft(nLRR);
+    if(nLRR != NULL){
+      nLRR->setParent(n);
+    }
+    nL->setRight(nLRL);
+    if(nLRL != NULL){
+      nLRL->setParent(nL);
+    }
+    nLR->setLeft(nL);
+    nL->setParent(nLR);
+    nLR->setRight(n);
+    n->setParent(nLR);
+    if(nPL == n){
+      nParent->setLeft(nLR);
+    }
+    else {
+      nParent->setRight(nLR);
+    }
+    nLR->setParent(nParent);
+
+    int hNRepl = 1 + std::max(hLRR, hR);
+    n->setHeight(hNRepl);
+    int hLRepl = 1 + std::max(hLL, hLRL);
+    nL->setHeight(hLRepl);
+    nLR->setHeight(1 + std::max(hLRepl, hNRepl));
+
+    n->setVersion(endChange(nodeVersion));
+    nL->setVersion(endChange(leftVersion));
+
+    int balN = hLRR - hR;
+    if(balN < -1 || balN > 1){
+      return n;
+    }
+    if((nLRR == NULL || hR == 0) && n->getValue() == NULL){
+      return n;
+    }
+    int balLR = hLRepl - hNRepl;
+    if(balLR < -1 || balLR > 1){
+      return nLR;
+    }
+    // nL may be a routing node that just lost a child
+    if((hLL == 0 || hLRL == 0) && nL->getValue() == NULL){
+      return nL;
+    }
+    return fixHeight_nl(nParent);
+}
+
+/**
+* Mirror image of rotateRightOverLeft_nl.
+*/
+template<class Key, class Value>
+typename ConcurrentAVLTree<Key, Value>::NodeType*
+ConcurrentAVLTree<Key, Value>::rotateLeftOverRight_nl(NodeType* nParent, NodeType* n, int hL,
+                                                      NodeType* nR, NodeType* nRL, int hRR, int hRLR)
+{
+    long nodeVersion = n->getVersion();
+    long rightVersion = nR->getVersion();
+    NodeType* nPL = nParent->getLeft();
+    NodeType* nRLL = nRL->getLeft();
+    NodeType* nRLR = nRL->getRight();
+    int hRLL = height(nRLL);
+
+    n->setVersion(beginChange(nodeVersion));
+    nR->setVersion(beginChange(rightVersion));
+
+    n->setRight(nRLL);
+    if(nRLL != NULL){
+      nRLL->setParent(n);
+    }
+    nR->setLeft(nRLR);
+    if(nRLR != NULL){
+      nRLR->setParent(nR);
+    }
+    nRL->setRight(nR);
+    nR->setParent(nRL);
+    nRL->setLeft(n);
+    n->setParent(nRL);
+    if(nPL == n){
+      nParent->setLeft(nRL);
+    }
+    else {
+      nParent->setRight(nRL);
+    }
+    nRL->setParent(nParent);
+
+    int hNRepl = 1 + std::max(hL, hRLL);
+    n->setHeight(hNRepl);
+    int hRRepl = 1 + std::max(hRLR, hRR);
+    nR->setHeight(hRRepl);
+    nRL->setHeight(1 + std::max(hNRepl, hRRepl));
+
+    n->setVersion(endChange(nodeVersion));
+    nR->setVersion(endChange(rightVersion));
+
+    int balN = hRLL - hL;
+    if(balN < -1 || balN > 1){
+      return n;
+    }
+    if((nRLL == NULL || hL == 0) && n->getValue() == NULL){
+      return n;
+    }
+    int balRL = hRRepl - hNRepl;
+    if(balRL < -1 || balRL > 1){
+      return nRL;
+    }
+    if((hRR == 0 || hRLR == 0) && nR->getValue() == NULL){
+      return nR;
+    }
+    return fixHeight_nl(nParent);
+}
+
+// HELPER: post-order delete of a subtree and its values
+template<class Key, class Value>
+void ConcurrentAVLTree<Key, Value>::clearHelper(NodeType* node)
+{
+    if(node == NULL){
+      return;
+    }
+    clearHelper(node->getLeft());
+    clearHelper(node->getRight());
+    delete node->getValue();
+    delete node;
+}
+
+/*
+------------------------------------------------------------
+End implementations for the ConcurrentAVLTree class.
+------------------------------------------------------------
+*/
+
+#endif
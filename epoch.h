@@ -0,0 +1,257 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+// Threads that can be inside one EpochManager at the same time. A thread
+// that finds every slot taken spins until one is released.
+#define EPOCH_MAX_SLOTS 128
+// Retirements a slot makes between attempts to advance the epoch
+#define EPOCH_SCAN_INTERVAL 64
+
+/**
+* Epoch-based memory reclamation for structures whose readers take no
+* locks. Every operation runs inside a Guard, which announces the global
+* epoch it started in. Memory unlinked by a writer is retire()d rather
+* than deleted, and is only freed once the global epoch has moved two
+* steps past the point it was retired at; by then every operation that
+* could still have been holding a pointer to it has finished.
+*
+* The epoch only advances when every active slot has announced the
+* current one, so a stalled thread delays reclamation but never
+* correctness.
+*/
+class EpochManager
+{
+private:
+    struct Retired
+    {
+        void* ptr;
+        void (*destroy)(void*);
+    };
+
+    struct Slot
+    {
+        // 0 when free, otherwise 1 + the epoch announced by its owner
+        std::atomic<uint64_t> state;
+        // garbage by retire epoch modulo 3; only touched by the owner
+        std::vector<Retired> bags[3];
+        uint64_t bagEpoch[3];
+        unsigned sinceScan;
+        // keeps owners of neighbouring slots off each other's cache line
+        char pad[64];
+    };
+
+public:
+    /**
+    * Marks the calling thread as active for its lifetime. Guards must
+    * not be nested on the same thread.
+    */
+    class Guard
+    {
+    public:
+        explicit Guard(EpochManager& manager);
+        ~Guard();
+
+        // frees p with delete once no other operation can reach it
+        template <typename T>
+        void retire(T* p);
+
+    private:
+        Guard(const Guard&);
+        Guard& operator=(const Guard&);
+
+        EpochManager& manager_;
+        Slot* slot_;
+    };
+
+    EpochManager();
+    ~EpochManager();
+
+private:
+    EpochManager(const EpochManager&);
+    EpochManager& operator=(const EpochManager&);
+
+    Slot* enter();
+    void leave(Slot* slot);
+    void retire(Slot* slot, void* ptr, void (*destroy)(void*));
+    void tryAdvance();
+    void collect(Slot* slot);
+    static void freeBag(std::vector<Retired>& bag);
+
+    template <typename T>
+    static void destroyAs(void* p);
+
+    std::atomic<uint64_t> epoch_;
+    Slot slots_[EPOCH_MAX_SLOTS];
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the EpochManager class.
+  -----------------------------------------------
+*/
+
+/**
+* Enters the manager, claiming a slot for this thread.
+*/
+inline EpochManager::Guard::Guard(EpochManager& manager) :
+    manager_(manager), slot_(manager.enter())
+{
+
+}
+
+/**
+* Leaves the manager, releasing the slot.
+*/
+inline EpochManager::Guard::~Guard()
+{
+    manager_.leave(slot_);
+}
+
+/**
+* Hands p over to the manager, which deletes it when it is safe to.
+*/
+template <typename T>
+void EpochManager::Guard::retire(T* p)
+{
+    manager_.retire(slot_, p, &EpochManager::destroyAs<T>);
+}
+
+/**
+* Default constructor, all slots start free and empty.
+*/
+inline EpochManager::EpochManager() :
+    epoch_(0)
+{
+    for(size_t i = 0; i < EPOCH_MAX_SLOTS; i++){
+      slots_[i].state.store(0);
+      slots_[i].sinceScan = 0;
+      for(int b = 0; b < 3; b++){
+        slots_[i].bagEpoch[b] = 0;
+      }
+    }
+}
+
+/**
+* Frees everything still waiting. No Guard may be alive at this point.
+*/
+inline EpochManager::~EpochManager()
+{
+    for(size_t i = 0; i < EPOCH_MAX_SLOTS; i++){
+      for(int b = 0; b < 3; b++){
+        freeBag(slots_[i].bags[b]);
+      }
+    }
+}
+
+/**
+* Claims a free slot, starting at one derived from the thread id so that
+* a thread usually gets the same slot back, and announces the epoch.
+* Bags in the slot that have aged enough are freed on the way in.
+*/
+inline EpochManager::Slot* EpochManager::enter()
+{
+    size_t i = std::hash<std::thread::id>()(std::this_thread::get_id()) % EPOCH_MAX_SLOTS;
+    size_t tries = 0;
+    while(true){
+      uint64_t expected = 0;
+      if(slots_[i].state.compare_exchange_strong(expected, epoch_.load() + 1)){
+        break;
+      }
+      i = (i + 1) % EPOCH_MAX_SLOTS;
+      if(++tries % EPOCH_MAX_SLOTS == 0){
+        std::this_thread::yield();
+      }
+    }
+    collect(&slots_[i]);
+    return &slots_[i];
+}
+
+/**
+* Releases the slot. Its bags stay behind for the next owner to free.
+*/
+inline void EpochManager::leave(Slot* slot)
+{
+    slot->state.store(0);
+}
+
+/**
+* Files ptr under the current global epoch. A bag still holding an older
+* epoch with the same residue is at least three epochs old, so it is
+* freed before being reused.
+*/
+inline void EpochManager::retire(Slot* slot, void* ptr, void (*destroy)(void*))
+{
+    uint64_t epoch = epoch_.load();
+    int b = epoch % 3;
+    if(slot->bagEpoch[b] != epoch){
+      freeBag(slot->bags[b]);
+      slot->bagEpoch[b] = epoch;
+    }
+    Retired r = { ptr, destroy };
+    slot->bags[b].push_back(r);
+
+    if(++slot->sinceScan >= EPOCH_SCAN_INTERVAL){
+      slot->sinceScan = 0;
+      tryAdvance();
+      collect(slot);
+    }
+}
+
+/**
+* Moves the global epoch forward if every active slot has caught up.
+*/
+inline void EpochManager::tryAdvance()
+{
+    uint64_t epoch = epoch_.load();
+    for(size_t i = 0; i < EPOCH_MAX_SLOTS; i++){
+      uint64_t state = slots_[i].state.load();
+      if(state != 0 && state != epoch + 1){
+        return;
+      }
+    }
+    epoch_.compare_exchange_strong(epoch, epoch + 1);
+}
+
+/**
+* Frees the bags of slot that were retired two or more epochs ago.
+*/
+inline void EpochManager::collect(Slot* slot)
+{
+    uint64_t epoch = epoch_.load();
+    for(int b = 0; b < 3; b++){
+      if(!slot->bags[b].empty() && slot->bagEpoch[b] + 2 <= epoch){
+        freeBag(slot->bags[b]);
+      }
+    }
+}
+
+// HELPER: run the destructors of everything in a bag
+inline void EpochManager::freeBag(std::vector<Retired>& bag)
+{
+    for(size_t i = 0; i < bag.size(); i++){
+      bag[i].destroy(bag[i].ptr);
+    }
+    bag.clear();
+}
+
+// HELPER: typed delete for a retired pointer
+template <typename T>
+void EpochManager::destroyAs(void* p)
+{
+    delete static_cast<T*>(p);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the EpochManager class.
+  -----------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,147 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include "equal-paths.h"
+
+using namespace std;
+
+// Times equalPaths() against the original recursive version on large
+// trees that all have equal paths, so neither can stop early.
+// Usage: equal-paths-bench [number of nodes]
+
+static double secondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// the original implementation: pathLength of both children at every node
+static int recursivePathLength(Node* root)
+{
+    if(root == NULL) {
+        return 0;
+    }
+    return max(recursivePathLength(root->left), recursivePathLength(root->right)) + 1;
+}
+
+static bool recursiveEqualPaths(Node* root)
+{
+    if(root == NULL || (root->left == NULL && root->right == NULL)) {
+        return true;
+    }
+    if(root->left == NULL) {
+        return recursiveEqualPaths(root->right);
+    }
+    if(root->right == NULL) {
+        return recursiveEqualPaths(root->left);
+    }
+    return recursivePathLength(root->left) == recursivePathLength(root->right)
+        && recursiveEqualPaths(root->left) && recursiveEqualPaths(root->right);
+}
+
+// nodes live in one pool so no tree has to be freed recursively
+static Node* newNode(vector<Node>& pool)
+{
+    pool.push_back(Node((int)pool.size()));
+    return &pool.back();
+}
+
+// complete tree with 2^levels - 1 nodes
+static Node* buildPerfect(vector<Node>& pool, int levels)
+{
+    if(levels == 0) {
+        return NULL;
+    }
+    Node* n = newNode(pool);
+    n->left = buildPerfect(pool, levels - 1);
+    n->right = buildPerfect(pool, levels - 1);
+    return n;
+}
+
+// a right spine of k nodes, where spine node i also has a left chain of
+// k - 1 - i nodes: every leaf is at depth k - 1, and the recursive version
+// measures each remaining spine again at every level
+static Node* buildComb(vector<Node>& pool, int k)
+{
+    Node* root = NULL;
+    Node* spine = NULL;
+    for(int i = 0; i < k; i++) {
+        Node* s = newNode(pool);
+        Node* tail = s;
+        for(int j = 0; j < k - 1 - i; j++) {
+            tail->left = newNode(pool);
+            tail = tail->left;
+        }
+        if(spine == NULL) {
+            root = s;
+        }
+        else {
+            spine->right = s;
+        }
+        spine = s;
+    }
+    return root;
+}
+
+// a single path of n nodes
+static Node* buildChain(vector<Node>& pool, size_t n)
+{
+    Node* root = newNode(pool);
+    Node* tail = root;
+    for(size_t i = 1; i < n; i++) {
+        tail->right = newNode(pool);
+        tail = tail->right;
+    }
+    return root;
+}
+
+static void timeShape(const char* name, Node* root, size_t nodes, bool runRecursive)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    bool result = equalPaths(root);
+    double iterTime = secondsSince(start);
+
+    cout << setw(8) << name << setw(10) << nodes << " nodes  "
+         << "equalPaths " << setw(9) << iterTime * 1e3 << " ms (" << result << ")  ";
+    if(runRecursive) {
+        start = chrono::steady_clock::now();
+        bool expected = recursiveEqualPaths(root);
+        double recTime = secondsSince(start);
+        cout << "recursive " << setw(9) << recTime * 1e3 << " ms (" << expected << ")";
+    }
+    else {
+        cout << "recursive  skipped (would overflow the stack)";
+    }
+    cout << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = (argc > 1) ? strtoull(argv[1], NULL, 10) : 1000000;
+    cout << fixed << setprecision(2);
+
+    vector<Node> pool;
+    pool.reserve(n + 1);
+    int levels = 1;
+    while(((size_t)1 << (levels + 1)) - 1 <= n) {
+        levels++;
+    }
+    Node* root = buildPerfect(pool, levels);
+    timeShape("wide", root, pool.size(), true);
+
+    pool.clear();
+    int k = 1;
+    while((size_t)(k + 1) + (size_t)(k + 1) * k / 2 <= n) {
+        k++;
+    }
+    root = buildComb(pool, k);
+    timeShape("comb", root, pool.size(), true);
+
+    pool.clear();
+    root = buildChain(pool, n);
+    timeShape("deep", root, pool.size(), false);
+
+    return 0;
+}
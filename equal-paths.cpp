@@ -1,37 +1,52 @@
 #ifndef RECCHECK
 //if you want to add any #includes like <iostream> you must do them here (before the next endif)
-#include <algorithm>
+#include <vector>
+#include <utility>
 #endif
 
 #include "equal-paths.h"
 using namespace std;
 
 // You may add any prototypes of helper functions here
-int pathLength(Node* root){
-  if(root==NULL){
-    return 0;
-  }
-  return std::max(pathLength(root->left), pathLength(root->right)) + 1;
-}
-
 
+// One depth-first pass with an explicit stack, so very deep trees cannot
+// overflow the call stack. Every leaf is compared with the depth of the
+// first leaf found, and the walk stops at the first one that differs.
+// Each node is visited at most once: O(n) time, O(height) extra space.
 bool equalPaths(Node * root)
 {
   if(root==NULL){
     return true;
   }
-  else if(root->left==NULL && root->right==NULL){
-    return true;
-  }
-  else if(root->left==NULL){
-    return equalPaths(root->right);
-  }
-  else if(root->right==NULL){
-    return equalPaths(root->left);
-  }
-  else {
-    return pathLength(root->left) == pathLength(root->right) && equalPaths(root->left) && equalPaths(root->right);
-  }
 
+  vector<pair<Node*, int> > pending;
+  pending.push_back(make_pair(root, 0));
+  int leafDepth = -1;
+
+  while(!pending.empty()){
+    Node* current = pending.back().first;
+    int depth = pending.back().second;
+    pending.pop_back();
+
+    // leaf: record or compare its depth
+    if(current->left==NULL && current->right==NULL){
+      if(leafDepth==-1){
+        leafDepth = depth;
+      }
+      else if(depth!=leafDepth){
+        return false;
+      }
+      continue;
+    }
+
+    // right first so the left subtree is walked first
+    if(current->right!=NULL){
+      pending.push_back(make_pair(current->right, depth + 1));
+    }
+    if(current->left!=NULL){
+      pending.push_back(make_pair(current->left, depth + 1));
+    }
+  }
+  return true;
 }
 
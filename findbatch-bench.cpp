@@ -0,0 +1,71 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include "avlbst.h"
+
+using namespace std;
+
+// Compares a loop of find() calls with find_batch() on random lookups.
+// Usage: findbatch-bench [number of keys] [number of lookups]
+
+static double secondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = (argc > 1) ? strtoull(argv[1], NULL, 10) : 4000000;
+    size_t lookups = (argc > 2) ? strtoull(argv[2], NULL, 10) : 2000000;
+
+    // insert in random order so nodes are scattered across the heap
+    vector<uint64_t> keys(n);
+    for(size_t i = 0; i < n; i++) {
+        keys[i] = 2 * i;
+    }
+    mt19937_64 rng(104);
+    shuffle(keys.begin(), keys.end(), rng);
+
+    AVLTree<uint64_t,uint64_t> tree;
+    for(size_t i = 0; i < n; i++) {
+        tree.insert(std::make_pair(keys[i], keys[i]));
+    }
+
+    // about half of the lookups miss (odd keys)
+    vector<uint64_t> probes(lookups);
+    for(size_t i = 0; i < lookups; i++) {
+        probes[i] = rng() % (2 * n);
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    uint64_t found = 0;
+    for(size_t i = 0; i < lookups; i++) {
+        if(tree.find(probes[i]) != tree.end()) {
+            found++;
+        }
+    }
+    double loopTime = secondsSince(start);
+
+    vector<AVLTree<uint64_t,uint64_t>::iterator> results;
+    start = chrono::steady_clock::now();
+    tree.find_batch(probes, results);
+    uint64_t foundBatch = 0;
+    for(size_t i = 0; i < lookups; i++) {
+        if(results[i] != tree.end()) {
+            foundBatch++;
+        }
+    }
+    double batchTime = secondsSince(start);
+
+    cout << "n = " << n << ", lookups = " << lookups << endl;
+    cout << fixed << setprecision(2);
+    cout << "find loop   " << setw(8) << lookups / loopTime / 1e6 << " M lookups/s (" << found << " hits)" << endl;
+    cout << "find_batch  " << setw(8) << lookups / batchTime / 1e6 << " M lookups/s (" << foundBatch << " hits)" << endl;
+    cout << "speedup     " << setw(8) << loopTime / batchTime << "x" << endl;
+
+    return found == foundBatch ? 0 : 1;
+}
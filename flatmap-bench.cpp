@@ -0,0 +1,91 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include "avlbst.h"
+#include "flatmap.h"
+
+using namespace std;
+
+// Compares FlatMap with the AVLTree it is built from on uint64_t keys:
+// the O(n) build, find() and an ordered scan, for small to large maps.
+// Usage: flatmap-bench [number of lookups]
+
+static double secondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+template<typename Map>
+double timeFinds(const Map& map, const vector<uint64_t>& probes, uint64_t& found)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    found = 0;
+    for(size_t i = 0; i < probes.size(); i++) {
+        if(map.find(probes[i]) != map.end()) {
+            found++;
+        }
+    }
+    return secondsSince(start);
+}
+
+template<typename Map>
+double timeScan(const Map& map, uint64_t& sum)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    sum = 0;
+    for(typename Map::iterator it = map.begin(); it != map.end(); ++it) {
+        sum += it->second;
+    }
+    return secondsSince(start);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t lookups = (argc > 1) ? strtoull(argv[1], NULL, 10) : 2000000;
+    size_t sizes[] = { 1000, 100000, 2000000 };
+    mt19937_64 rng(50);
+
+    cout << "lookups = " << lookups << endl;
+    cout << setw(10) << "n" << setw(10) << "build ms" << setw(10) << "AVL find" << setw(10) << "flat find"
+         << setw(10) << "AVL scan" << setw(11) << "flat scan" << "   (M operations/s)" << endl;
+    cout << fixed << setprecision(2);
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s];
+        // insert in random order; about half of the lookups miss (odd keys)
+        vector<uint64_t> keys(n);
+        for(size_t i = 0; i < n; i++) {
+            keys[i] = 2 * i;
+        }
+        shuffle(keys.begin(), keys.end(), rng);
+        AVLTree<uint64_t, uint64_t> tree;
+        for(size_t i = 0; i < n; i++) {
+            tree.insert(std::make_pair(keys[i], keys[i]));
+        }
+        vector<uint64_t> probes(lookups);
+        for(size_t i = 0; i < lookups; i++) {
+            probes[i] = rng() % (2 * n);
+        }
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        FlatMap<uint64_t, uint64_t> flat(tree);
+        double buildTime = secondsSince(start);
+
+        uint64_t treeFound, flatFound, treeSum, flatSum;
+        double treeFind = timeFinds(tree, probes, treeFound);
+        double flatFind = timeFinds(flat, probes, flatFound);
+        double treeScan = timeScan(tree, treeSum);
+        double flatScan = timeScan(flat, flatSum);
+        if(treeFound != flatFound || treeSum != flatSum) {
+            cout << "mismatch at n = " << n << endl;
+            return 1;
+        }
+        cout << setw(10) << n << setw(10) << buildTime * 1e3
+             << setw(10) << lookups / treeFind / 1e6 << setw(10) << lookups / flatFind / 1e6
+             << setw(10) << n / treeScan / 1e6 << setw(11) << n / flatScan / 1e6 << endl;
+    }
+    return 0;
+}
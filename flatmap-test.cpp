@@ -0,0 +1,78 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include "avlbst.h"
+#include "flatmap.h"
+
+using namespace std;
+
+
+int main(int argc, char *argv[])
+{
+    // Writes go through the staging area; reads see them at once
+    FlatMap<int, string> m;
+    for(int i = 10; i >= 1; i--) {
+        m.insert(make_pair(i * 10, to_string(i)));
+    }
+    m.insert(make_pair(50, string("fifty")));
+    m.remove(30);
+    cout << "size " << m.size() << ", m[50] = " << m[50] << endl;
+    cout << "contents:";
+    for(FlatMap<int, string>::iterator it = m.begin(); it != m.end(); ++it) {
+        cout << " " << it->first << "=" << it->second;
+    }
+    cout << endl;
+    cout << "lower_bound(35) = " << m.lower_bound(35)->first << ", upper_bound(40) = " << m.upper_bound(40)->first
+         << ", min " << m.min()->first << ", max " << m.max()->first << endl;
+
+    m.erase(m.lower_bound(60), m.upper_bound(80));
+    pair<int, string> smallest = m.pop_min();
+    cout << "after erasing [60, 80] and pop_min (" << smallest.first << "):";
+    for(FlatMap<int, string>::iterator it = m.begin(); it != m.end(); ++it) {
+        cout << " " << it->first;
+    }
+    cout << endl;
+
+    // Lookups while keys are still staged see the merged order
+    FlatMap<int, int> staged;
+    staged.insert(make_pair(10, 10));
+    staged.insert(make_pair(20, 20));
+    staged.begin();
+    staged.insert(make_pair(5, 5));
+    staged.insert(make_pair(1, 1));
+    staged.erase(staged.find(10));
+    cout << "staged: after erase(find(10)):";
+    for(FlatMap<int, int>::iterator it = staged.begin(); it != staged.end(); ++it) {
+        cout << " " << it->first;
+    }
+    staged.insert(make_pair(15, 15));
+    bool hit = staged.find(15) != staged.end();
+    staged.insert(make_pair(12, 12));
+    bool miss = staged.end() != staged.find(13);
+    staged.insert(make_pair(3, 3));
+    vector<int> batchKeys;
+    batchKeys.push_back(3);
+    batchKeys.push_back(10);
+    vector<FlatMap<int, int>::iterator> batch;
+    staged.find_batch(batchKeys, batch);
+    cout << ", find(15) hit " << hit << ", find(13) hit " << miss << ", find_batch(3) "
+         << batch[0]->first << ", find_batch(10) hit " << (batch[1] != staged.end()) << endl;
+
+    // Built from a tree in one in-order pass
+    AVLTree<int, int> tree;
+    for(int i = 0; i < 20; i++) {
+        tree.insert(make_pair((i * 7) % 20, i));
+    }
+    FlatMap<int, int> copy(tree);
+    vector<int> keys;
+    keys.push_back(3);
+    keys.push_back(7);
+    keys.push_back(25);
+    vector<FlatMap<int, int>::iterator> found;
+    copy.find_sorted(keys, found);
+    cout << "from AVLTree: size " << copy.size() << ", found 3 " << (found[0] != copy.end())
+         << ", found 25 " << (found[2] != copy.end()) << ", balanced " << copy.isBalanced() << endl;
+    cout << "memory: ";
+    copy.memory_usage().print(cout);
+    return 0;
+}
@@ -0,0 +1,765 @@
+#ifndef FLATMAP_H
+#define FLATMAP_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "bst.h"
+#include "memoryusage.h"
+
+// Writes of keys that are not in the sorted arrays yet wait in an
+// unsorted area of at most this many entries, then merge in one pass
+#define FLATMAP_STAGING 64
+
+/**
+* What a FlatMap iterator's operator* returns: references to the key and
+* the value of one entry, accessed like a std::pair through first and
+* second.
+*/
+template <typename Key, typename Value>
+struct FlatMapItem
+{
+    FlatMapItem(const Key& key, Value& value) :
+        first(key), second(value)
+    {
+
+    }
+
+    // a copy of the entry as a real pair
+    operator std::pair<const Key, Value>() const
+    {
+        return std::pair<const Key, Value>(first, second);
+    }
+
+    const Key& first;
+    Value& second;
+};
+
+/**
+* What a FlatMap iterator's operator-> returns: it holds the item, so
+* it->first and it->second work as they do on a pair pointer.
+*/
+template <typename Key, typename Value>
+class FlatMapItemPointer
+{
+public:
+    explicit FlatMapItemPointer(const FlatMapItem<Key, Value>& item) :
+        item_(item)
+    {
+
+    }
+
+    const FlatMapItem<Key, Value>* operator->() const
+    {
+        return &item_;
+    }
+
+protected:
+    FlatMapItem<Key, Value> item_;
+};
+
+/**
+* A sorted map for read-mostly data with the interface of
+* BinarySearchTree. Keys and values live in two sorted arrays, so a find
+* is a binary search over keys only, without pointer chasing, and a scan
+* is a walk through contiguous memory.
+*
+* New keys are not placed one at a time, which would shift the arrays on
+* every insert; they wait in a small unsorted staging area and are merged
+* in FLATMAP_STAGING at a time. Operations that hand out iterators or
+* need the order merge first. Removes shift the arrays.
+*
+* Like a vector, any insert or remove may invalidate iterators and
+* references.
+*/
+template <typename Key, typename Value>
+class FlatMap
+{
+public:
+    FlatMap();
+    // copies the entries of a tree (an AVLTree, say) in one in-order pass
+    explicit FlatMap(const BinarySearchTree<Key, Value>& tree);
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    // a sorted array is as balanced as a search can be
+    bool isBalanced() const;
+    bool empty() const;
+    size_t size() const;
+    // capacity for n entries in the sorted arrays
+    void reserve(size_t n);
+    // bytes used by the arrays and what keys and values own; O(n)
+    MemoryUsage memory_usage() const;
+
+public:
+    typedef FlatMapItem<Key, Value> reference;
+    typedef FlatMapItemPointer<Key, Value> pointer;
+
+    /**
+    * An iterator over the contents of the map, in key order.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        reference operator*() const;
+        pointer operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class FlatMap<Key, Value>;
+        iterator(const FlatMap<Key, Value>* map, size_t index);
+        const FlatMap<Key, Value>* map_;
+        size_t index_;
+    };
+
+public:
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    // looks up many keys at once, out[i] is find(keys[i])
+    void find_batch(const std::vector<Key>& keys, std::vector<iterator>& out) const;
+    // batches of ascending keys, each search starting from the previous result
+    void find_sorted(const std::vector<Key>& keys, std::vector<iterator>& out) const;
+    void insert_sorted(const std::vector<std::pair<Key, Value> >& items);
+    // the first entry whose key is not less than / greater than key
+    iterator lower_bound(const Key& key) const;
+    iterator upper_bound(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+    // hinted insert: the new item is placed just before hint if it belongs there
+    iterator insert(iterator hint, const std::pair<const Key, Value>& keyValuePair);
+    // O(1) access to the extremes, end() if the map is empty
+    iterator min() const;
+    iterator max() const;
+    // remove and return the smallest/largest item
+    std::pair<Key, Value> pop_min();
+    std::pair<Key, Value> pop_max();
+    // remove by position, return the iterator following the removed range
+    iterator erase(iterator pos);
+    iterator erase(iterator first, iterator last);
+
+protected:
+    // index of key in the sorted arrays, or size if it is not there
+    size_t internalFind(const Key& key) const;
+    // index of the first key in [first, last) not less than key
+    size_t lowerBound(const Key& key, size_t first, size_t last) const;
+    // index of key in the staging area, or its size
+    size_t stagedFind(const Key& key) const;
+    // sorts the staging area into the arrays
+    void merge() const;
+    static bool stagedLess(const std::pair<Key, Value>& a, const std::pair<Key, Value>& b);
+
+protected:
+    // mutable so const lookups can merge the staging area first
+    mutable std::vector<Key> keys_;
+    mutable std::vector<Value> values_;
+    // keys in neither array, unsorted
+    mutable std::vector<std::pair<Key, Value> > staged_;
+};
+
+/*
+-----------------------------------------------
+Begin implementations for the FlatMap::iterator class.
+-----------------------------------------------
+*/
+
+/**
+* Explicit constructor that initializes an iterator with a given index.
+*/
+template<class Key, class Value>
+FlatMap<Key, Value>::iterator::iterator(const FlatMap<Key, Value>* map, size_t index) :
+    map_(map), index_(index)
+{
+
+}
+
+/**
+* A default constructor that initializes an iterator that points nowhere.
+*/
+template<class Key, class Value>
+FlatMap<Key, Value>::iterator::iterator() :
+    map_(NULL), index_(0)
+{
+
+}
+
+/**
+* Provides access to the item.
+*/
+template<class Key, class Value>
+typename FlatMap<Key, Value>::reference
+FlatMap<Key, Value>::iterator::operator*() const
+{
+    return reference(map_->keys_[index_], map_->values_[index_]);
+}
+
+/**
+* Provides access to the item through ->.
+*/
+template<class Key, class Value>
+typename FlatMap<Key, Value>::pointer
+FlatMap<Key, Value>::iterator::operator->() const
+{
+    return pointer(**this);
+}
+
+/**
+* Checks if 'this' iterator's internals have the same value
+* as 'rhs'
+*/
+template<class Key, class Value>
+bool
+FlatMap<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    return map_ == rhs.map_ && index_ == rhs.index_;
+}
+
+/**
+* Checks if 'this' iterator's internals have a different value
+* as 'rhs'
+*/
+template<class Key, class Value>
+bool
+FlatMap<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+/**
+* Advances the iterator to the next index.
+*/
+template<class Key, class Value>
+typename FlatMap<Key, Value>::iterator&
+FlatMap<Key, Value>::iterator::operator++()
+{
+    index_++;
+    return *this;
+}
+
+/*
+-------------------------------------------------------------
+End implementations for the FlatMap::iterator class.
+-------------------------------------------------------------
+*/
+
+/*
+-----------------------------------------------------
+Begin implementations for the FlatMap class.
+-----------------------------------------------------
+*/
+
+/**
+* Default constructor for an empty map.
+*/
+template<class Key, class Value>
+FlatMap<Key, Value>::FlatMap()
+{
+
+}
+
+/**
+* Builds the map from a tree in O(n): the tree iterates in key order, so
+* its entries are appended to the arrays as they are. The walk is what
+* costs (a cache miss per node on a large tree), so there is only one,
+* without counting the entries first.
+*/
+template<class Key, class Value>
+FlatMap<Key, Value>::FlatMap(const BinarySearchTree<Key, Value>& tree)
+{
+    for(typename BinarySearchTree<Key, Value>::iterator it = tree.begin(); it != tree.end(); ++it){
+      keys_.push_back(it->first);
+      values_.push_back(it->second);
+    }
+}
+
+/**
+ * Returns true if the map is empty
+*/
+template<class Key, class Value>
+bool FlatMap<Key, Value>::empty() const
+{
+    return keys_.empty() && staged_.empty();
+}
+
+/**
+ * Returns the number of entries.
+*/
+template<class Key, class Value>
+size_t FlatMap<Key, Value>::size() const
+{
+    return keys_.size() + staged_.size();
+}
+
+/**
+ * Always true.
+*/
+template<class Key, class Value>
+bool FlatMap<Key, Value>::isBalanced() const
+{
+    return true;
+}
+
+/**
+* Reserves room for n entries in the sorted arrays.
+*/
+template<class Key, class Value>
+void FlatMap<Key, Value>::reserve(size_t n)
+{
+    keys_.reserve(n);
+    values_.reserve(n);
+}
+
+/**
+* Removes all contents of the map.
+*/
+template<class Key, class Value>
+void FlatMap<Key, Value>::clear()
+{
+    keys_.clear();
+    values_.clear();
+    staged_.clear();
+}
+
+/**
+* Reports the memory held by the map. There are no per-entry headers;
+* unused capacity and the allocator's share of each array are slack.
+*/
+template<class Key, class Value>
+MemoryUsage FlatMap<Key, Value>::memory_usage() const
+{
+    MemoryUsage usage;
+    for(size_t i = 0; i < keys_.size(); i++){
+      usage.addEntry<Key, Value>(keys_[i], values_[i]);
+    }
+    for(size_t i = 0; i < staged_.size(); i++){
+      usage.addEntry<Key, Value>(staged_[i].first, staged_[i].second);
+    }
+    usage.payloadBytes += keys_.size() * sizeof(Key) + values_.size() * sizeof(Value)
+                        + staged_.size() * sizeof(std::pair<Key, Value>);
+    usage.slackBytes += mallocBlockBytes(keys_.capacity() * sizeof(Key)) - keys_.size() * sizeof(Key)
+                      + mallocBlockBytes(values_.capacity() * sizeof(Value)) - values_.size() * sizeof(Value)
+                      + mallocBlockBytes(staged_.capacity() * sizeof(std::pair<Key, Value>))
+                      - staged_.size() * sizeof(std::pair<Key, Value>);
+    return usage;
+}
+
+/**
+* Returns an iterator to the "smallest" item in the map
+*/
+template<class Key, class Value>
+typename FlatMap<Key, Value>::iterator
+FlatMap<Key, Value>::begin() const
+{
+    merge();
+    return iterator(this, 0);
+}
+
+/**
+* Returns an iterator whose value means INVALID
+*/
+template<class Key, class Value>
+typename FlatMap<Key, Value>::iterator
+FlatMap<Key, Value>::end() const
+{
+    merge();
+    return iterator(this, keys_.size());
+}
+
+/**
+* Returns an iterator to the item with the given key, k
+* or the end iterator if k does not exist in the map
+*/
+template<class Key, class Value>
+typename FlatMap<Key, Value>::iterator
+FlatMap<Key, Value>::find(const Key& key) const
+{
+    return iterator(this, internalFind(key));
+}
+
+/**
+* Looks up a batch of keys, out[i] being find(keys[i]). The searches
+* are independent and branch free, so the processor overlaps their
+* loads without help.
+*/
+template<class Key, class Value>
+void FlatMap<Key, Value>::find_batch(const std::vector<Key>& keys, std::vector<iterator>& out) const
+{
+    out.resize(keys.size());
+    for(size_t i = 0; i < keys.size(); i++){
+      out[i] = find(keys[i]);
+    }
+}
+
+/**
+* Looks up an ascending batch of keys, out[i] being find(keys[i]). Each
+* search gallops forward from where the previous one ended, so k sorted
+* lookups cost O(k log(n/k)). Out-of-order keys still work, they just
+* search the whole array.
+*/
+template<class Key, class Value>
+void FlatMap<Key, Value>::find_sorted(const std::vector<Key>& keys, std::vector<iterator>& out) const
+{
+    merge();
+    out.resize(keys.size());
+    size_t n = keys_.size();
+    size_t finger = 0;
+    for(size_t i = 0; i < keys.size(); i++){
+      const Key& key = keys[i];
+      // the previous result is past key: start over
+      if(finger > 0 && !(keys_[finger - 1] < key)){
+        finger = 0;
+      }
+      // double the step until it passes key, then search the last step
+      size_t step = 1;
+      while(finger + step < n && keys_[finger + step - 1] < key){
+        step *= 2;
+      }
+      size_t last = std::min(finger + step, n);
+      finger = lowerBound(key, finger + step / 2, last);
+      bool found = finger < n && !(key < keys_[finger]) && !(keys_[finger] < key);
+      out[i] = iterator(this, found ? finger : n);
+    }
+}
+
+/**
+* Inserts (or overwrites) an ascending batch of items in one merge with
+* the arrays, O(n + k). A batch that is not ascending is inserted item
+* by item.
+*/
+template<class Key, class Value>
+void FlatMap<Key, Value>::insert_sorted(const std::vector<std::pair<Key, Value> >& items)
+{
+    for(size_t i = 1; i < items.size(); i++){
+      if(!(items[i - 1].first < items[i].first)){
+        for(size_t j = 0; j < items.size(); j++){
+          insert(std::pair<const Key, Value>(items[j].first, items[j].second));
+        }
+        return;
+      }
+    }
+
+    merge();
+    std::vector<Key> keys;
+    std::vector<Value> values;
+    keys.reserve(keys_.size() + items.size());
+    values.reserve(keys_.size() + items.size());
+    size_t i = 0, j = 0;
+    while(i < keys_.size() || j < items.size()){
+      if(j == items.size() || (i < keys_.size() && keys_[i] < items[j].first)){
+        keys.push_back(keys_[i]);
+        values.push_back(values_[i]);
+        i++;
+      }
+      else {
+        // an equal key takes the new value
+        if(i < keys_.size() && !(items[j].first < keys_[i])){
+          i++;
+        }
+        keys.push_back(items[j].first);
+        values.push_back(items[j].second);
+        j++;
+      }
+    }
+    keys_.swap(keys);
+    values_.swap(values);
+}
+
+/**
+* Returns an iterator to the first item whose key is not less than key,
+* or end() if there is none.
+*/
+template<class Key, class Value>
+typename FlatMap<Key, Value>::iterator
+FlatMap<Key, Value>::lower_bound(const Key& key) const
+{
+    merge();
+    return iterator(this, lowerBound(key, 0, keys_.size()));
+}
+
+/**
+* Returns an iterator to the first item whose key is greater than key,
+* or end() if there is none.
+*/
+template<class Key, class Value>
+typename FlatMap<Key, Value>::iterator
+FlatMap<Key, Value>::upper_bound(const Key& key) const
+{
+    merge();
+    size_t i = lowerBound(key, 0, keys_.size());
+    if(i < keys_.size() && !(key < keys_[i])){
+      i++;
+    }
+    return iterator(this, i);
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value>
+Value& FlatMap<Key, Value>::operator[](const Key& key)
+{
+    size_t i = internalFind(key);
+    if(i == keys_.size()) throw std::out_of_range("Invalid key");
+    return values_[i];
+}
+template<class Key, class Value>
+Value const & FlatMap<Key, Value>::operator[](const Key& key) const
+{
+    size_t i = internalFind(key);
+    if(i == keys_.size()) throw std::out_of_range("Invalid key");
+    return values_[i];
+}
+
+/**
+* Overwrites the value of a key already in the arrays in place; a new
+* key goes to the staging area, which is merged once it is full.
+*/
+template<class Key, class Value>
+void FlatMap<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    size_t i = lowerBound(keyValuePair.first, 0, keys_.size());
+    if(i < keys_.size() && !(keyValuePair.first < keys_[i])){
+      values_[i] = keyValuePair.second;
+      return;
+    }
+    size_t s = stagedFind(keyValuePair.first);
+    if(s < staged_.size()){
+      staged_[s].second = keyValuePair.second;
+      return;
+    }
+    staged_.push_back(std::pair<Key, Value>(keyValuePair.first, keyValuePair.second));
+    if(staged_.size() >= FLATMAP_STAGING){
+      merge();
+    }
+}
+
+/**
+* Inserts an item and returns an iterator to it. If it belongs right
+* before hint (end() included) and nothing is staged, it is placed there
+* directly, which is O(1) at the end; otherwise this is a plain insert.
+*/
+template<class Key, class Value>
+typename FlatMap<Key, Value>::iterator
+FlatMap<Key, Value>::insert(iterator hint, const std::pair<const Key, Value>& keyValuePair)
+{
+    size_t h = hint.index_;
+    const Key& key = keyValuePair.first;
+    if(staged_.empty() && hint.map_ == this && h <= keys_.size()
+       && (h == 0 || keys_[h - 1] < key) && (h == keys_.size() || key < keys_[h])){
+      keys_.insert(keys_.begin() + h, key);
+      values_.insert(values_.begin() + h, keyValuePair.second);
+      return iterator(this, h);
+    }
+    insert(keyValuePair);
+    return find(key);
+}
+
+/**
+* Removes the item with the given key, if any.
+*/
+template<class Key, class Value>
+void FlatMap<Key, Value>::remove(const Key& key)
+{
+    size_t s = stagedFind(key);
+    if(s < staged_.size()){
+      staged_[s] = staged_.back();
+      staged_.pop_back();
+      return;
+    }
+    size_t i = lowerBound(key, 0, keys_.size());
+    if(i < keys_.size() && !(key < keys_[i])){
+      keys_.erase(keys_.begin() + i);
+      values_.erase(values_.begin() + i);
+    }
+}
+
+/**
+* Returns an iterator to the smallest item, end() if the map is empty.
+*/
+template<class Key, class Value>
+typename FlatMap<Key, Value>::iterator
+FlatMap<Key, Value>::min() const
+{
+    return begin();
+}
+
+/**
+* Returns an iterator to the largest item, end() if the map is empty.
+*/
+template<class Key, class Value>
+typename FlatMap<Key, Value>::iterator
+FlatMap<Key, Value>::max() const
+{
+    merge();
+    return iterator(this, keys_.empty() ? 0 : keys_.size() - 1);
+}
+
+/**
+* Removes and returns the smallest item.
+*/
+template<class Key, class Value>
+std::pair<Key, Value> FlatMap<Key, Value>::pop_min()
+{
+    merge();
+    if(keys_.empty()) throw std::out_of_range("Empty map");
+    std::pair<Key, Value> item(keys_.front(), values_.front());
+    keys_.erase(keys_.begin());
+    values_.erase(values_.begin());
+    return item;
+}
+
+/**
+* Removes and returns the largest item.
+*/
+template<class Key, class Value>
+std::pair<Key, Value> FlatMap<Key, Value>::pop_max()
+{
+    merge();
+    if(keys_.empty()) throw std::out_of_range("Empty map");
+    std::pair<Key, Value> item(keys_.back(), values_.back());
+    keys_.pop_back();
+    values_.pop_back();
+    return item;
+}
+
+/**
+* Removes the item at pos and returns the iterator following it.
+*/
+template<class Key, class Value>
+typename FlatMap<Key, Value>::iterator
+FlatMap<Key, Value>::erase(iterator pos)
+{
+    iterator next = pos;
+    ++next;
+    return erase(pos, next);
+}
+
+/**
+* Removes the items in [first, last) with one shift of each array and
+* returns the iterator following them.
+*/
+template<class Key, class Value>
+typename FlatMap<Key, Value>::iterator
+FlatMap<Key, Value>::erase(iterator first, iterator last)
+{
+    merge();
+    keys_.erase(keys_.begin() + first.index_, keys_.begin() + last.index_);
+    values_.erase(values_.begin() + first.index_, values_.begin() + last.index_);
+    return iterator(this, first.index_);
+}
+
+/**
+* Helper function to find the index of key in the arrays (their size if
+* it is not there). The staging area is merged first, even on a miss:
+* end() and the other iterators merge too, so an index taken before a
+* merge would point at a different entry afterwards.
+*/
+template<class Key, class Value>
+size_t FlatMap<Key, Value>::internalFind(const Key& key) const
+{
+    merge();
+    size_t i = lowerBound(key, 0, keys_.size());
+    if(i < keys_.size() && !(key < keys_[i])){
+      return i;
+    }
+    return keys_.size();
+}
+
+/**
+* Branchless binary search: each step halves the range by moving base
+* or not, a select instead of a branch the predictor would miss half
+* the time. The two possible next probes are prefetched, so on a large
+* array the next level's load is under way before the compare resolves.
+*/
+template<class Key, class Value>
+size_t FlatMap<Key, Value>::lowerBound(const Key& key, size_t first, size_t last) const
+{
+    if(first >= last){
+      return first;
+    }
+    const Key* base = keys_.data() + first;
+    size_t n = last - first;
+    while(n > 1){
+      size_t half = n / 2;
+      BST_PREFETCH(base + half / 2);
+      BST_PREFETCH(base + half + half / 2);
+      base = (base[half] < key) ? base + half : base;
+      n -= half;
+    }
+    return (base - keys_.data()) + (*base < key);
+}
+
+// HELPER: linear search of the (small, unsorted) staging area
+template<class Key, class Value>
+size_t FlatMap<Key, Value>::stagedFind(const Key& key) const
+{
+    for(size_t i = 0; i < staged_.size(); i++){
+      if(!(staged_[i].first < key) && !(key < staged_[i].first)){
+        return i;
+      }
+    }
+    return staged_.size();
+}
+
+// HELPER: staged entries by key
+template<class Key, class Value>
+bool FlatMap<Key, Value>::stagedLess(const std::pair<Key, Value>& a, const std::pair<Key, Value>& b)
+{
+    return a.first < b.first;
+}
+
+/**
+* Sorts the staged entries and merges them into the arrays from the back,
+* in place: O(n + s log s) for s staged entries, so O(n / FLATMAP_STAGING)
+* per insert. Staged keys are never in the arrays, so there are no ties.
+*/
+template<class Key, class Value>
+void FlatMap<Key, Value>::merge() const
+{
+    if(staged_.empty()){
+      return;
+    }
+    std::sort(staged_.begin(), staged_.end(), stagedLess);
+
+    size_t i = keys_.size();
+    size_t j = staged_.size();
+    // grow by the staged entries, then fill from the back
+    for(size_t s = 0; s < staged_.size(); s++){
+      keys_.push_back(staged_[s].first);
+      values_.push_back(staged_[s].second);
+    }
+    size_t k = keys_.size();
+    while(j > 0){
+      if(i > 0 && staged_[j - 1].first < keys_[i - 1]){
+        keys_[k - 1] = std::move(keys_[i - 1]);
+        values_[k - 1] = std::move(values_[i - 1]);
+        i--;
+      }
+      else {
+        keys_[k - 1] = std::move(staged_[j - 1].first);
+        values_[k - 1] = std::move(staged_[j - 1].second);
+        j--;
+      }
+      k--;
+    }
+    staged_.clear();
+}
+
+/*
+---------------------------------------------------
+End implementations for the FlatMap class.
+---------------------------------------------------
+*/
+
+#endif
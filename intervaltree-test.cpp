@@ -0,0 +1,38 @@
+#include <iostream>
+#include <string>
+#include "intervaltree.h"
+
+using namespace std;
+
+// prints each match as it is found
+struct PrintInterval
+{
+    void operator()(const std::pair<const Interval<int>, string>& item) const
+    {
+        cout << "  " << item.first << " " << item.second << endl;
+    }
+};
+
+
+int main(int argc, char *argv[])
+{
+    // Interval Tree tests: room reservations by hour
+    IntervalTree<int,string> rooms;
+    rooms.insert(std::make_pair(Interval<int>(9, 11), string("standup")));
+    rooms.insert(std::make_pair(Interval<int>(10, 12), string("review")));
+    rooms.insert(std::make_pair(Interval<int>(13, 15), string("planning")));
+    rooms.insert(std::make_pair(Interval<int>(14, 18), string("offsite")));
+    rooms.insert(std::make_pair(Interval<int>(20, 21), string("dinner")));
+
+    cout << "Booked at 10:" << endl;
+    rooms.stab(10, PrintInterval());
+    cout << "Booked in [11, 14):" << endl;
+    rooms.overlap(11, 14, PrintInterval());
+
+    rooms.remove(Interval<int>(13, 15));
+    int count = 0;
+    rooms.overlap(12, 20, [&count](const std::pair<const Interval<int>, string>&) { count++; });
+    cout << "Bookings in [12, 20) after cancelling planning: " << count << endl;
+
+    return 0;
+}
@@ -0,0 +1,288 @@
+#ifndef INTERVALTREE_H
+#define INTERVALTREE_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <cstdint>
+#include <utility>
+#include "avlbst.h"
+
+/**
+* A half-open interval [start, end), the key type of IntervalTree.
+* Intervals are ordered by start, then by end.
+*/
+template <typename T>
+struct Interval
+{
+    Interval();
+    Interval(const T& start, const T& end);
+
+    T start;
+    T end;
+};
+
+/**
+* Default constructor, needed by the tree's key handling.
+*/
+template<class T>
+Interval<T>::Interval() :
+    start(), end()
+{
+
+}
+
+/**
+* Builds [start, end).
+*/
+template<class T>
+Interval<T>::Interval(const T& start, const T& end) :
+    start(start), end(end)
+{
+
+}
+
+/**
+* Orders by start, then by end.
+*/
+template<class T>
+bool operator<(const Interval<T>& a, const Interval<T>& b)
+{
+    return a.start < b.start || (!(b.start < a.start) && a.end < b.end);
+}
+
+/**
+* The reverse order, which the tree's removal code compares with.
+*/
+template<class T>
+bool operator>(const Interval<T>& a, const Interval<T>& b)
+{
+    return b < a;
+}
+
+/**
+* Same start and same end.
+*/
+template<class T>
+bool operator==(const Interval<T>& a, const Interval<T>& b)
+{
+    return !(a < b) && !(b < a);
+}
+
+/**
+* Different start or different end.
+*/
+template<class T>
+bool operator!=(const Interval<T>& a, const Interval<T>& b)
+{
+    return !(a == b);
+}
+
+/**
+* Prints [start, end), so the trees' print() works.
+*/
+template<class T>
+std::ostream& operator<<(std::ostream& os, const Interval<T>& interval)
+{
+    return os << "[" << interval.start << ", " << interval.end << ")";
+}
+
+/**
+* An AVL node keyed by a half-open interval [start, end) that also stores
+* the largest end point found in its subtree.
+*/
+template <typename T, typename Value>
+class IntervalNode : public AVLNode<Interval<T>, Value>
+{
+public:
+    IntervalNode(const Interval<T>& key, const Value& value, AVLNode<Interval<T>, Value>* parent);
+    virtual ~IntervalNode();
+
+    const T& getMaxEnd() const;
+    virtual bool refreshAggregate();
+    virtual void swapAggregate(AVLNode<Interval<T>, Value>* other);
+
+protected:
+    T maxEnd_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the IntervalNode class.
+  -------------------------------------------------
+*/
+
+/**
+* An explicit constructor; a new node is a leaf, so the largest end point
+* is its own.
+*/
+template<class T, class Value>
+IntervalNode<T, Value>::IntervalNode(const Interval<T>& key, const Value& value, AVLNode<Interval<T>, Value>* parent) :
+    AVLNode<Interval<T>, Value>(key, value, parent), maxEnd_(key.end)
+{
+
+}
+
+/**
+* A destructor which does nothing.
+*/
+template<class T, class Value>
+IntervalNode<T, Value>::~IntervalNode()
+{
+
+}
+
+/**
+* A getter for the largest end point in the subtree rooted here.
+*/
+template<class T, class Value>
+const T& IntervalNode<T, Value>::getMaxEnd() const
+{
+    return maxEnd_;
+}
+
+/**
+* Recomputes the largest end point from the node's own interval and its
+* children, which must already be up to date.
+*/
+template<class T, class Value>
+bool IntervalNode<T, Value>::refreshAggregate()
+{
+    IntervalNode<T, Value>* left = static_cast<IntervalNode<T, Value>*>(this->children_[0]);
+    IntervalNode<T, Value>* right = static_cast<IntervalNode<T, Value>*>(this->children_[1]);
+    maxEnd_ = this->getKey().end;
+    if(left != NULL && maxEnd_ < left->maxEnd_){
+      maxEnd_ = left->maxEnd_;
+    }
+    if(right != NULL && maxEnd_ < right->maxEnd_){
+      maxEnd_ = right->maxEnd_;
+    }
+    return true;
+}
+
+/**
+* Trades largest end points with other, which must be an IntervalNode too.
+*/
+template<class T, class Value>
+void IntervalNode<T, Value>::swapAggregate(AVLNode<Interval<T>, Value>* other)
+{
+    std::swap(maxEnd_, static_cast<IntervalNode<T, Value>*>(other)->maxEnd_);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the IntervalNode class.
+  -----------------------------------------------
+*/
+
+/**
+* An AVLTree of half-open intervals [start, end), ordered by start and
+* then end, each mapped to a value. Every node tracks the largest end
+* point below it (kept up to date through rotations by AVLTree's
+* subtree aggregate hooks, as in AggregateAVLTree), so a search can skip any subtree that ends
+* before the query starts, and everything right of a node that starts
+* after the query ends.
+*
+* Queries stream their matches in start order to a callback taking
+* const std::pair<const Interval<T>, Value>&; nothing is collected.
+*/
+template <class T, class Value>
+class IntervalTree : public AVLTree<Interval<T>, Value>
+{
+public:
+    typedef IntervalNode<T, Value> NodeType;
+
+    // calls visit on every interval containing point
+    template <class Visitor>
+    void stab(const T& point, Visitor visit) const;
+    // calls visit on every interval overlapping [lo, hi)
+    template <class Visitor>
+    void overlap(const T& lo, const T& hi, Visitor visit) const;
+
+protected:
+    virtual NodeType* createNode(const Interval<T>& key, const Value& value, Node<Interval<T>, Value>* parent);
+    virtual size_t nodeSize() const;
+
+    //HELPERS:
+    template <class Visitor>
+    static void visitOverlaps(NodeType* n, const T& lo, const T& hi, bool closedHi, Visitor& visit);
+};
+
+/*
+-----------------------------------------------------
+Begin implementations for the IntervalTree class.
+-----------------------------------------------------
+*/
+
+/**
+* Reports the intervals with start <= point < end. Only subtrees that end
+* after point are entered, so k matches cost O(min(n, (k + 1) log n)).
+*/
+template<class T, class Value>
+template<class Visitor>
+void IntervalTree<T, Value>::stab(const T& point, Visitor visit) const
+{
+    visitOverlaps(static_cast<NodeType*>(this->root_), point, point, true, visit);
+}
+
+/**
+* Reports the intervals with start < hi and lo < end, in
+* O(min(n, (k + 1) log n)) for k matches, as for stab(). An empty query
+* range matches nothing.
+*/
+template<class T, class Value>
+template<class Visitor>
+void IntervalTree<T, Value>::overlap(const T& lo, const T& hi, Visitor visit) const
+{
+    if(!(lo < hi)){
+      return;
+    }
+    visitOverlaps(static_cast<NodeType*>(this->root_), lo, hi, false, visit);
+}
+
+// HELPER: in-order walk of the intervals ending after lo and starting
+// before hi (or at hi, when closedHi), pruned by the subtree maxima
+template<class T, class Value>
+template<class Visitor>
+void IntervalTree<T, Value>::visitOverlaps(NodeType* n, const T& lo, const T& hi, bool closedHi, Visitor& visit)
+{
+    while(n != NULL){
+      // nothing below ends after lo
+      if(!(lo < n->getMaxEnd())){
+        return;
+      }
+      visitOverlaps(static_cast<NodeType*>(n->getLeft()), lo, hi, closedHi, visit);
+
+      // n and everything right of it start too late
+      const T& start = n->getKey().start;
+      if(closedHi ? (hi < start) : !(start < hi)){
+        return;
+      }
+      if(lo < n->getKey().end){
+        visit(n->getItem());
+      }
+      n = static_cast<NodeType*>(n->getRight());
+    }
+}
+
+// HELPER: every node of the tree tracks its subtree's largest end point
+template<class T, class Value>
+typename IntervalTree<T, Value>::NodeType*
+IntervalTree<T, Value>::createNode(const Interval<T>& key, const Value& value, Node<Interval<T>, Value>* parent)
+{
+    return new NodeType(key, value, static_cast<AVLNode<Interval<T>, Value>*>(parent));
+}
+
+template<class T, class Value>
+size_t IntervalTree<T, Value>::nodeSize() const
+{
+    return sizeof(NodeType);
+}
+
+/*
+------------------------------------------------------------
+End implementations for the IntervalTree class.
+------------------------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,124 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <random>
+#include <cstdint>
+#include <cstdlib>
+#include "bst.h"
+#include "avlbst.h"
+#include "threadedavl.h"
+#include "aggregateavl.h"
+#include "stackavl.h"
+#include "compactavl.h"
+#include "persistentavl.h"
+#include "bstset.h"
+#include "radixtree.h"
+#include "flatmap.h"
+
+using namespace std;
+
+// Fills every engine with the same entries and prints what memory_usage()
+// reports, per entry, so engines can be compared by bytes per entry.
+// Usage: memory-report [number of entries]
+
+template<typename Tree, typename Key, typename Value>
+void report(const char* name, const vector<pair<Key, Value> >& items)
+{
+    Tree tree;
+    for(size_t i = 0; i < items.size(); i++) {
+        tree.insert(std::make_pair(items[i].first, items[i].second));
+    }
+    MemoryUsage usage = tree.memory_usage();
+    double n = (usage.entries == 0) ? 1.0 : (double)usage.entries;
+    cout << setw(20) << name << setw(10) << usage.entries
+         << setw(10) << usage.headerBytes / n << setw(10) << usage.payloadBytes / n
+         << setw(10) << usage.slackBytes / n << setw(10) << usage.ownedBytes / n
+         << setw(10) << usage.bytesPerEntry() << endl;
+}
+
+// the same for a set: only the keys are inserted
+template<typename Set, typename Key, typename Value>
+void reportSet(const char* name, const vector<pair<Key, Value> >& items)
+{
+    Set set;
+    for(size_t i = 0; i < items.size(); i++) {
+        set.insert(items[i].first);
+    }
+    MemoryUsage usage = set.memory_usage();
+    double n = (usage.entries == 0) ? 1.0 : (double)usage.entries;
+    cout << setw(20) << name << setw(10) << usage.entries
+         << setw(10) << usage.headerBytes / n << setw(10) << usage.payloadBytes / n
+         << setw(10) << usage.slackBytes / n << setw(10) << usage.ownedBytes / n
+         << setw(10) << usage.bytesPerEntry() << endl;
+}
+
+static void header(const char* title)
+{
+    cout << title << endl;
+    cout << setw(20) << "engine" << setw(10) << "entries" << setw(10) << "headers" << setw(10) << "payload"
+         << setw(10) << "slack" << setw(10) << "owned" << setw(10) << "total" << endl;
+}
+
+template<typename Key, typename Value>
+void reportAll(const char* title, const vector<pair<Key, Value> >& items)
+{
+    header(title);
+    report<BinarySearchTree<Key, Value> >("BinarySearchTree", items);
+    report<AVLTree<Key, Value> >("AVLTree", items);
+    report<ThreadedAVLTree<Key, Value> >("ThreadedAVLTree", items);
+    report<StackAVLTree<Key, Value> >("StackAVLTree", items);
+    report<CompactAVLTree<Key, Value> >("CompactAVLTree", items);
+    report<CompactAVLTree<Key, Value, CompactSplitStorage<Key, Value> > >("CompactAVL (split)", items);
+    report<PersistentAVLTree<Key, Value> >("PersistentAVLTree", items);
+    report<AdaptiveRadixTree<Key, Value> >("AdaptiveRadixTree", items);
+    report<FlatMap<Key, Value> >("FlatMap", items);
+    cout << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = (argc > 1) ? strtoull(argv[1], NULL, 10) : 100000;
+    cout << fixed << setprecision(1);
+    mt19937_64 rng(44);
+
+    vector<pair<uint64_t, uint64_t> > numbers;
+    vector<pair<string, uint64_t> > strings;
+    for(size_t i = 0; i < n; i++) {
+        uint64_t key = rng();
+        numbers.push_back(make_pair(key, i));
+        // 24 characters: past the short string buffer, so each key owns memory
+        strings.push_back(make_pair(to_string(key % 1000000000000ULL) + "-session-key", i));
+    }
+
+    reportAll("uint64_t -> uint64_t, bytes per entry:", numbers);
+    reportAll("string -> uint64_t, bytes per entry:", strings);
+
+    // the aggregate tree needs an associative Combine over the values
+    header("uint64_t -> uint64_t with a sum aggregate, bytes per entry:");
+    report<AggregateAVLTree<uint64_t, uint64_t> >("AggregateAVLTree", numbers);
+    cout << endl;
+
+    // sets: a map to char against the key-only nodes of the set engines
+    vector<pair<uint64_t, char> > members;
+    for(size_t i = 0; i < numbers.size(); i++) {
+        members.push_back(make_pair(numbers[i].first, 'x'));
+    }
+    header("uint64_t set, bytes per entry:");
+    report<BinarySearchTree<uint64_t, char> >("BST<uint64_t,char>", members);
+    reportSet<BSTSet<uint64_t> >("BSTSet", members);
+    report<AVLTree<uint64_t, char> >("AVLTree<uint64_t,char>", members);
+    reportSet<AVLSet<uint64_t> >("AVLSet", members);
+    cout << endl;
+
+    vector<pair<uint32_t, char> > smallMembers;
+    for(size_t i = 0; i < numbers.size(); i++) {
+        smallMembers.push_back(make_pair((uint32_t)numbers[i].first, 'x'));
+    }
+    header("uint32_t set, bytes per entry:");
+    report<BinarySearchTree<uint32_t, char> >("BST<uint32_t,char>", smallMembers);
+    reportSet<BSTSet<uint32_t> >("BSTSet", smallMembers);
+    report<AVLTree<uint32_t, char> >("AVLTree<uint32_t,char>", smallMembers);
+    reportSet<AVLSet<uint32_t> >("AVLSet", smallMembers);
+    return 0;
+}
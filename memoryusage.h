@@ -0,0 +1,209 @@
+#ifndef MEMORYUSAGE_H
+#define MEMORYUSAGE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+// What the allocator is assumed to add to each block: a size header, then
+// rounding up to its alignment, with a smallest block (64-bit glibc malloc)
+#define MEMORY_MALLOC_HEADER 8
+#define MEMORY_MALLOC_ALIGN 16
+#define MEMORY_MALLOC_MIN 32
+
+/**
+* Estimated bytes the allocator really takes for a request of bytes,
+* 0 for nothing.
+*/
+inline size_t mallocBlockBytes(size_t bytes)
+{
+    if(bytes == 0){
+      return 0;
+    }
+    size_t block = (bytes + MEMORY_MALLOC_HEADER + MEMORY_MALLOC_ALIGN - 1) / MEMORY_MALLOC_ALIGN * MEMORY_MALLOC_ALIGN;
+    return (block < MEMORY_MALLOC_MIN) ? MEMORY_MALLOC_MIN : block;
+}
+
+/**
+* Size trait: the heap memory a key or value owns beyond its own sizeof.
+* Nothing by default; specialize it for types that own more, the way it
+* is done below for strings, vectors and pairs.
+*/
+template <typename T>
+struct HeapBytes
+{
+    static size_t of(const T& item)
+    {
+        return 0;
+    }
+};
+
+/**
+* A string owns its buffer unless the characters are stored inside the
+* string object itself (the short string optimization).
+*/
+template <>
+struct HeapBytes<std::string>
+{
+    static size_t of(const std::string& item)
+    {
+        const char* data = item.data();
+        const char* self = reinterpret_cast<const char*>(&item);
+        if(data >= self && data < self + sizeof(item)){
+          return 0;
+        }
+        return item.capacity() + 1;
+    }
+};
+
+/**
+* A vector owns its capacity, and whatever its elements own.
+*/
+template <typename T>
+struct HeapBytes<std::vector<T> >
+{
+    static size_t of(const std::vector<T>& item)
+    {
+        size_t bytes = item.capacity() * sizeof(T);
+        for(size_t i = 0; i < item.size(); i++){
+          bytes += HeapBytes<T>::of(item[i]);
+        }
+        return bytes;
+    }
+};
+
+/**
+* A pair owns what its two members own.
+*/
+template <typename A, typename B>
+struct HeapBytes<std::pair<A, B> >
+{
+    static size_t of(const std::pair<A, B>& item)
+    {
+        return HeapBytes<A>::of(item.first) + HeapBytes<B>::of(item.second);
+    }
+};
+
+/**
+* The memory a tree uses, as reported by memory_usage(). The tree object
+* itself is not included.
+*/
+struct MemoryUsage
+{
+    MemoryUsage();
+
+    size_t total() const;
+    double bytesPerEntry() const;
+    void print(std::ostream& os) const;
+    // counts one entry and what its key and value own
+    template <typename Key, typename Value>
+    void addEntry(const std::pair<const Key, Value>& item);
+    template <typename Key, typename Value>
+    void addEntry(const Key& key, const Value& value);
+    // counts count nodes of nodeBytes each, every one its own allocation
+    template <typename Key, typename Value>
+    void addNodes(size_t count, size_t nodeBytes);
+    // the same, for nodes holding payload bytes of entry each
+    void addNodes(size_t count, size_t nodeBytes, size_t payload);
+
+    size_t entries;
+    // node bookkeeping: vtable pointer, links, balance or height, padding
+    size_t headerBytes;
+    // the key/value pairs stored in the nodes
+    size_t payloadBytes;
+    // allocator headers and rounding, and capacity reserved but unused
+    size_t slackBytes;
+    // heap memory owned by keys and values, as HeapBytes reports it
+    size_t ownedBytes;
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the MemoryUsage class.
+  -----------------------------------------------
+*/
+
+/**
+* Default constructor, the usage of an empty tree.
+*/
+inline MemoryUsage::MemoryUsage() :
+    entries(0), headerBytes(0), payloadBytes(0), slackBytes(0), ownedBytes(0)
+{
+
+}
+
+/**
+* Every byte counted.
+*/
+inline size_t MemoryUsage::total() const
+{
+    return headerBytes + payloadBytes + slackBytes + ownedBytes;
+}
+
+/**
+* Total bytes divided by entries, 0 for an empty tree.
+*/
+inline double MemoryUsage::bytesPerEntry() const
+{
+    return (entries == 0) ? 0.0 : (double)total() / entries;
+}
+
+/**
+* Prints the breakdown on one line.
+*/
+inline void MemoryUsage::print(std::ostream& os) const
+{
+    os << "entries " << entries << ", headers " << headerBytes << ", payload " << payloadBytes
+       << ", slack " << slackBytes << ", owned " << ownedBytes << ", total " << total()
+       << " (" << bytesPerEntry() << " per entry)" << std::endl;
+}
+
+/**
+* Counts one entry and the heap memory its key and value own.
+*/
+template <typename Key, typename Value>
+void MemoryUsage::addEntry(const std::pair<const Key, Value>& item)
+{
+    addEntry<Key, Value>(item.first, item.second);
+}
+
+/**
+* Counts one entry whose key and value are stored apart.
+*/
+template <typename Key, typename Value>
+void MemoryUsage::addEntry(const Key& key, const Value& value)
+{
+    entries++;
+    ownedBytes += HeapBytes<Key>::of(key) + HeapBytes<Value>::of(value);
+}
+
+/**
+* Splits count separately allocated nodes of nodeBytes each into header,
+* payload and allocator slack.
+*/
+template <typename Key, typename Value>
+void MemoryUsage::addNodes(size_t count, size_t nodeBytes)
+{
+    addNodes(count, nodeBytes, sizeof(std::pair<const Key, Value>));
+}
+
+/**
+* Splits count separately allocated nodes of nodeBytes each, payload of
+* which is the entry itself.
+*/
+inline void MemoryUsage::addNodes(size_t count, size_t nodeBytes, size_t payload)
+{
+    headerBytes += count * (nodeBytes - payload);
+    payloadBytes += count * payload;
+    slackBytes += count * (mallocBlockBytes(nodeBytes) - nodeBytes);
+}
+
+/*
+  ---------------------------------------------
+  End implementations for the MemoryUsage class.
+  ---------------------------------------------
+*/
+
+#endif
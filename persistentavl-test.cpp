@@ -0,0 +1,65 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include "persistentavl.h"
+
+using namespace std;
+
+
+int main(int argc, char *argv[])
+{
+    // Persistent AVL Tree tests
+    PersistentAVLTree<char,int> pt;
+    pt.insert(std::make_pair('a',1));
+    pt.insert(std::make_pair('b',2));
+    pt.insert(std::make_pair('c',3));
+
+    PersistentAVLTree<char,int>::Snapshot before = pt.snapshot();
+    pt.remove('b');
+    pt.insert(std::make_pair('a',10));
+
+    cout << "Current contents:" << endl;
+    for(PersistentAVLTree<char,int>::iterator it = pt.begin(); it != pt.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    cout << "Snapshot contents:" << endl;
+    for(PersistentAVLTree<char,int>::iterator it = before.begin(); it != before.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+
+    // one writer appends 0, 1, 2, ... while readers snapshot and walk;
+    // every version they see must be exactly 0..n-1 for some n
+    PersistentAVLTree<int,int> shared;
+    atomic<bool> done(false);
+    atomic<int> badVersions(0);
+    atomic<int> versionsRead(0);
+    vector<thread> readers;
+    for(int t = 0; t < 3; t++) {
+        readers.push_back(thread([&]() {
+            while(!done.load()) {
+                PersistentAVLTree<int,int>::Snapshot snap = shared.snapshot();
+                int expected = 0;
+                for(PersistentAVLTree<int,int>::iterator it = snap.begin(); it != snap.end(); ++it) {
+                    if(it->first != expected || it->second != expected * 10) {
+                        badVersions++;
+                        break;
+                    }
+                    expected++;
+                }
+                versionsRead++;
+            }
+        }));
+    }
+    for(int k = 0; k < 5000; k++) {
+        shared.insert(std::make_pair(k, k * 10));
+    }
+    done.store(true);
+    for(size_t t = 0; t < readers.size(); t++) {
+        readers[t].join();
+    }
+    cout << "Inconsistent versions seen: " << badVersions.load()
+         << " (of " << versionsRead.load() << " read)" << endl;
+
+    return 0;
+}
@@ -0,0 +1,774 @@
+#ifndef PERSISTENTAVL_H
+#define PERSISTENTAVL_H
+
+#include <iostream>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <utility>
+#include <cstdlib>
+#include <cstdint>
+#include "memoryusage.h"
+
+// Deepest path an iterator can hold, see STACKAVL_MAX_HEIGHT
+#define PERSISTENTAVL_MAX_HEIGHT 64
+
+/**
+* A node of the persistent AVL tree. Nodes never change once built, so
+* any number of versions can share them; a reference count records how
+* many parents and version roots point at a node, and the last release
+* frees it.
+*/
+template <typename Key, typename Value>
+class PersistentAVLNode
+{
+public:
+    PersistentAVLNode(const std::pair<const Key, Value>& item,
+                      PersistentAVLNode<Key, Value>* left, PersistentAVLNode<Key, Value>* right);
+
+    const std::pair<const Key, Value>& getItem() const;
+    const Key& getKey() const;
+    const Value& getValue() const;
+    PersistentAVLNode<Key, Value>* getLeft() const;
+    PersistentAVLNode<Key, Value>* getRight() const;
+    int getHeight() const;
+
+    // take and drop a reference; both accept NULL
+    static PersistentAVLNode<Key, Value>* retain(PersistentAVLNode<Key, Value>* n);
+    static void release(PersistentAVLNode<Key, Value>* n);
+
+protected:
+    const std::pair<const Key, Value> item_;
+    PersistentAVLNode<Key, Value>* const left_;
+    PersistentAVLNode<Key, Value>* const right_;
+    const int height_;
+    std::atomic<int> refs_;
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the PersistentAVLNode class.
+  -----------------------------------------------
+*/
+
+/**
+* Builds a node over two subtrees, taking over the caller's references
+* to them. The new node starts with one reference, owned by the caller.
+*/
+template<typename Key, typename Value>
+PersistentAVLNode<Key, Value>::PersistentAVLNode(const std::pair<const Key, Value>& item,
+                                                 PersistentAVLNode<Key, Value>* left, PersistentAVLNode<Key, Value>* right) :
+    item_(item),
+    left_(left),
+    right_(right),
+    height_(1 + std::max(left == NULL ? 0 : left->getHeight(), right == NULL ? 0 : right->getHeight())),
+    refs_(1)
+{
+
+}
+
+/**
+* A const getter for the item.
+*/
+template<typename Key, typename Value>
+const std::pair<const Key, Value>& PersistentAVLNode<Key, Value>::getItem() const
+{
+    return item_;
+}
+
+/**
+* A const getter for the key.
+*/
+template<typename Key, typename Value>
+const Key& PersistentAVLNode<Key, Value>::getKey() const
+{
+    return item_.first;
+}
+
+/**
+* A const getter for the value.
+*/
+template<typename Key, typename Value>
+const Value& PersistentAVLNode<Key, Value>::getValue() const
+{
+    return item_.second;
+}
+
+/**
+* A getter for the left child.
+*/
+template<typename Key, typename Value>
+PersistentAVLNode<Key, Value>* PersistentAVLNode<Key, Value>::getLeft() const
+{
+    return left_;
+}
+
+/**
+* A getter for the right child.
+*/
+template<typename Key, typename Value>
+PersistentAVLNode<Key, Value>* PersistentAVLNode<Key, Value>::getRight() const
+{
+    return right_;
+}
+
+/**
+* A getter for the height of the subtree rooted here, 1 for a leaf.
+*/
+template<typename Key, typename Value>
+int PersistentAVLNode<Key, Value>::getHeight() const
+{
+    return height_;
+}
+
+/**
+* Adds a reference to n and returns it.
+*/
+template<typename Key, typename Value>
+PersistentAVLNode<Key, Value>* PersistentAVLNode<Key, Value>::retain(PersistentAVLNode<Key, Value>* n)
+{
+    if(n != NULL){
+      n->refs_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return n;
+}
+
+/**
+* Drops a reference to n, freeing it (and releasing its children) when
+* it was the last. The acquire/release pair orders every use of the node
+* by other threads before its deletion.
+*/
+template<typename Key, typename Value>
+void PersistentAVLNode<Key, Value>::release(PersistentAVLNode<Key, Value>* n)
+{
+    while(n != NULL && n->refs_.fetch_sub(1, std::memory_order_acq_rel) == 1){
+      PersistentAVLNode<Key, Value>* right = n->right_;
+      release(n->left_);
+      delete n;
+      // loop on the right child instead of recursing
+      n = right;
+    }
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the PersistentAVLNode class.
+  -----------------------------------------------
+*/
+
+/**
+* A persistent AVL tree: insert and remove never modify a node. They
+* build new copies of the O(log n) nodes on the root-to-leaf path (plus
+* any rotated ones) and share every other subtree with the previous
+* version, so a version stays intact for as long as someone holds it.
+*
+* snapshot() pins the current version in O(1). Snapshots may be taken,
+* read, copied and dropped from any thread while a single writer keeps
+* calling insert/remove; every snapshot sees one consistent version.
+* Besides snapshot(), only the writer thread may use the tree itself.
+*
+* Nodes are immutable, so iterators give const access only.
+*/
+template <typename Key, typename Value>
+class PersistentAVLTree
+{
+public:
+    typedef PersistentAVLNode<Key, Value> NodeType;
+
+    /**
+    * An in-order iterator holding a bounded stack of pending nodes, as in
+    * StackAVLTree. It is valid while the version it walks is alive.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        const std::pair<const Key,Value>& operator*() const;
+        const std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class PersistentAVLTree<Key, Value>;
+        void pushLeftSpine(NodeType* n);
+        NodeType* current() const;
+
+        NodeType* stack_[PERSISTENTAVL_MAX_HEIGHT];
+        int depth_;
+    };
+
+    /**
+    * A read-only handle on one version of the tree. Copying a snapshot
+    * is O(1); the version is freed when its last snapshot (and the tree,
+    * if it is still current) lets go of it.
+    */
+    class Snapshot
+    {
+    public:
+        Snapshot();
+        Snapshot(const Snapshot& other);
+        Snapshot& operator=(const Snapshot& other);
+        ~Snapshot();
+
+        iterator begin() const;
+        iterator end() const;
+        iterator find(const Key& key) const;
+        bool empty() const;
+
+    protected:
+        friend class PersistentAVLTree<Key, Value>;
+        explicit Snapshot(NodeType* root);
+
+        NodeType* root_;
+    };
+
+    PersistentAVLTree();
+    ~PersistentAVLTree();
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool empty() const;
+    Snapshot snapshot() const;
+    // bytes used by the current version's nodes, some of which older
+    // snapshots may share; O(n)
+    MemoryUsage memory_usage() const;
+
+    // iterators into the current version, valid until the next change
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+
+protected:
+    static NodeType* internalFind(NodeType* root, const Key& key);
+    static iterator findIn(NodeType* root, const Key& key);
+    static int height(NodeType* n);
+
+    //HELPERS: each takes over the references it is given and returns an
+    //owned reference to the new subtree
+    static NodeType* makeBalanced(const std::pair<const Key, Value>& item, NodeType* left, NodeType* right);
+    static NodeType* insertAt(NodeType* n, const std::pair<const Key, Value>& item);
+    static NodeType* removeAt(NodeType* n, const Key& key);
+    static NodeType* removeMin(NodeType* n, NodeType*& min);
+    void publish(NodeType* root);
+
+protected:
+    NodeType* root_;
+    // orders snapshot() in other threads against the writer replacing root_
+    mutable std::mutex rootLock_;
+};
+
+/*
+--------------------------------------------------------------
+Begin implementations for the PersistentAVLTree::iterator class.
+---------------------------------------------------------------
+*/
+
+/**
+* A default constructor that initializes the iterator to end().
+*/
+template<class Key, class Value>
+PersistentAVLTree<Key, Value>::iterator::iterator() :
+    depth_(0)
+{
+
+}
+
+/**
+* Pushes n and its chain of left children (the next nodes in order).
+*/
+template<class Key, class Value>
+void PersistentAVLTree<Key, Value>::iterator::pushLeftSpine(NodeType* n)
+{
+    while(n != NULL){
+      stack_[depth_++] = n;
+      n = n->getLeft();
+    }
+}
+
+/**
+* The node the iterator is on, or NULL at end().
+*/
+template<class Key, class Value>
+typename PersistentAVLTree<Key, Value>::NodeType*
+PersistentAVLTree<Key, Value>::iterator::current() const
+{
+    return depth_ == 0 ? NULL : stack_[depth_ - 1];
+}
+
+/**
+* Provides access to the item.
+*/
+template<class Key, class Value>
+const std::pair<const Key,Value> &
+PersistentAVLTree<Key, Value>::iterator::operator*() const
+{
+    return current()->getItem();
+}
+
+/**
+* Provides access to the address of the item.
+*/
+template<class Key, class Value>
+const std::pair<const Key,Value> *
+PersistentAVLTree<Key, Value>::iterator::operator->() const
+{
+    return &(current()->getItem());
+}
+
+/**
+* Checks if 'this' iterator is on the same node as 'rhs'
+*/
+template<class Key, class Value>
+bool
+PersistentAVLTree<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    return current() == rhs.current();
+}
+
+/**
+* Checks if 'this' iterator is on a different node than 'rhs'
+*/
+template<class Key, class Value>
+bool
+PersistentAVLTree<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return current() != rhs.current();
+}
+
+/**
+* Advance the iterator's location using an in-order sequencing
+*/
+template<class Key, class Value>
+typename PersistentAVLTree<Key, Value>::iterator&
+PersistentAVLTree<Key, Value>::iterator::operator++()
+{
+    NodeType* n = stack_[--depth_];
+    pushLeftSpine(n->getRight());
+    return *this;
+}
+
+/*
+-------------------------------------------------------------
+End implementations for the PersistentAVLTree::iterator class.
+-------------------------------------------------------------
+*/
+
+/*
+--------------------------------------------------------------
+Begin implementations for the PersistentAVLTree::Snapshot class.
+---------------------------------------------------------------
+*/
+
+/**
+* A default constructor for a snapshot of an empty tree.
+*/
+template<class Key, class Value>
+PersistentAVLTree<Key, Value>::Snapshot::Snapshot() :
+    root_(NULL)
+{
+
+}
+
+/**
+* Takes over an owned reference to root.
+*/
+template<class Key, class Value>
+PersistentAVLTree<Key, Value>::Snapshot::Snapshot(NodeType* root) :
+    root_(root)
+{
+
+}
+
+/**
+* Shares other's version.
+*/
+template<class Key, class Value>
+PersistentAVLTree<Key, Value>::Snapshot::Snapshot(const Snapshot& other) :
+    root_(NodeType::retain(other.root_))
+{
+
+}
+
+/**
+* Switches to other's version, letting go of the old one.
+*/
+template<class Key, class Value>
+typename PersistentAVLTree<Key, Value>::Snapshot&
+PersistentAVLTree<Key, Value>::Snapshot::operator=(const Snapshot& other)
+{
+    NodeType* old = root_;
+    root_ = NodeType::retain(other.root_);
+    NodeType::release(old);
+    return *this;
+}
+
+/**
+* Lets go of the version.
+*/
+template<class Key, class Value>
+PersistentAVLTree<Key, Value>::Snapshot::~Snapshot()
+{
+    NodeType::release(root_);
+}
+
+/**
+* Returns an iterator to the smallest item of this version.
+*/
+template<class Key, class Value>
+typename PersistentAVLTree<Key, Value>::iterator
+PersistentAVLTree<Key, Value>::Snapshot::begin() const
+{
+    iterator it;
+    it.pushLeftSpine(root_);
+    return it;
+}
+
+/**
+* Returns the end iterator.
+*/
+template<class Key, class Value>
+typename PersistentAVLTree<Key, Value>::iterator
+PersistentAVLTree<Key, Value>::Snapshot::end() const
+{
+    return iterator();
+}
+
+/**
+* Looks key up in this version.
+*/
+template<class Key, class Value>
+typename PersistentAVLTree<Key, Value>::iterator
+PersistentAVLTree<Key, Value>::Snapshot::find(const Key& key) const
+{
+    return findIn(root_, key);
+}
+
+/**
+* Returns true if this version has no items.
+*/
+template<class Key, class Value>
+bool PersistentAVLTree<Key, Value>::Snapshot::empty() const
+{
+    return root_ == NULL;
+}
+
+/*
+-------------------------------------------------------------
+End implementations for the PersistentAVLTree::Snapshot class.
+-------------------------------------------------------------
+*/
+
+/*
+-----------------------------------------------------
+Begin implementations for the PersistentAVLTree class.
+-----------------------------------------------------
+*/
+
+/**
+* Default constructor for an empty tree.
+*/
+template<class Key, class Value>
+PersistentAVLTree<Key, Value>::PersistentAVLTree() :
+    root_(NULL)
+{
+
+}
+
+/**
+* Drops the current version; versions held by snapshots live on.
+*/
+template<class Key, class Value>
+PersistentAVLTree<Key, Value>::~PersistentAVLTree()
+{
+    NodeType::release(root_);
+}
+
+/**
+* Inserts the key-value pair, overwriting the value if the key exists.
+* Builds the new version off to the side, then publishes it.
+*/
+template<class Key, class Value>
+void PersistentAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    publish(insertAt(root_, keyValuePair));
+}
+
+/**
+* Removes the key if it exists. Nothing is copied if it does not.
+*/
+template<class Key, class Value>
+void PersistentAVLTree<Key, Value>::remove(const Key& key)
+{
+    if(internalFind(root_, key) == NULL){
+      return;
+    }
+    publish(removeAt(root_, key));
+}
+
+/**
+* Switches to the empty version.
+*/
+template<class Key, class Value>
+void PersistentAVLTree<Key, Value>::clear()
+{
+    publish(NULL);
+}
+
+/**
+* Returns true if the current version has no items.
+*/
+template<class Key, class Value>
+bool PersistentAVLTree<Key, Value>::empty() const
+{
+    return root_ == NULL;
+}
+
+/**
+* Reports the memory held by the nodes of the current version, walking a
+* snapshot of it so a writer can carry on meanwhile.
+*/
+template<class Key, class Value>
+MemoryUsage PersistentAVLTree<Key, Value>::memory_usage() const
+{
+    MemoryUsage usage;
+    Snapshot current = snapshot();
+    size_t nodes = 0;
+    for(iterator it = current.begin(); it != current.end(); ++it){
+      usage.addEntry<Key, Value>(*it);
+      nodes++;
+    }
+    usage.addNodes<Key, Value>(nodes, sizeof(NodeType));
+    return usage;
+}
+
+/**
+* Pins the current version in O(1). Safe to call from any thread.
+*/
+template<class Key, class Value>
+typename PersistentAVLTree<Key, Value>::Snapshot
+PersistentAVLTree<Key, Value>::snapshot() const
+{
+    std::lock_guard<std::mutex> lock(rootLock_);
+    return Snapshot(NodeType::retain(root_));
+}
+
+/**
+* Returns an iterator to the smallest item of the current version.
+*/
+template<class Key, class Value>
+typename PersistentAVLTree<Key, Value>::iterator
+PersistentAVLTree<Key, Value>::begin() const
+{
+    iterator it;
+    it.pushLeftSpine(root_);
+    return it;
+}
+
+/**
+* Returns the end iterator.
+*/
+template<class Key, class Value>
+typename PersistentAVLTree<Key, Value>::iterator
+PersistentAVLTree<Key, Value>::end() const
+{
+    return iterator();
+}
+
+/**
+* Looks key up in the current version.
+*/
+template<class Key, class Value>
+typename PersistentAVLTree<Key, Value>::iterator
+PersistentAVLTree<Key, Value>::find(const Key& key) const
+{
+    return findIn(root_, key);
+}
+
+// HELPER: plain lookup from a version root
+template<class Key, class Value>
+typename PersistentAVLTree<Key, Value>::NodeType*
+PersistentAVLTree<Key, Value>::internalFind(NodeType* root, const Key& key)
+{
+    NodeType* current = root;
+    while(current != NULL){
+      if(key < current->getKey()){
+        current = current->getLeft();
+      }
+      else if(current->getKey() < key){
+        current = current->getRight();
+      }
+      else {
+        return current;
+      }
+    }
+    return NULL;
+}
+
+// HELPER: lookup that records the iterator stack on the way down; only
+// ancestors we went left from are still pending after the found node
+template<class Key, class Value>
+typename PersistentAVLTree<Key, Value>::iterator
+PersistentAVLTree<Key, Value>::findIn(NodeType* root, const Key& key)
+{
+    iterator it;
+    NodeType* current = root;
+    while(current != NULL){
+      if(key < current->getKey()){
+        it.stack_[it.depth_++] = current;
+        current = current->getLeft();
+      }
+      else if(current->getKey() < key){
+        current = current->getRight();
+      }
+      else {
+        it.stack_[it.depth_++] = current;
+        return it;
+      }
+    }
+    return iterator();
+}
+
+// HELPER: height of a possibly empty subtree
+template<class Key, class Value>
+int PersistentAVLTree<Key, Value>::height(NodeType* n)
+{
+    return (n == NULL) ? 0 : n->getHeight();
+}
+
+/**
+* Builds a node for item over left and right, whose heights differ by at
+* most two, rotating as needed. A child taken apart by a rotation is
+* released; if it was only just built it is freed straight away.
+*/
+template<class Key, class Value>
+typename PersistentAVLTree<Key, Value>::NodeType*
+PersistentAVLTree<Key, Value>::makeBalanced(const std::pair<const Key, Value>& item, NodeType* left, NodeType* right)
+{
+    int hl = height(left);
+    int hr = height(right);
+    NodeType* result;
+
+    if(hl > hr + 1){
+      NodeType* ll = left->getLeft();
+      NodeType* lr = left->getRight();
+      if(height(ll) >= height(lr)){
+        // single right rotation
+        result = new NodeType(left->getItem(), NodeType::retain(ll),
+                              new NodeType(item, NodeType::retain(lr), right));
+      }
+      else {
+        // left-right double rotation
+        result = new NodeType(lr->getItem(),
+                              new NodeType(left->getItem(), NodeType::retain(ll), NodeType::retain(lr->getLeft())),
+                              new NodeType(item, NodeType::retain(lr->getRight()), right));
+      }
+      NodeType::release(left);
+    }
+    else if(hr > hl + 1){
+      NodeType* rl = right->getLeft();
+      NodeType* rr = right->getRight();
+      if(height(rr) >= height(rl)){
+        result = new NodeType(right->getItem(),
+                              new NodeType(item, left, NodeType::retain(rl)), NodeType::retain(rr));
+      }
+      else {
+        result = new NodeType(rl->getItem(),
+                              new NodeType(item, left, NodeType::retain(rl->getLeft())),
+                              new NodeType(right->getItem(), NodeType::retain(rl->getRight()), NodeType::retain(rr)));
+      }
+      NodeType::release(right);
+    }
+    else {
+      result = new NodeType(item, left, right);
+    }
+    return result;
+}
+
+/**
+* Returns a new version of subtree n with item inserted (or its value
+* replaced). n itself is only read.
+*/
+template<class Key, class Value>
+typename PersistentAVLTree<Key, Value>::NodeType*
+PersistentAVLTree<Key, Value>::insertAt(NodeType* n, const std::pair<const Key, Value>& item)
+{
+    if(n == NULL){
+      return new NodeType(item, NULL, NULL);
+    }
+    if(item.first < n->getKey()){
+      return makeBalanced(n->getItem(), insertAt(n->getLeft(), item), NodeType::retain(n->getRight()));
+    }
+    if(n->getKey() < item.first){
+      return makeBalanced(n->getItem(), NodeType::retain(n->getLeft()), insertAt(n->getRight(), item));
+    }
+    return new NodeType(item, NodeType::retain(n->getLeft()), NodeType::retain(n->getRight()));
+}
+
+/**
+* Returns a new version of subtree n without key, which must be present.
+*/
+template<class Key, class Value>
+typename PersistentAVLTree<Key, Value>::NodeType*
+PersistentAVLTree<Key, Value>::removeAt(NodeType* n, const Key& key)
+{
+    if(key < n->getKey()){
+      return makeBalanced(n->getItem(), removeAt(n->getLeft(), key), NodeType::retain(n->getRight()));
+    }
+    if(n->getKey() < key){
+      return makeBalanced(n->getItem(), NodeType::retain(n->getLeft()), removeAt(n->getRight(), key));
+    }
+
+    if(n->getLeft() == NULL){
+      return NodeType::retain(n->getRight());
+    }
+    if(n->getRight() == NULL){
+      return NodeType::retain(n->getLeft());
+    }
+    // replace n's item by its successor's, taken out of the right subtree
+    NodeType* min;
+    NodeType* right = removeMin(n->getRight(), min);
+    return makeBalanced(min->getItem(), NodeType::retain(n->getLeft()), right);
+}
+
+/**
+* Returns a new version of subtree n without its minimum, which is
+* reported through min (it stays alive with the old version).
+*/
+template<class Key, class Value>
+typename PersistentAVLTree<Key, Value>::NodeType*
+PersistentAVLTree<Key, Value>::removeMin(NodeType* n, NodeType*& min)
+{
+    if(n->getLeft() == NULL){
+      min = n;
+      return NodeType::retain(n->getRight());
+    }
+    return makeBalanced(n->getItem(), removeMin(n->getLeft(), min), NodeType::retain(n->getRight()));
+}
+
+/**
+* Makes root the current version. The old one is released outside the
+* lock; whatever snapshots still share is kept alive by them.
+*/
+template<class Key, class Value>
+void PersistentAVLTree<Key, Value>::publish(NodeType* root)
+{
+    NodeType* old;
+    {
+      std::lock_guard<std::mutex> lock(rootLock_);
+      old = root_;
+      root_ = root;
+    }
+    NodeType::release(old);
+}
+
+/*
+------------------------------------------------------------
+End implementations for the PersistentAVLTree class.
+------------------------------------------------------------
+*/
+
+#endif
@@ -137,7 +137,7 @@ void BinarySearchTree<Key, Value>::printRoot (Node<Key, Value>* root) const
         {
             // note; the iterator will traverse in sorted order so values should get the same placeholders between
             // different calls as long as the tree is the same
-            valuePlaceholders.insert(std::make_pair(treeIter->first, nextPlaceHolderVal++));
+            valuePlaceholders.insert(std::make_pair(treeIter.current_->getKey(), nextPlaceHolderVal++));
         }
 
     }
@@ -167,7 +167,7 @@ void BinarySearchTree<Key, Value>::printRoot (Node<Key, Value>* root) const
             }
             else
             {
-                uint16_t placeholder = valuePlaceholders[currRowNodes[elementIndex]->getItem().first];
+                uint16_t placeholder = valuePlaceholders[currRowNodes[elementIndex]->getKey()];
                 std::cout << "[" << std::setfill('0') << std::setw(2) << placeholder << "]";
             }
 
@@ -280,7 +280,7 @@ void BinarySearchTree<Key, Value>::printRoot (Node<Key, Value>* root) const
             }
             else
             {
-                std::cout << elementIter->second;
+                std::cout << elementIter.current_->getValue();
             }
 
             std::cout << ')' << std::endl;
@@ -0,0 +1,131 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include "avlbst.h"
+#include "radixtree.h"
+
+using namespace std;
+
+// Compares AdaptiveRadixTree with AVLTree on uint64_t keys: inserts,
+// finds, lower_bound() and an ordered scan, for dense and random keys.
+// Usage: radixtree-bench [number of keys]
+
+static double secondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// AVLTree with the lower_bound() the radix tree has, found the way
+// TreeSet finds it
+template<typename Key, typename Value>
+class OrderedAVLTree : public AVLTree<Key, Value>
+{
+public:
+    typename AVLTree<Key, Value>::iterator lower_bound(const Key& key) const
+    {
+        Node<Key, Value>* current = this->root_;
+        Node<Key, Value>* bound = NULL;
+        while(current != NULL) {
+            if(current->getKey() < key) {
+                current = current->getRight();
+            }
+            else {
+                bound = current;
+                current = current->getLeft();
+            }
+        }
+        return this->iteratorAt(bound);
+    }
+};
+
+struct Timings
+{
+    double insert;
+    double find;
+    double lowerBound;
+    double scan;
+    uint64_t checksum;
+};
+
+template<typename Tree>
+Timings timeTree(const vector<uint64_t>& keys, const vector<uint64_t>& probes)
+{
+    Timings result;
+    Tree tree;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(size_t i = 0; i < keys.size(); i++) {
+        tree.insert(std::make_pair(keys[i], keys[i]));
+    }
+    result.insert = secondsSince(start);
+
+    uint64_t checksum = 0;
+    start = chrono::steady_clock::now();
+    for(size_t i = 0; i < probes.size(); i++) {
+        if(tree.find(probes[i]) != tree.end()) {
+            checksum++;
+        }
+    }
+    result.find = secondsSince(start);
+
+    start = chrono::steady_clock::now();
+    for(size_t i = 0; i < probes.size(); i++) {
+        typename Tree::iterator it = tree.lower_bound(probes[i]);
+        if(it != tree.end()) {
+            checksum += it->first;
+        }
+    }
+    result.lowerBound = secondsSince(start);
+
+    start = chrono::steady_clock::now();
+    for(typename Tree::iterator it = tree.begin(); it != tree.end(); ++it) {
+        checksum += it->second;
+    }
+    result.scan = secondsSince(start);
+    result.checksum = checksum;
+    return result;
+}
+
+static void report(const char* name, size_t n, size_t lookups, const Timings& t)
+{
+    cout << setw(8) << name << setw(10) << n / t.insert / 1e6 << setw(10) << lookups / t.find / 1e6
+         << setw(13) << lookups / t.lowerBound / 1e6 << setw(10) << n / t.scan / 1e6 << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = (argc > 1) ? strtoull(argv[1], NULL, 10) : 1000000;
+    mt19937_64 rng(49);
+
+    cout << "keys = " << n << "   (M operations/s)" << endl;
+    cout << fixed << setprecision(2);
+    for(int random = 0; random < 2; random++) {
+        // dense: 0, 2, 4, ...; random: 64-bit values. Inserted in random
+        // order; about half of the finds miss
+        vector<uint64_t> keys(n);
+        for(size_t i = 0; i < n; i++) {
+            keys[i] = random ? (rng() & ~1ULL) : 2 * i;
+        }
+        shuffle(keys.begin(), keys.end(), rng);
+        vector<uint64_t> probes(n);
+        for(size_t i = 0; i < n; i++) {
+            probes[i] = (rng() % 2) ? keys[rng() % n] : (random ? (rng() | 1) : rng() % (2 * n));
+        }
+
+        Timings avl = timeTree<OrderedAVLTree<uint64_t, uint64_t> >(keys, probes);
+        Timings art = timeTree<AdaptiveRadixTree<uint64_t, uint64_t> >(keys, probes);
+        if(avl.checksum != art.checksum) {
+            cout << "mismatch: " << avl.checksum << " != " << art.checksum << endl;
+            return 1;
+        }
+        cout << (random ? "random keys" : "dense keys") << endl;
+        cout << setw(8) << "" << setw(10) << "insert" << setw(10) << "find" << setw(13) << "lower_bound"
+             << setw(10) << "scan" << endl;
+        report("AVL", n, n, avl);
+        report("ART", n, n, art);
+    }
+    return 0;
+}
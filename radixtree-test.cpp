@@ -0,0 +1,58 @@
+#include <iostream>
+#include <string>
+#include <cstdint>
+#include "radixtree.h"
+
+using namespace std;
+
+
+int main(int argc, char *argv[])
+{
+    // Integer keys: negative ones sort first
+    AdaptiveRadixTree<int, int> t;
+    for(int i = -5; i <= 5; i++) {
+        t.insert(make_pair(i * 100, i));
+    }
+    t.insert(make_pair(300, 33));
+    t.remove(-200);
+    cout << "int keys:";
+    for(AdaptiveRadixTree<int, int>::iterator it = t.begin(); it != t.end(); ++it) {
+        cout << " " << it->first << "=" << it->second;
+    }
+    cout << endl;
+    cout << "size " << t.size() << ", t[300] = " << t[300]
+         << ", lower_bound(-250) = " << t.lower_bound(-250)->first
+         << ", upper_bound(300) = " << t.upper_bound(300)->first << endl;
+
+    // Enough children under one byte to grow through every node kind
+    AdaptiveRadixTree<uint32_t, uint32_t> wide;
+    for(uint32_t i = 0; i < 1000; i++) {
+        wide.insert(make_pair(i * 7, i));
+    }
+    for(uint32_t i = 0; i < 1000; i += 2) {
+        wide.remove(i * 7);
+    }
+    cout << "wide: size " << wide.size() << ", first " << wide.begin()->first
+         << ", find(14) " << (wide.find(14) != wide.end()) << ", find(21) " << (wide.find(21) != wide.end())
+         << ", memory: ";
+    wide.memory_usage().print(cout);
+
+    // String keys, some a prefix of others
+    AdaptiveRadixTree<string, int> s;
+    const char* words[] = { "tree", "trie", "tr", "t", "trees", "radix", "", "treehouse" };
+    for(int i = 0; i < 8; i++) {
+        s.insert(make_pair(string(words[i]), i));
+    }
+    s.remove("trie");
+    cout << "string keys:";
+    for(AdaptiveRadixTree<string, int>::iterator it = s.begin(); it != s.end(); ++it) {
+        cout << " \"" << it->first << "\"";
+    }
+    cout << endl;
+    cout << "lower_bound(\"treei\") = \"" << s.lower_bound("treei")->first << "\", find(\"tre\") "
+         << (s.find("tre") != s.end()) << endl;
+
+    s.clear();
+    cout << "after clear: empty " << s.empty() << endl;
+    return 0;
+}
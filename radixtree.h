@@ -0,0 +1,1296 @@
+#ifndef RADIXTREE_H
+#define RADIXTREE_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include "memoryusage.h"
+
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#include <emmintrin.h>
+#define RADIX_SSE2 1
+#endif
+
+// Prefix bytes an inner node stores. Longer compressed paths keep their
+// full length, and the bytes past these are read from a leaf when needed.
+#define RADIX_MAX_PREFIX 8
+// Bytes a key encoding may need outside the key itself (the widest integer)
+#define RADIX_KEY_BUFFER 8
+
+/**
+* The bytes of a key as the radix tree sees them: data points at size
+* bytes, either inside the key or in buffer. Not copyable, since data may
+* point into its own buffer.
+*/
+struct RadixBytes
+{
+    RadixBytes() : data(NULL), size(0) {}
+
+    const uint8_t* data;
+    size_t size;
+    uint8_t buffer[RADIX_KEY_BUFFER];
+
+private:
+    RadixBytes(const RadixBytes& other);
+    RadixBytes& operator=(const RadixBytes& other);
+};
+
+/**
+* Key trait: encodes a key into bytes whose lexicographic (unsigned)
+* order is the key's operator< order. Keys of one type must also be
+* prefix-free or end at an inner node; both integers (fixed size) and
+* strings (handled by the inner nodes' own entry) are fine. Specialize it
+* for other key types the way it is done below.
+*/
+template <typename T, typename Enable = void>
+struct RadixKey;
+
+/**
+* Integers: big-endian, with the sign bit flipped so negative numbers
+* sort first.
+*/
+template <typename T>
+struct RadixKey<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type>
+{
+    static void load(const T& key, RadixBytes& out)
+    {
+        typedef typename std::make_unsigned<T>::type U;
+        U bits = static_cast<U>(key);
+        if(std::is_signed<T>::value){
+          bits ^= static_cast<U>(static_cast<U>(1) << (sizeof(T) * 8 - 1));
+        }
+        for(size_t i = 0; i < sizeof(T); i++){
+          out.buffer[i] = static_cast<uint8_t>(bits >> (8 * (sizeof(T) - 1 - i)));
+        }
+        out.data = out.buffer;
+        out.size = sizeof(T);
+    }
+};
+
+/**
+* Strings: their own bytes, no copy.
+*/
+template <>
+struct RadixKey<std::string>
+{
+    static void load(const std::string& key, RadixBytes& out)
+    {
+        out.data = reinterpret_cast<const uint8_t*>(key.data());
+        out.size = key.size();
+    }
+};
+
+enum RadixNodeType { RADIX_LEAF, RADIX_NODE4, RADIX_NODE16, RADIX_NODE48, RADIX_NODE256 };
+
+/**
+* What every radix tree node starts with: its kind.
+*/
+struct RadixNode
+{
+    explicit RadixNode(uint8_t nodeType) : type(nodeType) {}
+
+    uint8_t type;
+};
+
+/**
+* The header of the inner nodes: the compressed path leading to their
+* children, and the entry whose key ends right after that path (strings
+* that are a prefix of other keys).
+*/
+struct RadixInner : public RadixNode
+{
+    explicit RadixInner(uint8_t nodeType) :
+        RadixNode(nodeType), count(0), prefixLen(0), leaf(NULL)
+    {
+
+    }
+
+    uint16_t count;
+    uint32_t prefixLen;
+    uint8_t prefix[RADIX_MAX_PREFIX];
+    RadixNode* leaf;
+};
+
+/**
+* Up to 4 children, key bytes sorted.
+*/
+struct RadixNode4 : public RadixInner
+{
+    RadixNode4() : RadixInner(RADIX_NODE4) {}
+
+    uint8_t keys[4];
+    RadixNode* children[4];
+};
+
+/**
+* Up to 16 children, key bytes sorted and searched 16 at a time.
+*/
+struct RadixNode16 : public RadixInner
+{
+    RadixNode16() : RadixInner(RADIX_NODE16) {}
+
+    uint8_t keys[16];
+    RadixNode* children[16];
+};
+
+/**
+* Up to 48 children: a 256-byte index (slot + 1, 0 for none) into them.
+*/
+struct RadixNode48 : public RadixInner
+{
+    RadixNode48() : RadixInner(RADIX_NODE48)
+    {
+        std::memset(index, 0, sizeof(index));
+        std::memset(children, 0, sizeof(children));
+    }
+
+    uint8_t index[256];
+    RadixNode* children[48];
+};
+
+/**
+* One child per byte value.
+*/
+struct RadixNode256 : public RadixInner
+{
+    RadixNode256() : RadixInner(RADIX_NODE256)
+    {
+        std::memset(children, 0, sizeof(children));
+    }
+
+    RadixNode* children[256];
+};
+
+/**
+* A leaf holds one entry. Leaves are also linked in key order, so
+* iteration and lower_bound() never need to climb the tree.
+*/
+template <typename Key, typename Value>
+struct RadixLeaf : public RadixNode
+{
+    RadixLeaf(const Key& key, const Value& value) :
+        RadixNode(RADIX_LEAF), item(key, value), prev(NULL), next(NULL)
+    {
+
+    }
+
+    std::pair<const Key, Value> item;
+    RadixLeaf<Key, Value>* prev;
+    RadixLeaf<Key, Value>* next;
+};
+
+/**
+* An adaptive radix tree (Leis et al., ICDE 2013) with the same
+* interface as BinarySearchTree. It branches on one key byte per level,
+* using the smallest of four inner node sizes that fits the children,
+* and collapses single-child paths into a prefix. Its height depends on
+* the key length, not on the number of entries, and finding a child is
+* an index or a short (SIMD) search instead of a key comparison.
+*
+* Keys are encoded by RadixKey; integers and std::string are supported.
+* Iterators stay valid until their own entry is removed.
+*/
+template <typename Key, typename Value>
+class AdaptiveRadixTree
+{
+public:
+    typedef RadixLeaf<Key, Value> LeafType;
+
+    AdaptiveRadixTree();
+    ~AdaptiveRadixTree();
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    // the height is bounded by the key length, never by the entry count
+    bool isBalanced() const;
+    bool empty() const;
+    size_t size() const;
+    // bytes used by the nodes and what keys and values own; O(n)
+    MemoryUsage memory_usage() const;
+
+public:
+    /**
+    * An iterator over the contents of the tree, in key order.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const Key,Value>& operator*() const;
+        std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class AdaptiveRadixTree<Key, Value>;
+        iterator(LeafType* ptr);
+        LeafType* current_;
+    };
+
+public:
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    // the first entry whose key is not less than / greater than key
+    iterator lower_bound(const Key& key) const;
+    iterator upper_bound(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    LeafType* internalFind(const Key& key) const;
+    LeafType* lowerBound(const Key& key, const RadixBytes& bytes) const;
+
+    //HELPERS:
+    static bool isLeaf(const RadixNode* n);
+    static LeafType* asLeaf(RadixNode* n);
+    static LeafType* minimum(RadixNode* n);
+    static LeafType* maximum(RadixNode* n);
+    static uint8_t prefixByte(RadixInner* n, size_t depth, size_t i);
+    static size_t prefixMismatch(RadixInner* n, const RadixBytes& bytes, size_t depth);
+    static void setPrefix(RadixInner* n, const uint8_t* bytes, size_t len);
+    static void place(RadixNode4* n, const RadixBytes& bytes, size_t depth, RadixNode* child);
+    static void place(RadixNode4* n, uint8_t byte, RadixNode* child);
+    LeafType* removeAt(RadixNode** ref, const Key& key, const RadixBytes& bytes, size_t depth);
+    void linkBefore(LeafType* leaf, LeafType* next);
+    void unlink(LeafType* leaf);
+    void deleteSubtree(RadixNode* n);
+    void addUsage(RadixNode* n, MemoryUsage& usage) const;
+
+    // child tables
+    static RadixNode** findChild(RadixInner* n, uint8_t byte);
+    static RadixNode* firstChild(RadixInner* n);
+    static RadixNode* lastChild(RadixInner* n);
+    static RadixNode* nextChild(RadixInner* n, uint8_t byte);
+    static void addChild(RadixNode** ref, RadixInner* n, uint8_t byte, RadixNode* child);
+    static void removeChild(RadixNode** ref, RadixInner* n, uint8_t byte, RadixNode** slot);
+    static void collapse(RadixNode** ref);
+    static void copyHeader(RadixInner* to, const RadixInner* from);
+    static size_t innerSize(const RadixInner* n);
+
+protected:
+    RadixNode* root_;
+    // the leaf list, in key order
+    LeafType* head_;
+    LeafType* tail_;
+    size_t size_;
+};
+
+/*
+--------------------------------------------------------------
+Begin implementations for the AdaptiveRadixTree::iterator class.
+---------------------------------------------------------------
+*/
+
+/**
+* Explicit constructor that initializes an iterator with a given leaf.
+*/
+template<class Key, class Value>
+AdaptiveRadixTree<Key, Value>::iterator::iterator(LeafType* ptr) :
+    current_(ptr)
+{
+
+}
+
+/**
+* A default constructor that initializes the iterator to NULL.
+*/
+template<class Key, class Value>
+AdaptiveRadixTree<Key, Value>::iterator::iterator() :
+    current_(NULL)
+{
+
+}
+
+/**
+* Provides access to the item.
+*/
+template<class Key, class Value>
+std::pair<const Key,Value> &
+AdaptiveRadixTree<Key, Value>::iterator::operator*() const
+{
+    return current_->item;
+}
+
+/**
+* Provides access to the address of the item.
+*/
+template<class Key, class Value>
+std::pair<const Key,Value> *
+AdaptiveRadixTree<Key, Value>::iterator::operator->() const
+{
+    return &(current_->item);
+}
+
+/**
+* Checks if 'this' iterator's internals have the same value
+* as 'rhs'
+*/
+template<class Key, class Value>
+bool
+AdaptiveRadixTree<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    return current_ == rhs.current_;
+}
+
+/**
+* Checks if 'this' iterator's internals have a different value
+* as 'rhs'
+*/
+template<class Key, class Value>
+bool
+AdaptiveRadixTree<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return current_ != rhs.current_;
+}
+
+/**
+* Advances the iterator along the leaf list.
+*/
+template<class Key, class Value>
+typename AdaptiveRadixTree<Key, Value>::iterator&
+AdaptiveRadixTree<Key, Value>::iterator::operator++()
+{
+    current_ = current_->next;
+    return *this;
+}
+
+/*
+-------------------------------------------------------------
+End implementations for the AdaptiveRadixTree::iterator class.
+-------------------------------------------------------------
+*/
+
+/*
+-----------------------------------------------------
+Begin implementations for the AdaptiveRadixTree class.
+-----------------------------------------------------
+*/
+
+/**
+* Default constructor for an empty tree.
+*/
+template<class Key, class Value>
+AdaptiveRadixTree<Key, Value>::AdaptiveRadixTree() :
+    root_(NULL), head_(NULL), tail_(NULL), size_(0)
+{
+
+}
+
+template<typename Key, typename Value>
+AdaptiveRadixTree<Key, Value>::~AdaptiveRadixTree()
+{
+    clear();
+}
+
+/**
+ * Returns true if tree is empty
+*/
+template<class Key, class Value>
+bool AdaptiveRadixTree<Key, Value>::empty() const
+{
+    return root_ == NULL;
+}
+
+/**
+ * Returns the number of entries.
+*/
+template<class Key, class Value>
+size_t AdaptiveRadixTree<Key, Value>::size() const
+{
+    return size_;
+}
+
+/**
+ * Always true: every key's path is as long as the key, whatever order
+ * the keys arrived in.
+*/
+template<class Key, class Value>
+bool AdaptiveRadixTree<Key, Value>::isBalanced() const
+{
+    return true;
+}
+
+/**
+* Removes all contents of the tree.
+*/
+template<class Key, class Value>
+void AdaptiveRadixTree<Key, Value>::clear()
+{
+    deleteSubtree(root_);
+    root_ = NULL;
+    head_ = NULL;
+    tail_ = NULL;
+    size_ = 0;
+}
+
+/**
+* Reports the memory held by the tree: leaves are counted like the nodes
+* of the comparison trees, inner nodes all count as header bytes.
+*/
+template<class Key, class Value>
+MemoryUsage AdaptiveRadixTree<Key, Value>::memory_usage() const
+{
+    MemoryUsage usage;
+    for(LeafType* leaf = head_; leaf != NULL; leaf = leaf->next){
+      usage.addEntry<Key, Value>(leaf->item);
+    }
+    usage.addNodes<Key, Value>(size_, sizeof(LeafType));
+    addUsage(root_, usage);
+    return usage;
+}
+
+/**
+* Returns an iterator to the "smallest" item in the tree
+*/
+template<class Key, class Value>
+typename AdaptiveRadixTree<Key, Value>::iterator
+AdaptiveRadixTree<Key, Value>::begin() const
+{
+    return iterator(head_);
+}
+
+/**
+* Returns an iterator whose value means INVALID
+*/
+template<class Key, class Value>
+typename AdaptiveRadixTree<Key, Value>::iterator
+AdaptiveRadixTree<Key, Value>::end() const
+{
+    return iterator(NULL);
+}
+
+/**
+* Returns an iterator to the item with the given key, k
+* or the end iterator if k does not exist in the tree
+*/
+template<class Key, class Value>
+typename AdaptiveRadixTree<Key, Value>::iterator
+AdaptiveRadixTree<Key, Value>::find(const Key& key) const
+{
+    return iterator(internalFind(key));
+}
+
+/**
+* Returns an iterator to the first item whose key is not less than key,
+* or end() if there is none.
+*/
+template<class Key, class Value>
+typename AdaptiveRadixTree<Key, Value>::iterator
+AdaptiveRadixTree<Key, Value>::lower_bound(const Key& key) const
+{
+    RadixBytes bytes;
+    RadixKey<Key>::load(key, bytes);
+    return iterator(lowerBound(key, bytes));
+}
+
+/**
+* Returns an iterator to the first item whose key is greater than key,
+* or end() if there is none.
+*/
+template<class Key, class Value>
+typename AdaptiveRadixTree<Key, Value>::iterator
+AdaptiveRadixTree<Key, Value>::upper_bound(const Key& key) const
+{
+    RadixBytes bytes;
+    RadixKey<Key>::load(key, bytes);
+    LeafType* leaf = lowerBound(key, bytes);
+    if(leaf != NULL && leaf->item.first == key){
+      leaf = leaf->next;
+    }
+    return iterator(leaf);
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value>
+Value& AdaptiveRadixTree<Key, Value>::operator[](const Key& key)
+{
+    LeafType* curr = internalFind(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->item.second;
+}
+template<class Key, class Value>
+Value const & AdaptiveRadixTree<Key, Value>::operator[](const Key& key) const
+{
+    LeafType* curr = internalFind(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->item.second;
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ */
+template<class Key, class Value>
+void AdaptiveRadixTree<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    RadixBytes bytes;
+    RadixKey<Key>::load(keyValuePair.first, bytes);
+
+    // the entry that will follow the new one, or the entry itself
+    LeafType* next = lowerBound(keyValuePair.first, bytes);
+    if(next != NULL && next->item.first == keyValuePair.first){
+      next->item.second = keyValuePair.second;
+      return;
+    }
+
+    LeafType* leaf = new LeafType(keyValuePair.first, keyValuePair.second);
+    RadixNode** ref = &root_;
+    size_t depth = 0;
+    while(true){
+      RadixNode* n = *ref;
+      if(n == NULL){
+        *ref = leaf;
+        break;
+      }
+
+      // two keys share this slot: branch where they first differ
+      if(isLeaf(n)){
+        RadixBytes other;
+        RadixKey<Key>::load(asLeaf(n)->item.first, other);
+        size_t common = 0;
+        while(depth + common < bytes.size && depth + common < other.size
+              && bytes.data[depth + common] == other.data[depth + common]){
+          common++;
+        }
+        RadixNode4* inner = new RadixNode4();
+        setPrefix(inner, bytes.data + depth, common);
+        place(inner, other, depth + common, n);
+        place(inner, bytes, depth + common, leaf);
+        *ref = inner;
+        break;
+      }
+
+      // the key leaves the compressed path: split it at the mismatch
+      RadixInner* in = static_cast<RadixInner*>(n);
+      if(in->prefixLen > 0){
+        size_t mismatch = prefixMismatch(in, bytes, depth);
+        if(mismatch < in->prefixLen){
+          RadixNode4* parent = new RadixNode4();
+          setPrefix(parent, bytes.data + depth, mismatch);
+          uint8_t byte = prefixByte(in, depth, mismatch);
+          // what is left of the old path after the branching byte
+          uint32_t rest = in->prefixLen - static_cast<uint32_t>(mismatch) - 1;
+          if(in->prefixLen <= RADIX_MAX_PREFIX){
+            std::memmove(in->prefix, in->prefix + mismatch + 1, rest);
+          }
+          else {
+            RadixBytes full;
+            RadixKey<Key>::load(minimum(in)->item.first, full);
+            std::memcpy(in->prefix, full.data + depth + mismatch + 1, std::min<size_t>(rest, RADIX_MAX_PREFIX));
+          }
+          in->prefixLen = rest;
+          place(parent, byte, in);
+          place(parent, bytes, depth + mismatch, leaf);
+          *ref = parent;
+          break;
+        }
+        depth += in->prefixLen;
+      }
+
+      // the key ends here
+      if(depth == bytes.size){
+        in->leaf = leaf;
+        break;
+      }
+      RadixNode** child = findChild(in, bytes.data[depth]);
+      if(child == NULL){
+        addChild(ref, in, bytes.data[depth], leaf);
+        break;
+      }
+      ref = child;
+      depth++;
+    }
+    linkBefore(leaf, next);
+    size_++;
+}
+
+/*
+ * Removes the entry with the given key, if any. Nodes that become too
+ * empty shrink to the next smaller kind, and a path left with one child
+ * merges into it.
+ */
+template<class Key, class Value>
+void AdaptiveRadixTree<Key, Value>::remove(const Key& key)
+{
+    RadixBytes bytes;
+    RadixKey<Key>::load(key, bytes);
+    LeafType* leaf = removeAt(&root_, key, bytes, 0);
+    if(leaf != NULL){
+      unlink(leaf);
+      delete leaf;
+      size_--;
+    }
+}
+
+/**
+* Helper function to find a leaf with given key, or NULL. Prefixes are
+* skipped optimistically past what the nodes store; the leaf's key is
+* compared at the end.
+*/
+template<class Key, class Value>
+typename AdaptiveRadixTree<Key, Value>::LeafType*
+AdaptiveRadixTree<Key, Value>::internalFind(const Key& key) const
+{
+    RadixBytes bytes;
+    RadixKey<Key>::load(key, bytes);
+    RadixNode* n = root_;
+    size_t depth = 0;
+    while(n != NULL){
+      if(isLeaf(n)){
+        return (asLeaf(n)->item.first == key) ? asLeaf(n) : NULL;
+      }
+      RadixInner* in = static_cast<RadixInner*>(n);
+      if(in->prefixLen > 0){
+        if(depth + in->prefixLen > bytes.size){
+          return NULL;
+        }
+        size_t stored = std::min<size_t>(in->prefixLen, RADIX_MAX_PREFIX);
+        if(std::memcmp(in->prefix, bytes.data + depth, stored) != 0){
+          return NULL;
+        }
+        depth += in->prefixLen;
+      }
+      if(depth == bytes.size){
+        return (in->leaf != NULL && asLeaf(in->leaf)->item.first == key) ? asLeaf(in->leaf) : NULL;
+      }
+      RadixNode** child = findChild(in, bytes.data[depth]);
+      if(child == NULL){
+        return NULL;
+      }
+      n = *child;
+      depth++;
+    }
+    return NULL;
+}
+
+/**
+* The first leaf whose key is not less than key (NULL if none). A
+* subtree entirely below key is skipped through the leaf list: the
+* answer is the successor of its maximum.
+*/
+template<class Key, class Value>
+typename AdaptiveRadixTree<Key, Value>::LeafType*
+AdaptiveRadixTree<Key, Value>::lowerBound(const Key& key, const RadixBytes& bytes) const
+{
+    RadixNode* n = root_;
+    size_t depth = 0;
+    while(n != NULL){
+      if(isLeaf(n)){
+        return (asLeaf(n)->item.first < key) ? asLeaf(n)->next : asLeaf(n);
+      }
+      RadixInner* in = static_cast<RadixInner*>(n);
+      if(in->prefixLen > 0){
+        size_t mismatch = prefixMismatch(in, bytes, depth);
+        if(mismatch < in->prefixLen){
+          // key ran out inside the path, or branches off above it
+          if(depth + mismatch == bytes.size || prefixByte(in, depth, mismatch) > bytes.data[depth + mismatch]){
+            return minimum(in);
+          }
+          return maximum(in)->next;
+        }
+        depth += in->prefixLen;
+      }
+      // everything here extends key (or is key)
+      if(depth == bytes.size){
+        return minimum(in);
+      }
+      RadixNode** child = findChild(in, bytes.data[depth]);
+      if(child != NULL){
+        n = *child;
+        depth++;
+        continue;
+      }
+      RadixNode* greater = nextChild(in, bytes.data[depth]);
+      return (greater != NULL) ? minimum(greater) : maximum(in)->next;
+    }
+    return NULL;
+}
+
+// HELPER: node kinds
+template<class Key, class Value>
+bool AdaptiveRadixTree<Key, Value>::isLeaf(const RadixNode* n)
+{
+    return n->type == RADIX_LEAF;
+}
+
+template<class Key, class Value>
+typename AdaptiveRadixTree<Key, Value>::LeafType*
+AdaptiveRadixTree<Key, Value>::asLeaf(RadixNode* n)
+{
+    return static_cast<LeafType*>(n);
+}
+
+// HELPER: the smallest leaf under n (a key ending at a node sorts first)
+template<class Key, class Value>
+typename AdaptiveRadixTree<Key, Value>::LeafType*
+AdaptiveRadixTree<Key, Value>::minimum(RadixNode* n)
+{
+    while(!isLeaf(n)){
+      RadixInner* in = static_cast<RadixInner*>(n);
+      n = (in->leaf != NULL) ? in->leaf : firstChild(in);
+    }
+    return asLeaf(n);
+}
+
+// HELPER: the largest leaf under n
+template<class Key, class Value>
+typename AdaptiveRadixTree<Key, Value>::LeafType*
+AdaptiveRadixTree<Key, Value>::maximum(RadixNode* n)
+{
+    while(!isLeaf(n)){
+      RadixInner* in = static_cast<RadixInner*>(n);
+      n = (in->count > 0) ? lastChild(in) : in->leaf;
+    }
+    return asLeaf(n);
+}
+
+// HELPER: byte i of n's path (n sits at depth), from a leaf if not stored
+template<class Key, class Value>
+uint8_t AdaptiveRadixTree<Key, Value>::prefixByte(RadixInner* n, size_t depth, size_t i)
+{
+    if(i < RADIX_MAX_PREFIX){
+      return n->prefix[i];
+    }
+    RadixBytes full;
+    RadixKey<Key>::load(minimum(n)->item.first, full);
+    return full.data[depth + i];
+}
+
+// HELPER: how many bytes of n's path match bytes from depth on (stops
+// where either ends)
+template<class Key, class Value>
+size_t AdaptiveRadixTree<Key, Value>::prefixMismatch(RadixInner* n, const RadixBytes& bytes, size_t depth)
+{
+    size_t limit = std::min<size_t>(n->prefixLen, bytes.size - depth);
+    size_t stored = std::min<size_t>(limit, RADIX_MAX_PREFIX);
+    for(size_t i = 0; i < stored; i++){
+      if(n->prefix[i] != bytes.data[depth + i]){
+        return i;
+      }
+    }
+    if(limit > RADIX_MAX_PREFIX){
+      RadixBytes full;
+      RadixKey<Key>::load(minimum(n)->item.first, full);
+      for(size_t i = RADIX_MAX_PREFIX; i < limit; i++){
+        if(full.data[depth + i] != bytes.data[depth + i]){
+          return i;
+        }
+      }
+    }
+    return limit;
+}
+
+// HELPER: set the path of n (only the first bytes are stored)
+template<class Key, class Value>
+void AdaptiveRadixTree<Key, Value>::setPrefix(RadixInner* n, const uint8_t* bytes, size_t len)
+{
+    n->prefixLen = static_cast<uint32_t>(len);
+    std::memcpy(n->prefix, bytes, std::min<size_t>(len, RADIX_MAX_PREFIX));
+}
+
+// HELPER: hang child, whose key is bytes, below a fresh node at depth
+template<class Key, class Value>
+void AdaptiveRadixTree<Key, Value>::place(RadixNode4* n, const RadixBytes& bytes, size_t depth, RadixNode* child)
+{
+    if(depth == bytes.size){
+      n->leaf = child;
+    }
+    else {
+      place(n, bytes.data[depth], child);
+    }
+}
+
+// HELPER: hang child below a fresh node under byte (it has room, so it
+// is never replaced)
+template<class Key, class Value>
+void AdaptiveRadixTree<Key, Value>::place(RadixNode4* n, uint8_t byte, RadixNode* child)
+{
+    RadixNode* self = n;
+    addChild(&self, n, byte, child);
+}
+
+// HELPER: unhook the leaf for key from the subtree at *ref and return it
+template<class Key, class Value>
+typename AdaptiveRadixTree<Key, Value>::LeafType*
+AdaptiveRadixTree<Key, Value>::removeAt(RadixNode** ref, const Key& key, const RadixBytes& bytes, size_t depth)
+{
+    RadixNode* n = *ref;
+    if(n == NULL){
+      return NULL;
+    }
+    // only the root can be a lone leaf
+    if(isLeaf(n)){
+      if(asLeaf(n)->item.first == key){
+        *ref = NULL;
+        return asLeaf(n);
+      }
+      return NULL;
+    }
+
+    RadixInner* in = static_cast<RadixInner*>(n);
+    if(in->prefixLen > 0){
+      if(depth + in->prefixLen > bytes.size){
+        return NULL;
+      }
+      size_t stored = std::min<size_t>(in->prefixLen, RADIX_MAX_PREFIX);
+      if(std::memcmp(in->prefix, bytes.data + depth, stored) != 0){
+        return NULL;
+      }
+      depth += in->prefixLen;
+    }
+    if(depth == bytes.size){
+      if(in->leaf == NULL || !(asLeaf(in->leaf)->item.first == key)){
+        return NULL;
+      }
+      LeafType* leaf = asLeaf(in->leaf);
+      in->leaf = NULL;
+      collapse(ref);
+      return leaf;
+    }
+    RadixNode** child = findChild(in, bytes.data[depth]);
+    if(child == NULL){
+      return NULL;
+    }
+    if(isLeaf(*child)){
+      if(!(asLeaf(*child)->item.first == key)){
+        return NULL;
+      }
+      LeafType* leaf = asLeaf(*child);
+      removeChild(ref, in, bytes.data[depth], child);
+      return leaf;
+    }
+    return removeAt(child, key, bytes, depth + 1);
+}
+
+// HELPER: insert leaf into the leaf list before next (NULL: at the end)
+template<class Key, class Value>
+void AdaptiveRadixTree<Key, Value>::linkBefore(LeafType* leaf, LeafType* next)
+{
+    LeafType* prev = (next != NULL) ? next->prev : tail_;
+    leaf->prev = prev;
+    leaf->next = next;
+    if(prev != NULL) prev->next = leaf; else head_ = leaf;
+    if(next != NULL) next->prev = leaf; else tail_ = leaf;
+}
+
+// HELPER: take leaf out of the leaf list
+template<class Key, class Value>
+void AdaptiveRadixTree<Key, Value>::unlink(LeafType* leaf)
+{
+    if(leaf->prev != NULL) leaf->prev->next = leaf->next; else head_ = leaf->next;
+    if(leaf->next != NULL) leaf->next->prev = leaf->prev; else tail_ = leaf->prev;
+}
+
+// HELPER: delete subtree, leaves included
+template<class Key, class Value>
+void AdaptiveRadixTree<Key, Value>::deleteSubtree(RadixNode* n)
+{
+    if(n == NULL){
+      return;
+    }
+    if(isLeaf(n)){
+      delete asLeaf(n);
+      return;
+    }
+    RadixInner* in = static_cast<RadixInner*>(n);
+    deleteSubtree(in->leaf);
+    for(int b = 0; b < 256; b++){
+      RadixNode** slot = findChild(in, static_cast<uint8_t>(b));
+      if(slot != NULL){
+        deleteSubtree(*slot);
+      }
+    }
+    switch(in->type){
+      case RADIX_NODE4: delete static_cast<RadixNode4*>(in); break;
+      case RADIX_NODE16: delete static_cast<RadixNode16*>(in); break;
+      case RADIX_NODE48: delete static_cast<RadixNode48*>(in); break;
+      default: delete static_cast<RadixNode256*>(in); break;
+    }
+}
+
+// HELPER: count the inner nodes under n
+template<class Key, class Value>
+void AdaptiveRadixTree<Key, Value>::addUsage(RadixNode* n, MemoryUsage& usage) const
+{
+    if(n == NULL || isLeaf(n)){
+      return;
+    }
+    RadixInner* in = static_cast<RadixInner*>(n);
+    size_t bytes = innerSize(in);
+    usage.headerBytes += bytes;
+    usage.slackBytes += mallocBlockBytes(bytes) - bytes;
+    for(int b = 0; b < 256; b++){
+      RadixNode** slot = findChild(in, static_cast<uint8_t>(b));
+      if(slot != NULL){
+        addUsage(*slot, usage);
+      }
+    }
+}
+
+// HELPER: the slot of the child for byte, or NULL
+template<class Key, class Value>
+RadixNode** AdaptiveRadixTree<Key, Value>::findChild(RadixInner* n, uint8_t byte)
+{
+    switch(n->type){
+      case RADIX_NODE4: {
+        RadixNode4* n4 = static_cast<RadixNode4*>(n);
+        for(int i = 0; i < n4->count; i++){
+          if(n4->keys[i] == byte){
+            return &n4->children[i];
+          }
+        }
+        return NULL;
+      }
+      case RADIX_NODE16: {
+        RadixNode16* n16 = static_cast<RadixNode16*>(n);
+#ifdef RADIX_SSE2
+        // compare all 16 key bytes at once, keep the used ones
+        __m128i matches = _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(byte)),
+                                         _mm_loadu_si128(reinterpret_cast<const __m128i*>(n16->keys)));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(matches)) & ((1u << n16->count) - 1);
+        return (mask != 0) ? &n16->children[__builtin_ctz(mask)] : NULL;
+#else
+        for(int i = 0; i < n16->count; i++){
+          if(n16->keys[i] == byte){
+            return &n16->children[i];
+          }
+        }
+        return NULL;
+#endif
+      }
+      case RADIX_NODE48: {
+        RadixNode48* n48 = static_cast<RadixNode48*>(n);
+        return (n48->index[byte] != 0) ? &n48->children[n48->index[byte] - 1] : NULL;
+      }
+      default: {
+        RadixNode256* n256 = static_cast<RadixNode256*>(n);
+        return (n256->children[byte] != NULL) ? &n256->children[byte] : NULL;
+      }
+    }
+}
+
+// HELPER: the child with the smallest byte, NULL if none
+template<class Key, class Value>
+RadixNode* AdaptiveRadixTree<Key, Value>::firstChild(RadixInner* n)
+{
+    if(n->count == 0){
+      return NULL;
+    }
+    switch(n->type){
+      case RADIX_NODE4: return static_cast<RadixNode4*>(n)->children[0];
+      case RADIX_NODE16: return static_cast<RadixNode16*>(n)->children[0];
+      default:
+        for(int b = 0; b < 256; b++){
+          RadixNode** slot = findChild(n, static_cast<uint8_t>(b));
+          if(slot != NULL){
+            return *slot;
+          }
+        }
+        return NULL;
+    }
+}
+
+// HELPER: the child with the largest byte, NULL if none
+template<class Key, class Value>
+RadixNode* AdaptiveRadixTree<Key, Value>::lastChild(RadixInner* n)
+{
+    if(n->count == 0){
+      return NULL;
+    }
+    switch(n->type){
+      case RADIX_NODE4: return static_cast<RadixNode4*>(n)->children[n->count - 1];
+      case RADIX_NODE16: return static_cast<RadixNode16*>(n)->children[n->count - 1];
+      default:
+        for(int b = 255; b >= 0; b--){
+          RadixNode** slot = findChild(n, static_cast<uint8_t>(b));
+          if(slot != NULL){
+            return *slot;
+          }
+        }
+        return NULL;
+    }
+}
+
+// HELPER: the child with the smallest byte greater than byte, NULL if none
+template<class Key, class Value>
+RadixNode* AdaptiveRadixTree<Key, Value>::nextChild(RadixInner* n, uint8_t byte)
+{
+    switch(n->type){
+      case RADIX_NODE4: {
+        RadixNode4* n4 = static_cast<RadixNode4*>(n);
+        for(int i = 0; i < n4->count; i++){
+          if(n4->keys[i] > byte){
+            return n4->children[i];
+          }
+        }
+        return NULL;
+      }
+      case RADIX_NODE16: {
+        RadixNode16* n16 = static_cast<RadixNode16*>(n);
+#ifdef RADIX_SSE2
+        // unsigned "key > byte" via the signed compare on flipped bytes
+        __m128i flip = _mm_set1_epi8(static_cast<char>(0x80));
+        __m128i greater = _mm_cmpgt_epi8(
+            _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(n16->keys)), flip),
+            _mm_xor_si128(_mm_set1_epi8(static_cast<char>(byte)), flip));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(greater)) & ((1u << n16->count) - 1);
+        return (mask != 0) ? n16->children[__builtin_ctz(mask)] : NULL;
+#else
+        for(int i = 0; i < n16->count; i++){
+          if(n16->keys[i] > byte){
+            return n16->children[i];
+          }
+        }
+        return NULL;
+#endif
+      }
+      default:
+        for(int b = byte + 1; b < 256; b++){
+          RadixNode** slot = findChild(n, static_cast<uint8_t>(b));
+          if(slot != NULL){
+            return *slot;
+          }
+        }
+        return NULL;
+    }
+}
+
+// HELPER: copy the header of an inner node that is being resized
+template<class Key, class Value>
+void AdaptiveRadixTree<Key, Value>::copyHeader(RadixInner* to, const RadixInner* from)
+{
+    to->count = from->count;
+    to->prefixLen = from->prefixLen;
+    std::memcpy(to->prefix, from->prefix, RADIX_MAX_PREFIX);
+    to->leaf = from->leaf;
+}
+
+// HELPER: sizeof an inner node of n's kind
+template<class Key, class Value>
+size_t AdaptiveRadixTree<Key, Value>::innerSize(const RadixInner* n)
+{
+    switch(n->type){
+      case RADIX_NODE4: return sizeof(RadixNode4);
+      case RADIX_NODE16: return sizeof(RadixNode16);
+      case RADIX_NODE48: return sizeof(RadixNode48);
+      default: return sizeof(RadixNode256);
+    }
+}
+
+// HELPER: add child under byte (not present yet), growing n into a
+// bigger kind if it is full; *ref is where n hangs
+template<class Key, class Value>
+void AdaptiveRadixTree<Key, Value>::addChild(RadixNode** ref, RadixInner* n, uint8_t byte, RadixNode* child)
+{
+    switch(n->type){
+      case RADIX_NODE4: {
+        RadixNode4* n4 = static_cast<RadixNode4*>(n);
+        if(n4->count < 4){
+          int pos = 0;
+          while(pos < n4->count && n4->keys[pos] < byte){
+            pos++;
+          }
+          std::memmove(n4->keys + pos + 1, n4->keys + pos, n4->count - pos);
+          std::memmove(n4->children + pos + 1, n4->children + pos, (n4->count - pos) * sizeof(RadixNode*));
+          n4->keys[pos] = byte;
+          n4->children[pos] = child;
+          n4->count++;
+          return;
+        }
+        RadixNode16* n16 = new RadixNode16();
+        copyHeader(n16, n4);
+        std::memcpy(n16->keys, n4->keys, 4);
+        std::memcpy(n16->children, n4->children, 4 * sizeof(RadixNode*));
+        *ref = n16;
+        delete n4;
+        addChild(ref, n16, byte, child);
+        return;
+      }
+      case RADIX_NODE16: {
+        RadixNode16* n16 = static_cast<RadixNode16*>(n);
+        if(n16->count < 16){
+          int pos = 0;
+          while(pos < n16->count && n16->keys[pos] < byte){
+            pos++;
+          }
+          std::memmove(n16->keys + pos + 1, n16->keys + pos, n16->count - pos);
+          std::memmove(n16->children + pos + 1, n16->children + pos, (n16->count - pos) * sizeof(RadixNode*));
+          n16->keys[pos] = byte;
+          n16->children[pos] = child;
+          n16->count++;
+          return;
+        }
+        RadixNode48* n48 = new RadixNode48();
+        copyHeader(n48, n16);
+        for(int i = 0; i < 16; i++){
+          n48->children[i] = n16->children[i];
+          n48->index[n16->keys[i]] = static_cast<uint8_t>(i + 1);
+        }
+        *ref = n48;
+        delete n16;
+        addChild(ref, n48, byte, child);
+        return;
+      }
+      case RADIX_NODE48: {
+        RadixNode48* n48 = static_cast<RadixNode48*>(n);
+        if(n48->count < 48){
+          int slot = 0;
+          while(n48->children[slot] != NULL){
+            slot++;
+          }
+          n48->children[slot] = child;
+          n48->index[byte] = static_cast<uint8_t>(slot + 1);
+          n48->count++;
+          return;
+        }
+        RadixNode256* n256 = new RadixNode256();
+        copyHeader(n256, n48);
+        for(int b = 0; b < 256; b++){
+          if(n48->index[b] != 0){
+            n256->children[b] = n48->children[n48->index[b] - 1];
+          }
+        }
+        *ref = n256;
+        delete n48;
+        addChild(ref, n256, byte, child);
+        return;
+      }
+      default: {
+        RadixNode256* n256 = static_cast<RadixNode256*>(n);
+        n256->children[byte] = child;
+        n256->count++;
+        return;
+      }
+    }
+}
+
+// HELPER: drop the child in slot (for byte), shrinking n into a smaller
+// kind once it is a quarter full, or merging it away if one entry is left
+template<class Key, class Value>
+void AdaptiveRadixTree<Key, Value>::removeChild(RadixNode** ref, RadixInner* n, uint8_t byte, RadixNode** slot)
+{
+    switch(n->type){
+      case RADIX_NODE4: {
+        RadixNode4* n4 = static_cast<RadixNode4*>(n);
+        int pos = static_cast<int>(slot - n4->children);
+        std::memmove(n4->keys + pos, n4->keys + pos + 1, n4->count - pos - 1);
+        std::memmove(n4->children + pos, n4->children + pos + 1, (n4->count - pos - 1) * sizeof(RadixNode*));
+        n4->count--;
+        collapse(ref);
+        return;
+      }
+      case RADIX_NODE16: {
+        RadixNode16* n16 = static_cast<RadixNode16*>(n);
+        int pos = static_cast<int>(slot - n16->children);
+        std::memmove(n16->keys + pos, n16->keys + pos + 1, n16->count - pos - 1);
+        std::memmove(n16->children + pos, n16->children + pos + 1, (n16->count - pos - 1) * sizeof(RadixNode*));
+        n16->count--;
+        if(n16->count == 3){
+          RadixNode4* n4 = new RadixNode4();
+          copyHeader(n4, n16);
+          std::memcpy(n4->keys, n16->keys, 3);
+          std::memcpy(n4->children, n16->children, 3 * sizeof(RadixNode*));
+          *ref = n4;
+          delete n16;
+        }
+        return;
+      }
+      case RADIX_NODE48: {
+        RadixNode48* n48 = static_cast<RadixNode48*>(n);
+        n48->children[n48->index[byte] - 1] = NULL;
+        n48->index[byte] = 0;
+        n48->count--;
+        if(n48->count == 12){
+          RadixNode16* n16 = new RadixNode16();
+          copyHeader(n16, n48);
+          int pos = 0;
+          for(int b = 0; b < 256; b++){
+            if(n48->index[b] != 0){
+              n16->keys[pos] = static_cast<uint8_t>(b);
+              n16->children[pos] = n48->children[n48->index[b] - 1];
+              pos++;
+            }
+          }
+          *ref = n16;
+          delete n48;
+        }
+        return;
+      }
+      default: {
+        RadixNode256* n256 = static_cast<RadixNode256*>(n);
+        n256->children[byte] = NULL;
+        n256->count--;
+        if(n256->count == 37){
+          RadixNode48* n48 = new RadixNode48();
+          copyHeader(n48, n256);
+          int pos = 0;
+          for(int b = 0; b < 256; b++){
+            if(n256->children[b] != NULL){
+              n48->children[pos] = n256->children[b];
+              n48->index[b] = static_cast<uint8_t>(pos + 1);
+              pos++;
+            }
+          }
+          *ref = n48;
+          delete n256;
+        }
+        return;
+      }
+    }
+}
+
+// HELPER: a Node4 left with a single entry is replaced by it; an inner
+// child takes over the path, extended by the node's own path and byte
+template<class Key, class Value>
+void AdaptiveRadixTree<Key, Value>::collapse(RadixNode** ref)
+{
+    if((*ref)->type != RADIX_NODE4){
+      return;
+    }
+    RadixNode4* n4 = static_cast<RadixNode4*>(*ref);
+    if(n4->count + (n4->leaf != NULL ? 1 : 0) != 1){
+      return;
+    }
+    if(n4->count == 0){
+      *ref = n4->leaf;
+      delete n4;
+      return;
+    }
+    RadixNode* child = n4->children[0];
+    if(!isLeaf(child)){
+      RadixInner* in = static_cast<RadixInner*>(child);
+      // the stored bytes of the merged path: ours, the byte, the child's
+      uint8_t merged[2 * RADIX_MAX_PREFIX + 1];
+      size_t len = std::min<size_t>(n4->prefixLen, RADIX_MAX_PREFIX);
+      std::memcpy(merged, n4->prefix, len);
+      merged[len++] = n4->keys[0];
+      std::memcpy(merged + len, in->prefix, std::min<size_t>(in->prefixLen, RADIX_MAX_PREFIX));
+      in->prefixLen += n4->prefixLen + 1;
+      std::memcpy(in->prefix, merged, std::min<size_t>(in->prefixLen, RADIX_MAX_PREFIX));
+    }
+    *ref = child;
+    delete n4;
+}
+
+/*
+---------------------------------------------------
+End implementations for the AdaptiveRadixTree class.
+---------------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef RWLOCK_H
+#define RWLOCK_H
+
+#include <atomic>
+#include <thread>
+#include <cstdint>
+
+// Failed attempts before a waiting thread yields its time slice
+#define RWLOCK_SPIN_COUNT 64
+
+/**
+* A reader-writer spin lock in a single word, standing in for
+* std::shared_mutex (C++17). Any number of readers may hold it together;
+* a writer holds it alone. A waiting writer stops new readers from
+* entering, so a steady stream of readers cannot starve it.
+*
+* lock()/unlock() make it usable with std::lock_guard; ReadGuard is the
+* matching RAII helper for the shared side.
+*/
+class RWLock
+{
+public:
+    RWLock();
+
+    void lock();
+    void unlock();
+    void lock_shared();
+    void unlock_shared();
+
+    /**
+    * Holds an RWLock in shared mode for its lifetime.
+    */
+    class ReadGuard
+    {
+    public:
+        explicit ReadGuard(RWLock& lock);
+        ~ReadGuard();
+
+    private:
+        ReadGuard(const ReadGuard&);
+        ReadGuard& operator=(const ReadGuard&);
+
+        RWLock& lock_;
+    };
+
+private:
+    RWLock(const RWLock&);
+    RWLock& operator=(const RWLock&);
+
+    static void backoff(unsigned& spins);
+
+    // a writer owns the lock
+    static const uint32_t WRITER = 1u << 31;
+    // a writer is waiting, readers must not enter
+    static const uint32_t WAITING = 1u << 30;
+    // the low bits count the readers inside
+    std::atomic<uint32_t> state_;
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the RWLock class.
+  -----------------------------------------------
+*/
+
+/**
+* Default constructor, the lock starts free.
+*/
+inline RWLock::RWLock() :
+    state_(0)
+{
+
+}
+
+/**
+* Takes the lock exclusively. Announces itself first so that readers
+* drain out, then waits for the count to reach zero.
+*/
+inline void RWLock::lock()
+{
+    unsigned spins = 0;
+    while(true){
+      uint32_t state = state_.load(std::memory_order_relaxed);
+      if((state & ~WAITING) == 0){
+        if(state_.compare_exchange_weak(state, WRITER, std::memory_order_acquire)){
+          return;
+        }
+      }
+      else if((state & WAITING) == 0){
+        state_.compare_exchange_weak(state, state | WAITING, std::memory_order_relaxed);
+      }
+      backoff(spins);
+    }
+}
+
+/**
+* Releases an exclusive hold. Other writers may have flagged themselves
+* as waiting meanwhile, so only the owner bit is cleared.
+*/
+inline void RWLock::unlock()
+{
+    state_.fetch_and(~WRITER, std::memory_order_release);
+}
+
+/**
+* Takes the lock in shared mode once no writer holds or wants it.
+*/
+inline void RWLock::lock_shared()
+{
+    unsigned spins = 0;
+    while(true){
+      uint32_t state = state_.load(std::memory_order_relaxed);
+      if((state & (WRITER | WAITING)) == 0){
+        if(state_.compare_exchange_weak(state, state + 1, std::memory_order_acquire)){
+          return;
+        }
+      }
+      backoff(spins);
+    }
+}
+
+/**
+* Releases a shared hold.
+*/
+inline void RWLock::unlock_shared()
+{
+    state_.fetch_sub(1, std::memory_order_release);
+}
+
+// HELPER: spin a little, then start yielding
+inline void RWLock::backoff(unsigned& spins)
+{
+    if(++spins >= RWLOCK_SPIN_COUNT){
+      spins = 0;
+      std::this_thread::yield();
+    }
+}
+
+/**
+* Takes lock in shared mode.
+*/
+inline RWLock::ReadGuard::ReadGuard(RWLock& lock) :
+    lock_(lock)
+{
+    lock_.lock_shared();
+}
+
+/**
+* Releases the shared hold.
+*/
+inline RWLock::ReadGuard::~ReadGuard()
+{
+    lock_.unlock_shared();
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the RWLock class.
+  -----------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,73 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+#include "equal-paths.h"
+#include "shapeanalysis.h"
+
+using namespace std;
+
+// Times analyzeShape() with 1, 2, 4, ... threads on a random-shaped tree
+// of plain equal-paths.h nodes.
+// Usage: shapeanalysis-bench [number of nodes] [max threads]
+
+static double secondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = (argc > 1) ? strtoull(argv[1], NULL, 10) : 4000000;
+    unsigned maxThreads = (argc > 2) ? atoi(argv[2]) : thread::hardware_concurrency();
+    if(maxThreads == 0) {
+        maxThreads = 1;
+    }
+
+    // random BST shape: insert shuffled keys without rebalancing, nodes
+    // drawn from one pool so they are freed together
+    vector<int> keys(n);
+    for(size_t i = 0; i < n; i++) {
+        keys[i] = (int)i;
+    }
+    mt19937 rng(104);
+    shuffle(keys.begin(), keys.end(), rng);
+    vector<Node> pool;
+    pool.reserve(n);
+    for(size_t i = 0; i < n; i++) {
+        pool.push_back(Node(keys[i]));
+        Node* added = &pool.back();
+        if(i == 0) {
+            continue;
+        }
+        Node* cur = &pool[0];
+        while(true) {
+            Node*& next = (added->key < cur->key) ? cur->left : cur->right;
+            if(next == NULL) {
+                next = added;
+                break;
+            }
+            cur = next;
+        }
+    }
+    Node* root = &pool[0];
+
+    cout << "n = " << n << endl;
+    cout << fixed << setprecision(2);
+    double base = 0;
+    for(unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        ShapeReport<Node> report = analyzeShape(root, threads);
+        double t = secondsSince(start);
+        if(threads == 1) {
+            base = t;
+        }
+        cout << setw(3) << threads << " threads " << setw(9) << t * 1e3 << " ms  speedup "
+             << setw(5) << base / t << "x  (height " << report.height
+             << ", unbalanced " << report.violationCount << ")" << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,34 @@
+#include <iostream>
+#include "bst.h"
+#include "avlbst.h"
+#include "shapeanalysis.h"
+
+using namespace std;
+
+
+int main(int argc, char *argv[])
+{
+    // Shape analysis tests: the same keys in a plain BST and an AVL tree
+    BinarySearchTree<int,int> bt;
+    AVLTree<int,int> at;
+    int keys[] = { 50, 20, 80, 10, 30, 5, 1, 90, 95, 99 };
+    for(size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        bt.insert(std::make_pair(keys[i], i));
+        at.insert(std::make_pair(keys[i], i));
+    }
+
+    ShapeReport<Node<int,int> > bstShape = analyzeShape(bt.getRoot(), 2);
+    cout << "BinarySearchTree shape:" << endl;
+    bstShape.print(cout);
+    cout << "Balanced " << bstShape.balanced() << " (isBalanced " << bt.isBalanced() << ")" << endl;
+    for(size_t i = 0; i < bstShape.violations.size(); i++) {
+        cout << "  unbalanced at key " << bstShape.violations[i]->getKey() << endl;
+    }
+
+    ShapeReport<Node<int,int> > avlShape = analyzeShape(at.getRoot());
+    cout << "AVLTree shape:" << endl;
+    avlShape.print(cout);
+    cout << "Balanced " << avlShape.balanced() << ", equal paths " << avlShape.equalPaths() << endl;
+
+    return 0;
+}
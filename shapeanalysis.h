@@ -0,0 +1,323 @@
+#ifndef SHAPEANALYSIS_H
+#define SHAPEANALYSIS_H
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+#include "treewalk.h"
+
+// Unbalanced nodes kept as examples in a report; all of them are counted
+#define SHAPE_MAX_VIOLATIONS 64
+
+/**
+* Everything analyzeShape() measures about a tree. Depths count edges
+* from the root (the root is at depth 0); heights count nodes (a leaf has
+* height 1, an empty subtree 0), as in isBalanced().
+*/
+template <typename NodeT>
+struct ShapeReport
+{
+    ShapeReport();
+
+    double averageDepth() const;
+    double averageLeafDepth() const;
+    // every leaf at the same depth, as equalPaths() checks
+    bool equalPaths() const;
+    // no node whose subtree heights differ by more than one
+    bool balanced() const;
+    void print(std::ostream& os) const;
+    void merge(const ShapeReport<NodeT>& other);
+
+    size_t nodes;
+    size_t leaves;
+    int height;
+    // -1 while there are no leaves
+    int minLeafDepth;
+    int maxLeafDepth;
+    uint64_t depthSum;
+    uint64_t leafDepthSum;
+    // levelCounts[d] nodes and leafDepthCounts[d] leaves at depth d
+    std::vector<size_t> levelCounts;
+    std::vector<size_t> leafDepthCounts;
+    size_t violationCount;
+    int maxImbalance;
+    // the first SHAPE_MAX_VIOLATIONS unbalanced nodes found
+    std::vector<const NodeT*> violations;
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the ShapeReport class.
+  -----------------------------------------------
+*/
+
+/**
+* Default constructor, the report of an empty tree.
+*/
+template<typename NodeT>
+ShapeReport<NodeT>::ShapeReport() :
+    nodes(0), leaves(0), height(0), minLeafDepth(-1), maxLeafDepth(-1),
+    depthSum(0), leafDepthSum(0), violationCount(0), maxImbalance(0)
+{
+
+}
+
+/**
+* Mean depth over all nodes, 0 for an empty tree.
+*/
+template<typename NodeT>
+double ShapeReport<NodeT>::averageDepth() const
+{
+    return (nodes == 0) ? 0.0 : (double)depthSum / nodes;
+}
+
+/**
+* Mean depth over the leaves, 0 for an empty tree.
+*/
+template<typename NodeT>
+double ShapeReport<NodeT>::averageLeafDepth() const
+{
+    return (leaves == 0) ? 0.0 : (double)leafDepthSum / leaves;
+}
+
+/**
+* True if all leaves share one depth; an empty tree qualifies.
+*/
+template<typename NodeT>
+bool ShapeReport<NodeT>::equalPaths() const
+{
+    return minLeafDepth == maxLeafDepth;
+}
+
+/**
+* True if no node is out of balance.
+*/
+template<typename NodeT>
+bool ShapeReport<NodeT>::balanced() const
+{
+    return violationCount == 0;
+}
+
+/**
+* Prints the summary and the per-level counts.
+*/
+template<typename NodeT>
+void ShapeReport<NodeT>::print(std::ostream& os) const
+{
+    os << "nodes " << nodes << ", leaves " << leaves << ", height " << height << std::endl;
+    os << "leaf depth min " << minLeafDepth << ", max " << maxLeafDepth
+       << ", average " << averageLeafDepth() << "; node depth average " << averageDepth() << std::endl;
+    os << "unbalanced nodes " << violationCount << ", worst height difference " << maxImbalance << std::endl;
+    for(size_t d = 0; d < levelCounts.size(); d++){
+      os << "  depth " << d << ": " << levelCounts[d] << " nodes, "
+         << (d < leafDepthCounts.size() ? leafDepthCounts[d] : 0) << " leaves" << std::endl;
+    }
+}
+
+/**
+* Adds the counts of other, which covers a disjoint set of nodes.
+*/
+template<typename NodeT>
+void ShapeReport<NodeT>::merge(const ShapeReport<NodeT>& other)
+{
+    nodes += other.nodes;
+    leaves += other.leaves;
+    height = std::max(height, other.height);
+    if(other.minLeafDepth != -1 && (minLeafDepth == -1 || other.minLeafDepth < minLeafDepth)){
+      minLeafDepth = other.minLeafDepth;
+    }
+    maxLeafDepth = std::max(maxLeafDepth, other.maxLeafDepth);
+    depthSum += other.depthSum;
+    leafDepthSum += other.leafDepthSum;
+
+    if(levelCounts.size() < other.levelCounts.size()){
+      levelCounts.resize(other.levelCounts.size(), 0);
+    }
+    for(size_t d = 0; d < other.levelCounts.size(); d++){
+      levelCounts[d] += other.levelCounts[d];
+    }
+    if(leafDepthCounts.size() < other.leafDepthCounts.size()){
+      leafDepthCounts.resize(other.leafDepthCounts.size(), 0);
+    }
+    for(size_t d = 0; d < other.leafDepthCounts.size(); d++){
+      leafDepthCounts[d] += other.leafDepthCounts[d];
+    }
+
+    violationCount += other.violationCount;
+    maxImbalance = std::max(maxImbalance, other.maxImbalance);
+    for(size_t i = 0; i < other.violations.size() && violations.size() < SHAPE_MAX_VIOLATIONS; i++){
+      violations.push_back(other.violations[i]);
+    }
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the ShapeReport class.
+  -----------------------------------------------
+*/
+
+// HELPER: children of the templated Node<Key, Value> and its subclasses
+template <typename NodeT>
+auto shapeLeft(const NodeT* n, int) -> decltype(n->getLeft())
+{
+    return n->getLeft();
+}
+
+template <typename NodeT>
+auto shapeRight(const NodeT* n, int) -> decltype(n->getRight())
+{
+    return n->getRight();
+}
+
+// HELPER: children of the plain Node struct from equal-paths.h
+template <typename NodeT>
+auto shapeLeft(const NodeT* n, long) -> decltype(n->left)
+{
+    return n->left;
+}
+
+template <typename NodeT>
+auto shapeRight(const NodeT* n, long) -> decltype(n->right)
+{
+    return n->right;
+}
+
+/**
+* Measures a tree in one traversal: node and leaf counts, nodes and
+* leaves per depth, min/max/average depths, and every node whose subtree
+* heights differ by more than one.
+*
+* Works with any node that has getLeft()/getRight() (Node<Key, Value>,
+* AVLNode, ...) or left/right members (the Node of equal-paths.h). The
+* traversal is a ParallelTreeWalk, with nodes counted on the way down and
+* balance-checked on the way up. The tree must not change while it is
+* being analyzed.
+*/
+template <typename NodeT>
+class ShapeAnalyzer
+{
+public:
+    // threads == 0 uses one thread per core
+    static ShapeReport<NodeT> run(const NodeT* root, unsigned threads = 0);
+
+private:
+    friend class ParallelTreeWalk<ShapeAnalyzer<NodeT> >;
+
+    typedef NodeT NodeType;
+    typedef ShapeReport<NodeT> Report;
+    // nothing is passed down but the depth
+    struct Context
+    {
+    };
+
+    const NodeT* left(const NodeT* n) const;
+    const NodeT* right(const NodeT* n) const;
+    void down(const NodeT* n, const Context& context, int depth, ShapeReport<NodeT>& report,
+              bool& enterLeft, bool& enterRight) const;
+    Context childContext(const NodeT* n, const Context& context, bool right) const;
+    int up(const NodeT* n, int depth, int leftHeight, int rightHeight, ShapeReport<NodeT>& report) const;
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the ShapeAnalyzer class.
+  -----------------------------------------------
+*/
+
+/**
+* Analyzes the tree under root with up to threads threads.
+*/
+template<typename NodeT>
+ShapeReport<NodeT> ShapeAnalyzer<NodeT>::run(const NodeT* root, unsigned threads)
+{
+    ShapeReport<NodeT> report;
+    ParallelTreeWalk<ShapeAnalyzer<NodeT> >::run(ShapeAnalyzer<NodeT>(), root, Context(), threads, report);
+    report.height = (int)report.levelCounts.size();
+    return report;
+}
+
+// HELPER: the left child, whichever way the node type exposes it
+template<typename NodeT>
+const NodeT* ShapeAnalyzer<NodeT>::left(const NodeT* n) const
+{
+    return shapeLeft(n, 0);
+}
+
+// HELPER: the right child, whichever way the node type exposes it
+template<typename NodeT>
+const NodeT* ShapeAnalyzer<NodeT>::right(const NodeT* n) const
+{
+    return shapeRight(n, 0);
+}
+
+// HELPER: count n, found at depth, on the way down; every child is entered
+template<typename NodeT>
+void ShapeAnalyzer<NodeT>::down(const NodeT* n, const Context& context, int depth, ShapeReport<NodeT>& report,
+                                bool& enterLeft, bool& enterRight) const
+{
+    enterLeft = (left(n) != NULL);
+    enterRight = (right(n) != NULL);
+    report.nodes++;
+    report.depthSum += depth;
+    if(report.levelCounts.size() <= (size_t)depth){
+      report.levelCounts.resize(depth + 1, 0);
+    }
+    report.levelCounts[depth]++;
+
+    if(!enterLeft && !enterRight){
+      report.leaves++;
+      report.leafDepthSum += depth;
+      if(report.leafDepthCounts.size() <= (size_t)depth){
+        report.leafDepthCounts.resize(depth + 1, 0);
+      }
+      report.leafDepthCounts[depth]++;
+      if(report.minLeafDepth == -1 || depth < report.minLeafDepth){
+        report.minLeafDepth = depth;
+      }
+      report.maxLeafDepth = std::max(report.maxLeafDepth, depth);
+    }
+}
+
+template<typename NodeT>
+typename ShapeAnalyzer<NodeT>::Context ShapeAnalyzer<NodeT>::childContext(const NodeT* n, const Context& context,
+                                                                          bool right) const
+{
+    return Context();
+}
+
+// HELPER: record n if its subtrees differ in height by more than one.
+// Returns the height of the subtree at n.
+template<typename NodeT>
+int ShapeAnalyzer<NodeT>::up(const NodeT* n, int depth, int leftHeight, int rightHeight,
+                             ShapeReport<NodeT>& report) const
+{
+    int imbalance = std::abs(leftHeight - rightHeight);
+    if(imbalance > 1){
+      report.violationCount++;
+      report.maxImbalance = std::max(report.maxImbalance, imbalance);
+      if(report.violations.size() < SHAPE_MAX_VIOLATIONS){
+        report.violations.push_back(n);
+      }
+    }
+    return std::max(leftHeight, rightHeight) + 1;
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the ShapeAnalyzer class.
+  -----------------------------------------------
+*/
+
+/**
+* Shorthand for ShapeAnalyzer<NodeT>::run.
+*/
+template <typename NodeT>
+ShapeReport<NodeT> analyzeShape(const NodeT* root, unsigned threads = 0)
+{
+    return ShapeAnalyzer<NodeT>::run(root, threads);
+}
+
+#endif
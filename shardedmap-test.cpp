@@ -0,0 +1,50 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "shardedmap.h"
+
+using namespace std;
+
+
+int main(int argc, char *argv[])
+{
+    // Range-sharded map tests
+    ShardedMap<int,int> sm(4);
+    sm.insert(std::make_pair(2,20));
+    sm.insert(std::make_pair(1,10));
+    sm.insert(std::make_pair(3,30));
+
+    cout << "ShardedMap contents:" << endl;
+    for(ShardedMap<int,int>::iterator it = sm.begin(); it != sm.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    sm.remove(2);
+    int value;
+    cout << "After removing 2: " << (sm.find(2, value) ? "found" : "not found") << endl;
+
+    // enough concurrent inserts to make the map split into shards
+    vector<thread> writers;
+    for(int t = 0; t < 4; t++) {
+        writers.push_back(thread([&sm, t]() {
+            for(int k = t; k < 20000; k += 4) {
+                sm.insert(std::make_pair(k, k));
+            }
+        }));
+    }
+    for(size_t t = 0; t < writers.size(); t++) {
+        writers[t].join();
+    }
+
+    int count = 0;
+    int prev = -1;
+    bool ordered = true;
+    for(ShardedMap<int,int>::iterator it = sm.begin(); it != sm.end(); ++it) {
+        ordered = ordered && (it->first > prev);
+        prev = it->first;
+        count++;
+    }
+    cout << "Items: " << count << " in " << sm.numShards() << " shards"
+         << (ordered ? " (in order)" : " (out of order)") << endl;
+
+    return 0;
+}
@@ -0,0 +1,830 @@
+#ifndef SHARDEDMAP_H
+#define SHARDEDMAP_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include "avlbst.h"
+#include "rwlock.h"
+#include "epoch.h"
+
+#define SHARDEDMAP_DEFAULT_SHARDS 16
+// Operations a shard serves between checks of whether it needs rebalancing
+#define SHARDEDMAP_CHECK_INTERVAL 4096
+// Operations a thread performs per update of the shared traffic counters:
+// the shard of every such operation is charged for all of them, so the
+// counters are a sample. Must divide SHARDEDMAP_CHECK_INTERVAL.
+#define SHARDEDMAP_OPS_SAMPLE 16
+// Shards smaller than this are never split or shifted
+#define SHARDEDMAP_MIN_SHARD 512
+// Items an iterator copies out of a shard at a time
+#define SHARDEDMAP_ITER_BATCH 256
+
+/**
+* An ordered map that range-partitions its keys over several AVLTree
+* shards, each behind its own reader-writer lock. Operations on keys in
+* different shards touch disjoint locks and never wait for each other.
+*
+* The shard boundaries live in an immutable layout that operations read
+* without locking; a replaced layout is freed through an EpochManager.
+* Each shard also keeps its own bounds under its lock, so an operation
+* that routed with a layout that has since changed notices and retries.
+*
+* Every SHARDEDMAP_CHECK_INTERVAL operations a shard compares its size
+* and traffic with the average. One that is large (or hot) is split in
+* two while there is room for more shards; after that its excess is
+* shifted into the lighter neighbour. Both moves are AVLTree::split and
+* AVLTree::join, O(log n) relinking under the locks of the shards
+* involved; the shard trees keep subtree sizes, so finding the pivot by
+* rank is O(log n) too.
+*
+* The Key type must be default constructible.
+*/
+template <class Key, class Value>
+class ShardedMap
+{
+public:
+    /**
+    * A forward iterator over the whole map in key order. It copies items
+    * out a batch at a time, holding a shard's read lock only while
+    * copying, so it is weakly consistent: every key is seen at most once
+    * and in order, and keys present for the whole scan are always seen.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        const std::pair<Key, Value>& operator*() const;
+        const std::pair<Key, Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class ShardedMap<Key, Value>;
+        explicit iterator(const ShardedMap<Key, Value>* map);
+        void fill();
+
+        const ShardedMap<Key, Value>* map_;
+        std::vector<std::pair<Key, Value> > batch_;
+        size_t pos_;
+        // whether another batch may follow, and the key it starts at
+        bool more_;
+        bool started_;
+        Key resume_;
+    };
+
+    explicit ShardedMap(size_t maxShards = SHARDEDMAP_DEFAULT_SHARDS);
+    ~ShardedMap();
+
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    // copies the value for key into value and returns true if key exists
+    bool find(const Key& key, Value& value) const;
+    // exact when no writer is running
+    size_t size() const;
+    size_t numShards() const;
+
+    iterator begin() const;
+    iterator end() const;
+
+protected:
+    /**
+    * An AVL node that also stores the number of nodes in its subtree.
+    */
+    class SizedNode : public AVLNode<Key, Value>
+    {
+    public:
+        SizedNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent);
+
+        size_t getSize() const;
+        virtual bool refreshAggregate();
+        virtual void swapAggregate(AVLNode<Key, Value>* other);
+
+    protected:
+        size_t size_;
+    };
+
+    /**
+    * An AVLTree that counts its items and can find keys by rank.
+    */
+    class ShardTree : public AVLTree<Key, Value>
+    {
+    public:
+        ShardTree();
+
+        size_t size() const;
+        void setSize(size_t size);
+        // the key with k smaller keys in the tree, for k < size(); O(log n)
+        const Key& keyAt(size_t k) const;
+        // the first item with a key >= key
+        typename AVLTree<Key, Value>::iterator lowerBound(const Key& key) const;
+        // nodes in a possibly empty subtree
+        static size_t sizeOf(Node<Key, Value>* node);
+
+    protected:
+        virtual SizedNode* createNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+        virtual size_t nodeSize() const;
+        virtual void removeNode(Node<Key, Value>* node);
+
+        // read without the shard lock for load statistics
+        std::atomic<size_t> count_;
+    };
+
+    struct Shard
+    {
+        RWLock lock;
+        ShardTree tree;
+        // the shard holds keys in [low, high); guarded by lock
+        bool hasLow;
+        bool hasHigh;
+        Key low;
+        Key high;
+        // operations since the last rebalance
+        std::atomic<uint64_t> ops;
+    };
+
+    struct Layout
+    {
+        // bounds[i] is the lowest key of shards[i + 1]
+        std::vector<Key> bounds;
+        std::vector<Shard*> shards;
+    };
+
+    static bool covers(const Shard* shard, const Key& key);
+    Shard* shardFor(const Key& key) const;
+    void noteOp(EpochManager::Guard& guard, Shard* shard) const;
+    void rebalance(EpochManager::Guard& guard, Shard* shard) const;
+    void splitShard(EpochManager::Guard& guard, Layout* layout, size_t i) const;
+    void shiftShard(EpochManager::Guard& guard, Layout* layout, size_t i, bool hot) const;
+    void publish(EpochManager::Guard& guard, Layout* layout) const;
+
+protected:
+    size_t maxShards_;
+    // the layout changes under const operations when they trigger a rebalance
+    mutable std::atomic<Layout*> layout_;
+    mutable std::mutex rebalance_;
+    mutable EpochManager epochs_;
+};
+
+/*
+--------------------------------------------------------------
+Begin implementations for the ShardedMap::iterator class.
+---------------------------------------------------------------
+*/
+
+/**
+* A default constructor that makes an end iterator.
+*/
+template<class Key, class Value>
+ShardedMap<Key, Value>::iterator::iterator() :
+    map_(NULL), pos_(0), more_(false), started_(false), resume_()
+{
+
+}
+
+/**
+* Explicit constructor that starts a scan of map.
+*/
+template<class Key, class Value>
+ShardedMap<Key, Value>::iterator::iterator(const ShardedMap<Key, Value>* map) :
+    map_(map), pos_(0), more_(true), started_(false), resume_()
+{
+    fill();
+}
+
+/**
+* Provides access to the (copied) item.
+*/
+template<class Key, class Value>
+const std::pair<Key, Value>&
+ShardedMap<Key, Value>::iterator::operator*() const
+{
+    return batch_[pos_];
+}
+
+/**
+* Provides access to the address of the (copied) item.
+*/
+template<class Key, class Value>
+const std::pair<Key, Value>*
+ShardedMap<Key, Value>::iterator::operator->() const
+{
+    return &batch_[pos_];
+}
+
+/**
+* Two iterators are equal when both are at the end, or both are at the
+* same key of the same map.
+*/
+template<class Key, class Value>
+bool
+ShardedMap<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    bool atEnd = pos_ >= batch_.size();
+    bool rhsAtEnd = rhs.pos_ >= rhs.batch_.size();
+    if(atEnd || rhsAtEnd){
+      return atEnd == rhsAtEnd;
+    }
+    return map_ == rhs.map_ && batch_[pos_].first == rhs.batch_[rhs.pos_].first;
+}
+
+/**
+* Negation of operator==.
+*/
+template<class Key, class Value>
+bool
+ShardedMap<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+/**
+* Advances to the next key, fetching a new batch when this one runs out.
+*/
+template<class Key, class Value>
+typename ShardedMap<Key, Value>::iterator&
+ShardedMap<Key, Value>::iterator::operator++()
+{
+    pos_++;
+    if(pos_ >= batch_.size() && more_){
+      fill();
+    }
+    return *this;
+}
+
+/**
+* Copies the next batch, starting at resume_ in whichever shard holds it
+* now. When a shard runs out, the scan resumes at its upper bound, which
+* is where the next shard begins. Empty shards are skipped.
+*/
+template<class Key, class Value>
+void ShardedMap<Key, Value>::iterator::fill()
+{
+    batch_.clear();
+    pos_ = 0;
+    while(batch_.empty() && more_){
+      EpochManager::Guard guard(map_->epochs_);
+      Shard* shard = started_ ? map_->shardFor(resume_) : map_->layout_.load()->shards[0];
+      RWLock::ReadGuard lock(shard->lock);
+      if(started_ && !covers(shard, resume_)){
+        // boundaries moved, route again
+        continue;
+      }
+
+      typename AVLTree<Key, Value>::iterator it =
+        started_ ? shard->tree.lowerBound(resume_) : shard->tree.begin();
+      for( ; it != shard->tree.end() && batch_.size() < SHARDEDMAP_ITER_BATCH; ++it){
+        batch_.push_back(std::make_pair(it->first, it->second));
+      }
+
+      started_ = true;
+      if(it != shard->tree.end()){
+        resume_ = it->first;
+      }
+      else if(shard->hasHigh){
+        resume_ = shard->high;
+      }
+      else {
+        more_ = false;
+      }
+    }
+}
+
+/*
+-------------------------------------------------------------
+End implementations for the ShardedMap::iterator class.
+-------------------------------------------------------------
+*/
+
+/*
+-----------------------------------------------------
+Begin implementations for the ShardedMap::SizedNode class.
+-----------------------------------------------------
+*/
+
+/**
+* An explicit constructor; a new node is a leaf, a subtree of one.
+*/
+template<class Key, class Value>
+ShardedMap<Key, Value>::SizedNode::SizedNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent) :
+    AVLNode<Key, Value>(key, value, parent), size_(1)
+{
+
+}
+
+/**
+* A getter for the number of nodes in the subtree rooted here.
+*/
+template<class Key, class Value>
+size_t ShardedMap<Key, Value>::SizedNode::getSize() const
+{
+    return size_;
+}
+
+/**
+* Recomputes the subtree size from the children's, which must already be
+* up to date.
+*/
+template<class Key, class Value>
+bool ShardedMap<Key, Value>::SizedNode::refreshAggregate()
+{
+    size_ = 1 + ShardTree::sizeOf(this->children_[0]) + ShardTree::sizeOf(this->children_[1]);
+    return true;
+}
+
+/**
+* Trades subtree sizes with other, which must be a SizedNode too.
+*/
+template<class Key, class Value>
+void ShardedMap<Key, Value>::SizedNode::swapAggregate(AVLNode<Key, Value>* other)
+{
+    std::swap(size_, static_cast<SizedNode*>(other)->size_);
+}
+
+/*
+------------------------------------------------------------
+End implementations for the ShardedMap::SizedNode class.
+------------------------------------------------------------
+*/
+
+/*
+-----------------------------------------------------
+Begin implementations for the ShardedMap::ShardTree class.
+-----------------------------------------------------
+*/
+
+/**
+* Default constructor for an empty shard tree.
+*/
+template<class Key, class Value>
+ShardedMap<Key, Value>::ShardTree::ShardTree() :
+    count_(0)
+{
+
+}
+
+/**
+* Number of items in the tree.
+*/
+template<class Key, class Value>
+size_t ShardedMap<Key, Value>::ShardTree::size() const
+{
+    return count_.load(std::memory_order_relaxed);
+}
+
+/**
+* Sets the count after split/join moved items in or out.
+*/
+template<class Key, class Value>
+void ShardedMap<Key, Value>::ShardTree::setSize(size_t size)
+{
+    count_.store(size, std::memory_order_relaxed);
+}
+
+/**
+* Descends from the root by the left subtrees' sizes.
+*/
+template<class Key, class Value>
+const Key& ShardedMap<Key, Value>::ShardTree::keyAt(size_t k) const
+{
+    Node<Key, Value>* node = this->root_;
+    while(true){
+      size_t left = sizeOf(node->getLeft());
+      if(k == left){
+        return node->getKey();
+      }
+      if(k < left){
+        node = node->getLeft();
+      }
+      else {
+        k -= left + 1;
+        node = node->getRight();
+      }
+    }
+}
+
+/**
+* Returns an iterator to the first item whose key is not below key.
+*/
+template<class Key, class Value>
+typename AVLTree<Key, Value>::iterator
+ShardedMap<Key, Value>::ShardTree::lowerBound(const Key& key) const
+{
+    Node<Key, Value>* current = this->root_;
+    Node<Key, Value>* best = NULL;
+    while(current != NULL){
+      if(current->getKey() < key){
+        current = current->getRight();
+      }
+      else {
+        best = current;
+        current = current->getLeft();
+      }
+    }
+    return this->iteratorAt(best);
+}
+
+/**
+* Counts every node the tree allocates.
+*/
+template<class Key, class Value>
+typename ShardedMap<Key, Value>::SizedNode*
+ShardedMap<Key, Value>::ShardTree::createNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return new SizedNode(key, value, static_cast<AVLNode<Key, Value>*>(parent));
+}
+
+template<class Key, class Value>
+size_t ShardedMap<Key, Value>::ShardTree::nodeSize() const
+{
+    return sizeof(SizedNode);
+}
+
+/**
+* Counts every node the tree removes.
+*/
+template<class Key, class Value>
+void ShardedMap<Key, Value>::ShardTree::removeNode(Node<Key, Value>* node)
+{
+    AVLTree<Key, Value>::removeNode(node);
+    count_.store(count_.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+}
+
+/**
+* Nodes in the subtree rooted at node, 0 if it is empty.
+*/
+template<class Key, class Value>
+size_t ShardedMap<Key, Value>::ShardTree::sizeOf(Node<Key, Value>* node)
+{
+    return (node == NULL) ? 0 : static_cast<SizedNode*>(node)->getSize();
+}
+
+/*
+------------------------------------------------------------
+End implementations for the ShardedMap::ShardTree class.
+------------------------------------------------------------
+*/
+
+/*
+-----------------------------------------------------
+Begin implementations for the ShardedMap class.
+-----------------------------------------------------
+*/
+
+/**
+* Starts with one shard covering every key; more are split off as the
+* map grows, up to maxShards.
+*/
+template<class Key, class Value>
+ShardedMap<Key, Value>::ShardedMap(size_t maxShards) :
+    maxShards_(std::max<size_t>(maxShards, 1)), layout_(NULL)
+{
+    Shard* shard = new Shard();
+    shard->hasLow = false;
+    shard->hasHigh = false;
+    shard->ops.store(0);
+    Layout* layout = new Layout();
+    layout->shards.push_back(shard);
+    layout_.store(layout);
+}
+
+/**
+* Frees every shard. No other operation may be running.
+*/
+template<class Key, class Value>
+ShardedMap<Key, Value>::~ShardedMap()
+{
+    Layout* layout = layout_.load();
+    for(size_t i = 0; i < layout->shards.size(); i++){
+      delete layout->shards[i];
+    }
+    delete layout;
+}
+
+/**
+* Inserts the key-value pair, overwriting the value if the key exists.
+* Only the owning shard is locked.
+*/
+template<class Key, class Value>
+void ShardedMap<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    EpochManager::Guard guard(epochs_);
+    Shard* shard;
+    bool done = false;
+    while(!done){
+      shard = shardFor(keyValuePair.first);
+      std::lock_guard<RWLock> lock(shard->lock);
+      if(covers(shard, keyValuePair.first)){
+        shard->tree.insert(keyValuePair);
+        done = true;
+      }
+    }
+    noteOp(guard, shard);
+}
+
+/**
+* Removes the key if it exists.
+*/
+template<class Key, class Value>
+void ShardedMap<Key, Value>::remove(const Key& key)
+{
+    EpochManager::Guard guard(epochs_);
+    Shard* shard;
+    bool done = false;
+    while(!done){
+      shard = shardFor(key);
+      std::lock_guard<RWLock> lock(shard->lock);
+      if(covers(shard, key)){
+        shard->tree.remove(key);
+        done = true;
+      }
+    }
+    noteOp(guard, shard);
+}
+
+/**
+* Looks the key up under the shard's read lock, so readers of one shard
+* run in parallel.
+*/
+template<class Key, class Value>
+bool ShardedMap<Key, Value>::find(const Key& key, Value& value) const
+{
+    EpochManager::Guard guard(epochs_);
+    Shard* shard;
+    bool found = false;
+    bool done = false;
+    while(!done){
+      shard = shardFor(key);
+      RWLock::ReadGuard lock(shard->lock);
+      if(covers(shard, key)){
+        typename AVLTree<Key, Value>::iterator it = shard->tree.find(key);
+        if(it != shard->tree.end()){
+          value = it->second;
+          found = true;
+        }
+        done = true;
+      }
+    }
+    noteOp(guard, shard);
+    return found;
+}
+
+/**
+* Sums the shard sizes.
+*/
+template<class Key, class Value>
+size_t ShardedMap<Key, Value>::size() const
+{
+    EpochManager::Guard guard(epochs_);
+    Layout* layout = layout_.load();
+    size_t total = 0;
+    for(size_t i = 0; i < layout->shards.size(); i++){
+      total += layout->shards[i]->tree.size();
+    }
+    return total;
+}
+
+/**
+* Number of shards in the current layout.
+*/
+template<class Key, class Value>
+size_t ShardedMap<Key, Value>::numShards() const
+{
+    EpochManager::Guard guard(epochs_);
+    return layout_.load()->shards.size();
+}
+
+/**
+* Returns an iterator to the smallest key.
+*/
+template<class Key, class Value>
+typename ShardedMap<Key, Value>::iterator
+ShardedMap<Key, Value>::begin() const
+{
+    return iterator(this);
+}
+
+/**
+* Returns the end iterator.
+*/
+template<class Key, class Value>
+typename ShardedMap<Key, Value>::iterator
+ShardedMap<Key, Value>::end() const
+{
+    return iterator();
+}
+
+// HELPER: whether key is inside the shard's bounds; needs the shard lock
+template<class Key, class Value>
+bool ShardedMap<Key, Value>::covers(const Shard* shard, const Key& key)
+{
+    return (!shard->hasLow || !(key < shard->low)) && (!shard->hasHigh || key < shard->high);
+}
+
+// HELPER: the shard the current layout routes key to; needs an epoch guard
+template<class Key, class Value>
+typename ShardedMap<Key, Value>::Shard*
+ShardedMap<Key, Value>::shardFor(const Key& key) const
+{
+    Layout* layout = layout_.load();
+    size_t i = std::upper_bound(layout->bounds.begin(), layout->bounds.end(), key) - layout->bounds.begin();
+    return layout->shards[i];
+}
+
+/**
+* Counts an operation on shard and looks at the balance every
+* SHARDEDMAP_CHECK_INTERVAL of them. Threads count in private and charge
+* a shard for SHARDEDMAP_OPS_SAMPLE operations at a time, so readers of
+* one shard do not all write its counter's cache line.
+*/
+template<class Key, class Value>
+void ShardedMap<Key, Value>::noteOp(EpochManager::Guard& guard, Shard* shard) const
+{
+    static thread_local unsigned pending = 0;
+    if(++pending < SHARDEDMAP_OPS_SAMPLE){
+      return;
+    }
+    pending = 0;
+    uint64_t ops = shard->ops.fetch_add(SHARDEDMAP_OPS_SAMPLE, std::memory_order_relaxed) + SHARDEDMAP_OPS_SAMPLE;
+    if(ops % SHARDEDMAP_CHECK_INTERVAL == 0){
+      rebalance(guard, shard);
+    }
+}
+
+/**
+* Splits or shifts shard if it is well above average in size or in
+* traffic. Only one thread rebalances at a time; the others skip it.
+*/
+template<class Key, class Value>
+void ShardedMap<Key, Value>::rebalance(EpochManager::Guard& guard, Shard* shard) const
+{
+    std::unique_lock<std::mutex> lock(rebalance_, std::try_to_lock);
+    if(!lock.owns_lock()){
+      return;
+    }
+
+    Layout* layout = layout_.load();
+    size_t n = layout->shards.size();
+    size_t i = std::find(layout->shards.begin(), layout->shards.end(), shard) - layout->shards.begin();
+    size_t totalSize = 0;
+    uint64_t totalOps = 0;
+    for(size_t j = 0; j < n; j++){
+      totalSize += layout->shards[j]->tree.size();
+      totalOps += layout->shards[j]->ops.load(std::memory_order_relaxed);
+    }
+
+    size_t size = shard->tree.size();
+    uint64_t ops = shard->ops.load(std::memory_order_relaxed);
+    if(size < SHARDEDMAP_MIN_SHARD){
+      return;
+    }
+    bool hot = ops * n > 2 * totalOps;
+    bool large = size * n > 2 * totalSize;
+    if(n < maxShards_ && (hot || size * n >= totalSize)){
+      splitShard(guard, layout, i);
+    }
+    else if(n > 1 && (hot || large)){
+      shiftShard(guard, layout, i, hot);
+    }
+    else {
+      return;
+    }
+
+    // start a fresh window for the traffic statistics
+    layout = layout_.load();
+    for(size_t j = 0; j < layout->shards.size(); j++){
+      layout->shards[j]->ops.store(0, std::memory_order_relaxed);
+    }
+}
+
+/**
+* Moves the upper half of shard i into a new shard right after it.
+*/
+template<class Key, class Value>
+void ShardedMap<Key, Value>::splitShard(EpochManager::Guard& guard, Layout* layout, size_t i) const
+{
+    Shard* shard = layout->shards[i];
+    Shard* fresh = new Shard();
+    fresh->ops.store(0);
+
+    std::lock_guard<RWLock> lock(shard->lock);
+    size_t size = shard->tree.size();
+    Key pivot = shard->tree.keyAt(size / 2);
+    shard->tree.split(pivot, fresh->tree);
+    shard->tree.setSize(size / 2);
+    fresh->tree.setSize(size - size / 2);
+
+    fresh->hasLow = true;
+    fresh->low = pivot;
+    fresh->hasHigh = shard->hasHigh;
+    if(shard->hasHigh){
+      fresh->high = shard->high;
+    }
+    shard->hasHigh = true;
+    shard->high = pivot;
+
+    Layout* next = new Layout(*layout);
+    next->bounds.insert(next->bounds.begin() + i, pivot);
+    next->shards.insert(next->shards.begin() + i + 1, fresh);
+    // publish before unlocking, so that callers bounced off shard's new
+    // bounds route with the new layout
+    publish(guard, next);
+}
+
+/**
+* Moves part of shard i into its lighter neighbour (by traffic when hot,
+* by size otherwise): enough to even out their sizes, or their traffic
+* if that is further apart.
+*/
+template<class Key, class Value>
+void ShardedMap<Key, Value>::shiftShard(EpochManager::Guard& guard, Layout* layout, size_t i, bool hot) const
+{
+    size_t n = layout->shards.size();
+    size_t j;
+    if(i == 0){
+      j = 1;
+    }
+    else if(i + 1 == n){
+      j = i - 1;
+    }
+    else if(hot){
+      j = (layout->shards[i - 1]->ops.load(std::memory_order_relaxed)
+           < layout->shards[i + 1]->ops.load(std::memory_order_relaxed)) ? i - 1 : i + 1;
+    }
+    else {
+      j = (layout->shards[i - 1]->tree.size() < layout->shards[i + 1]->tree.size()) ? i - 1 : i + 1;
+    }
+    Shard* shard = layout->shards[i];
+    Shard* neighbour = layout->shards[j];
+
+    // lock in key order; rebalances are serialized, so this cannot deadlock
+    std::lock_guard<RWLock> firstLock(layout->shards[std::min(i, j)]->lock);
+    std::lock_guard<RWLock> secondLock(layout->shards[std::max(i, j)]->lock);
+
+    size_t size = shard->tree.size();
+    size_t neighbourSize = neighbour->tree.size();
+    uint64_t ops = shard->ops.load(std::memory_order_relaxed);
+    uint64_t neighbourOps = neighbour->ops.load(std::memory_order_relaxed);
+    size_t k = 0;
+    if(size > neighbourSize){
+      k = (size - neighbourSize) / 2;
+    }
+    if(ops > neighbourOps){
+      k = std::max(k, (size_t)(size * (double)(ops - neighbourOps) / (2.0 * ops)));
+    }
+    k = std::min(k, size - 1);
+    if(k == 0){
+      return;
+    }
+
+    Layout* next = new Layout(*layout);
+    if(j > i){
+      // the top k keys move up
+      Key pivot = shard->tree.keyAt(size - k);
+      ShardTree moved;
+      shard->tree.split(pivot, moved);
+      neighbour->tree.join(moved);
+      shard->high = pivot;
+      neighbour->low = pivot;
+      next->bounds[i] = pivot;
+    }
+    else {
+      // the bottom k keys move down
+      Key pivot = shard->tree.keyAt(k);
+      ShardTree rest;
+      shard->tree.split(pivot, rest);
+      neighbour->tree.join(shard->tree);
+      shard->tree.join(rest);
+      shard->low = pivot;
+      neighbour->high = pivot;
+      next->bounds[j] = pivot;
+    }
+    shard->tree.setSize(size - k);
+    neighbour->tree.setSize(neighbourSize + k);
+    publish(guard, next);
+}
+
+// HELPER: swap in a new layout; readers of the old one may still be routing
+template<class Key, class Value>
+void ShardedMap<Key, Value>::publish(EpochManager::Guard& guard, Layout* layout) const
+{
+    Layout* old = layout_.exchange(layout);
+    guard.retire(old);
+}
+
+/*
+------------------------------------------------------------
+End implementations for the ShardedMap class.
+------------------------------------------------------------
+*/
+
+#endif
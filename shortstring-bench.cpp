@@ -0,0 +1,84 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include "avlbst.h"
+#include "shortstring.h"
+
+using namespace std;
+
+// Compares find() on an AVLTree keyed by std::string with one keyed by
+// ShortString, for keys that differ early and keys sharing a long prefix.
+// Usage: shortstring-bench [number of keys] [number of lookups]
+
+static double secondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+template<typename Key>
+double timeFinds(const char* name, const vector<string>& keys, const vector<string>& probes)
+{
+    AVLTree<Key, uint32_t> tree;
+    for(size_t i = 0; i < keys.size(); i++) {
+        tree.insert(std::make_pair(Key(keys[i]), (uint32_t)i));
+    }
+    vector<Key> lookups(probes.begin(), probes.end());
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    uint64_t found = 0;
+    for(size_t i = 0; i < lookups.size(); i++) {
+        if(tree.find(lookups[i]) != tree.end()) {
+            found++;
+        }
+    }
+    double seconds = secondsSince(start);
+    cout << setw(14) << name << setw(10) << lookups.size() / seconds / 1e6 << " M lookups/s ("
+         << found << " hits, " << tree.memory_usage().bytesPerEntry() << " bytes per entry)" << endl;
+    return seconds;
+}
+
+static void compare(const char* title, const vector<string>& keys, const vector<string>& probes)
+{
+    cout << title << endl;
+    double stringTime = timeFinds<string>("std::string", keys, probes);
+    double shortTime = timeFinds<ShortString>("ShortString", keys, probes);
+    cout << setw(14) << "speedup" << setw(10) << stringTime / shortTime << "x" << endl << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = (argc > 1) ? strtoull(argv[1], NULL, 10) : 500000;
+    size_t lookups = (argc > 2) ? strtoull(argv[2], NULL, 10) : 2000000;
+    mt19937_64 rng(47);
+
+    // 12 hex digits, differing in the first 8 bytes; and 18-character
+    // ids whose first 8 bytes are all the same
+    vector<string> hexKeys, idKeys;
+    char buffer[32];
+    for(size_t i = 0; i < 2 * n; i++) {
+        snprintf(buffer, sizeof(buffer), "%012llx", (unsigned long long)(rng() & 0xFFFFFFFFFFFFULL));
+        hexKeys.push_back(buffer);
+        snprintf(buffer, sizeof(buffer), "session:%010llu", (unsigned long long)(rng() % 10000000000ULL));
+        idKeys.push_back(buffer);
+    }
+    // insert the first half; probe both halves, so about half miss
+    vector<string> hexProbes, idProbes;
+    for(size_t i = 0; i < lookups; i++) {
+        size_t pick = rng() % (2 * n);
+        hexProbes.push_back(hexKeys[pick]);
+        idProbes.push_back(idKeys[pick]);
+    }
+    hexKeys.resize(n);
+    idKeys.resize(n);
+
+    cout << "n = " << n << ", lookups = " << lookups << endl << fixed << setprecision(2);
+    compare("12 hex digits:", hexKeys, hexProbes);
+    compare("session:<10 digits> (shared 8-byte prefix):", idKeys, idProbes);
+    return 0;
+}
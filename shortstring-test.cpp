@@ -0,0 +1,30 @@
+#include <iostream>
+#include <string>
+#include "avlbst.h"
+#include "shortstring.h"
+
+using namespace std;
+
+
+int main(int argc, char *argv[])
+{
+    // ShortString tests
+    ShortString a("apple"), b("apricot"), c("apple pie with whipped cream");
+    cout << "a = " << a << " (" << a.size() << " chars, inline " << a.isInline() << ")" << endl;
+    cout << "c = " << c << " (" << c.size() << " chars, inline " << c.isInline() << ")" << endl;
+    cout << "a < b: " << (a < b) << ", a < c: " << (a < c) << ", a == apple: " << (a == ShortString("apple")) << endl;
+
+    // as the key of a tree
+    AVLTree<ShortString,int> t;
+    t.insert(std::make_pair(b, 2));
+    t.insert(std::make_pair(c, 3));
+    t.insert(std::make_pair(a, 1));
+    cout << "AVLTree<ShortString,int> contents:" << endl;
+    for(AVLTree<ShortString,int>::iterator it = t.begin(); it != t.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    cout << "t[apricot] = " << t["apricot"] << endl;
+    cout << "sizeof(ShortString) " << sizeof(ShortString) << ", sizeof(std::string) " << sizeof(string) << endl;
+
+    return 0;
+}
@@ -0,0 +1,351 @@
+#ifndef SHORTSTRING_H
+#define SHORTSTRING_H
+
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include "memoryusage.h"
+
+// Bytes of inline storage. Strings of up to SHORTSTRING_INLINE - 1
+// characters (plus the terminating NUL) live inside the object; longer
+// ones keep a heap pointer in the first bytes of the buffer instead.
+// With the prefix and the size the object is 32 bytes, like std::string.
+#define SHORTSTRING_INLINE 20
+
+/**
+* A string key for the search trees: short strings are stored inline, so
+* a node keyed by one needs no second allocation, and the first 8 bytes
+* are cached as a big-endian integer, so most comparisons are a single
+* integer compare that never touches the characters.
+*
+* Ordering is the same as std::string's (bytes compared as unsigned char).
+*/
+class ShortString
+{
+public:
+    ShortString();
+    ShortString(const char* str);
+    ShortString(const char* str, size_t size);
+    ShortString(const std::string& str);
+    ShortString(const ShortString& other);
+    ShortString(ShortString&& other);
+    ~ShortString();
+    ShortString& operator=(const ShortString& other);
+    ShortString& operator=(ShortString&& other);
+
+    size_t size() const;
+    bool empty() const;
+    // true if the characters live inside the object
+    bool isInline() const;
+    // NUL terminated
+    const char* data() const;
+    const char* c_str() const;
+    std::string str() const;
+
+    bool operator==(const ShortString& rhs) const;
+    bool operator!=(const ShortString& rhs) const;
+    bool operator<(const ShortString& rhs) const;
+    bool operator>(const ShortString& rhs) const;
+    bool operator<=(const ShortString& rhs) const;
+    bool operator>=(const ShortString& rhs) const;
+
+protected:
+    // HELPERS:
+    void assign(const char* str, size_t size);
+    void release();
+    char* heap() const;
+    void setHeap(char* chars);
+    static uint64_t prefixOf(const char* str, size_t size);
+
+protected:
+    // the first 8 bytes, big-endian, zero padded
+    uint64_t prefix_;
+    uint32_t size_;
+    // the characters, or (for long strings) a pointer to them
+    char buffer_[SHORTSTRING_INLINE];
+};
+
+std::ostream& operator<<(std::ostream& os, const ShortString& str);
+
+/**
+* A short string owns nothing; a long one owns its characters.
+*/
+template <>
+struct HeapBytes<ShortString>
+{
+    static size_t of(const ShortString& item)
+    {
+        return item.isInline() ? 0 : item.size() + 1;
+    }
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the ShortString class.
+  -----------------------------------------------
+*/
+
+/**
+* Default constructor for the empty string.
+*/
+inline ShortString::ShortString() :
+    prefix_(0), size_(0)
+{
+    buffer_[0] = '\0';
+}
+
+/**
+* Constructor from a NUL terminated string.
+*/
+inline ShortString::ShortString(const char* str)
+{
+    assign(str, std::strlen(str));
+}
+
+/**
+* Constructor from size characters (which may include NULs).
+*/
+inline ShortString::ShortString(const char* str, size_t size)
+{
+    assign(str, size);
+}
+
+/**
+* Constructor from a std::string.
+*/
+inline ShortString::ShortString(const std::string& str)
+{
+    assign(str.data(), str.size());
+}
+
+/**
+* Copy constructor.
+*/
+inline ShortString::ShortString(const ShortString& other)
+{
+    assign(other.data(), other.size_);
+}
+
+/**
+* Move constructor, which takes over a long string's characters and
+* leaves other empty.
+*/
+inline ShortString::ShortString(ShortString&& other) :
+    prefix_(other.prefix_), size_(other.size_)
+{
+    std::memcpy(buffer_, other.buffer_, SHORTSTRING_INLINE);
+    other.prefix_ = 0;
+    other.size_ = 0;
+    other.buffer_[0] = '\0';
+}
+
+/**
+* Destructor, which frees the characters of a long string.
+*/
+inline ShortString::~ShortString()
+{
+    release();
+}
+
+/**
+* Copy assignment.
+*/
+inline ShortString& ShortString::operator=(const ShortString& other)
+{
+    if(this != &other){
+      release();
+      assign(other.data(), other.size_);
+    }
+    return *this;
+}
+
+/**
+* Move assignment.
+*/
+inline ShortString& ShortString::operator=(ShortString&& other)
+{
+    if(this != &other){
+      release();
+      prefix_ = other.prefix_;
+      size_ = other.size_;
+      std::memcpy(buffer_, other.buffer_, SHORTSTRING_INLINE);
+      other.prefix_ = 0;
+      other.size_ = 0;
+      other.buffer_[0] = '\0';
+    }
+    return *this;
+}
+
+/**
+* The number of characters.
+*/
+inline size_t ShortString::size() const
+{
+    return size_;
+}
+
+/**
+* Returns true for the empty string.
+*/
+inline bool ShortString::empty() const
+{
+    return size_ == 0;
+}
+
+/**
+* Returns true if the characters are stored inside the object.
+*/
+inline bool ShortString::isInline() const
+{
+    return size_ < SHORTSTRING_INLINE;
+}
+
+/**
+* The characters, NUL terminated.
+*/
+inline const char* ShortString::data() const
+{
+    return isInline() ? buffer_ : heap();
+}
+
+/**
+* The characters, NUL terminated.
+*/
+inline const char* ShortString::c_str() const
+{
+    return data();
+}
+
+/**
+* A std::string copy.
+*/
+inline std::string ShortString::str() const
+{
+    return std::string(data(), size_);
+}
+
+/**
+* Equal strings have equal prefixes and sizes; only then are the
+* characters past the prefix compared.
+*/
+inline bool ShortString::operator==(const ShortString& rhs) const
+{
+    if(prefix_ != rhs.prefix_ || size_ != rhs.size_){
+      return false;
+    }
+    if(size_ <= sizeof(prefix_)){
+      return true;
+    }
+    return std::memcmp(data() + sizeof(prefix_), rhs.data() + sizeof(prefix_), size_ - sizeof(prefix_)) == 0;
+}
+
+inline bool ShortString::operator!=(const ShortString& rhs) const
+{
+    return !(*this == rhs);
+}
+
+/**
+* Lexicographic order. Different prefixes decide it alone; otherwise the
+* strings agree on their first 8 bytes (as far as both have them) and
+* the rest is compared like std::string does.
+*/
+inline bool ShortString::operator<(const ShortString& rhs) const
+{
+    if(prefix_ != rhs.prefix_){
+      return prefix_ < rhs.prefix_;
+    }
+    size_t common = (size_ < rhs.size_) ? size_ : rhs.size_;
+    if(common > sizeof(prefix_)){
+      int diff = std::memcmp(data() + sizeof(prefix_), rhs.data() + sizeof(prefix_), common - sizeof(prefix_));
+      if(diff != 0){
+        return diff < 0;
+      }
+    }
+    // one is a prefix of the other: the shorter sorts first
+    return size_ < rhs.size_;
+}
+
+inline bool ShortString::operator>(const ShortString& rhs) const
+{
+    return rhs < *this;
+}
+
+inline bool ShortString::operator<=(const ShortString& rhs) const
+{
+    return !(rhs < *this);
+}
+
+inline bool ShortString::operator>=(const ShortString& rhs) const
+{
+    return !(*this < rhs);
+}
+
+// HELPER: copy size characters in, inline or on the heap
+inline void ShortString::assign(const char* str, size_t size)
+{
+    prefix_ = prefixOf(str, size);
+    size_ = static_cast<uint32_t>(size);
+    if(isInline()){
+      std::memcpy(buffer_, str, size);
+      buffer_[size] = '\0';
+    }
+    else {
+      char* chars = new char[size + 1];
+      std::memcpy(chars, str, size);
+      chars[size] = '\0';
+      setHeap(chars);
+    }
+}
+
+// HELPER: free a long string's characters
+inline void ShortString::release()
+{
+    if(!isInline()){
+      delete [] heap();
+    }
+}
+
+// HELPER: the heap pointer of a long string (the buffer is not aligned
+// for a pointer, so it is copied in and out)
+inline char* ShortString::heap() const
+{
+    char* chars;
+    std::memcpy(&chars, buffer_, sizeof(chars));
+    return chars;
+}
+
+inline void ShortString::setHeap(char* chars)
+{
+    std::memcpy(buffer_, &chars, sizeof(chars));
+}
+
+// HELPER: the first 8 bytes as a big-endian integer, zero padded, so
+// integer order is byte order
+inline uint64_t ShortString::prefixOf(const char* str, size_t size)
+{
+    uint64_t prefix = 0;
+    for(size_t i = 0; i < sizeof(prefix); i++){
+      prefix <<= 8;
+      if(i < size){
+        prefix |= static_cast<unsigned char>(str[i]);
+      }
+    }
+    return prefix;
+}
+
+/**
+* Prints the characters.
+*/
+inline std::ostream& operator<<(std::ostream& os, const ShortString& str)
+{
+    return os.write(str.data(), str.size());
+}
+
+/*
+  ---------------------------------------------
+  End implementations for the ShortString class.
+  ---------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,65 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include "avlbst.h"
+#include "stackavl.h"
+
+using namespace std;
+
+// Compares AVLTree (parent links, virtual getters) with StackAVLTree
+// (no parent links) on memory per node and insert/iterate throughput.
+// Usage: stackavl-bench [number of keys]
+
+static double secondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+template<typename Tree>
+void run(const char* name, const vector<uint64_t>& keys, size_t nodeBytes)
+{
+    Tree tree;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(size_t i = 0; i < keys.size(); i++) {
+        tree.insert(std::make_pair(keys[i], keys[i]));
+    }
+    double insertTime = secondsSince(start);
+
+    start = chrono::steady_clock::now();
+    uint64_t sum = 0;
+    for(typename Tree::iterator it = tree.begin(); it != tree.end(); ++it) {
+        sum += it->second;
+    }
+    double iterateTime = secondsSince(start);
+
+    cout << setw(14) << name
+         << setw(8) << nodeBytes << " B/node"
+         << setw(12) << fixed << setprecision(2) << keys.size() / insertTime / 1e6 << " M ins/s"
+         << setw(12) << keys.size() / iterateTime / 1e6 << " M it/s"
+         << "  (checksum " << sum << ")" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = (argc > 1) ? strtoull(argv[1], NULL, 10) : 1000000;
+
+    vector<uint64_t> keys(n);
+    for(size_t i = 0; i < n; i++) {
+        keys[i] = i;
+    }
+
+    cout << "Sequential keys, n = " << n << endl;
+    run<AVLTree<uint64_t,uint64_t> >("AVLTree", keys, sizeof(AVLNode<uint64_t,uint64_t>));
+    run<StackAVLTree<uint64_t,uint64_t> >("StackAVLTree", keys, sizeof(StackAVLNode<uint64_t,uint64_t>));
+
+    shuffle(keys.begin(), keys.end(), mt19937_64(104));
+    cout << "Random keys, n = " << n << endl;
+    run<AVLTree<uint64_t,uint64_t> >("AVLTree", keys, sizeof(AVLNode<uint64_t,uint64_t>));
+    run<StackAVLTree<uint64_t,uint64_t> >("StackAVLTree", keys, sizeof(StackAVLNode<uint64_t,uint64_t>));
+
+    return 0;
+}
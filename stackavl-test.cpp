@@ -0,0 +1,30 @@
+#include <iostream>
+#include "stackavl.h"
+
+using namespace std;
+
+
+int main(int argc, char *argv[])
+{
+    // Parent-pointer-free AVL Tree tests
+    StackAVLTree<char,int> st;
+    st.insert(std::make_pair('a',1));
+    st.insert(std::make_pair('b',2));
+    st.insert(std::make_pair('c',3));
+
+    cout << "StackAVLTree contents:" << endl;
+    for(StackAVLTree<char,int>::iterator it = st.begin(); it != st.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    if(st.find('b') != st.end()) {
+        cout << "Found b" << endl;
+    }
+    else {
+        cout << "Did not find b" << endl;
+    }
+    cout << "Erasing b" << endl;
+    st.remove('b');
+    cout << "Balanced " << st.isBalanced() << endl;
+
+    return 0;
+}
@@ -0,0 +1,727 @@
+#ifndef STACKAVL_H
+#define STACKAVL_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+#include "memoryusage.h"
+
+// Deepest path a StackAVLTree can hold. An AVL tree of height 64 has
+// more than 10^13 nodes, so this bound is never reached in practice.
+#define STACKAVL_MAX_HEIGHT 64
+
+/**
+* A node for the parent-pointer-free AVL tree. It only stores its two
+* children and its balance, and has no vtable. All upward movement is
+* done with a path stack recorded during the descent.
+*/
+template <typename Key, typename Value>
+class StackAVLNode
+{
+public:
+    StackAVLNode(const Key& key, const Value& value);
+
+    const std::pair<const Key, Value>& getItem() const;
+    std::pair<const Key, Value>& getItem();
+    const Key& getKey() const;
+    const Value& getValue() const;
+    Value& getValue();
+    void setValue(const Value &value);
+
+    StackAVLNode<Key, Value>* getLeft() const;
+    StackAVLNode<Key, Value>* getRight() const;
+    StackAVLNode<Key, Value>* getChild(int dir) const;
+    void setLeft(StackAVLNode<Key, Value>* left);
+    void setRight(StackAVLNode<Key, Value>* right);
+    void setChild(int dir, StackAVLNode<Key, Value>* child);
+
+    int8_t getBalance() const;
+    void setBalance(int8_t balance);
+    void updateBalance(int8_t diff);
+
+protected:
+    std::pair<const Key, Value> item_;
+    StackAVLNode<Key, Value>* child_[2];   // 0 = left, 1 = right
+    int8_t balance_;
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the StackAVLNode class.
+  -----------------------------------------------
+*/
+
+/**
+* Explicit constructor for a leaf node.
+*/
+template<typename Key, typename Value>
+StackAVLNode<Key, Value>::StackAVLNode(const Key& key, const Value& value) :
+    item_(key, value),
+    balance_(0)
+{
+    child_[0] = NULL;
+    child_[1] = NULL;
+}
+
+/**
+* A const getter for the item.
+*/
+template<typename Key, typename Value>
+const std::pair<const Key, Value>& StackAVLNode<Key, Value>::getItem() const
+{
+    return item_;
+}
+
+/**
+* A non-const getter for the item.
+*/
+template<typename Key, typename Value>
+std::pair<const Key, Value>& StackAVLNode<Key, Value>::getItem()
+{
+    return item_;
+}
+
+/**
+* A const getter for the key.
+*/
+template<typename Key, typename Value>
+const Key& StackAVLNode<Key, Value>::getKey() const
+{
+    return item_.first;
+}
+
+/**
+* A const getter for the value.
+*/
+template<typename Key, typename Value>
+const Value& StackAVLNode<Key, Value>::getValue() const
+{
+    return item_.second;
+}
+
+/**
+* A non-const getter for the value.
+*/
+template<typename Key, typename Value>
+Value& StackAVLNode<Key, Value>::getValue()
+{
+    return item_.second;
+}
+
+/**
+* A setter for the value of a node.
+*/
+template<typename Key, typename Value>
+void StackAVLNode<Key, Value>::setValue(const Value& value)
+{
+    item_.second = value;
+}
+
+/**
+* A getter for the left child.
+*/
+template<typename Key, typename Value>
+StackAVLNode<Key, Value>* StackAVLNode<Key, Value>::getLeft() const
+{
+    return child_[0];
+}
+
+/**
+* A getter for the right child.
+*/
+template<typename Key, typename Value>
+StackAVLNode<Key, Value>* StackAVLNode<Key, Value>::getRight() const
+{
+    return child_[1];
+}
+
+/**
+* A getter for a child by direction (0 = left, 1 = right).
+*/
+template<typename Key, typename Value>
+StackAVLNode<Key, Value>* StackAVLNode<Key, Value>::getChild(int dir) const
+{
+    return child_[dir];
+}
+
+/**
+* A setter for the left child.
+*/
+template<typename Key, typename Value>
+void StackAVLNode<Key, Value>::setLeft(StackAVLNode<Key, Value>* left)
+{
+    child_[0] = left;
+}
+
+/**
+* A setter for the right child.
+*/
+template<typename Key, typename Value>
+void StackAVLNode<Key, Value>::setRight(StackAVLNode<Key, Value>* right)
+{
+    child_[1] = right;
+}
+
+/**
+* A setter for a child by direction (0 = left, 1 = right).
+*/
+template<typename Key, typename Value>
+void StackAVLNode<Key, Value>::setChild(int dir, StackAVLNode<Key, Value>* child)
+{
+    child_[dir] = child;
+}
+
+/**
+* A getter for the balance (right height minus left height).
+*/
+template<typename Key, typename Value>
+int8_t StackAVLNode<Key, Value>::getBalance() const
+{
+    return balance_;
+}
+
+/**
+* A setter for the balance.
+*/
+template<typename Key, typename Value>
+void StackAVLNode<Key, Value>::setBalance(int8_t balance)
+{
+    balance_ = balance;
+}
+
+/**
+* Adds diff to the balance.
+*/
+template<typename Key, typename Value>
+void StackAVLNode<Key, Value>::updateBalance(int8_t diff)
+{
+    balance_ += diff;
+}
+
+/*
+  ---------------------------------------------
+  End implementations for the StackAVLNode class.
+  ---------------------------------------------
+*/
+
+/**
+* An AVL tree without parent links, with the same public interface as
+* AVLTree. Insert and remove record the root-to-node path on the way
+* down and rebalance back up along it. Iterators carry the pending part
+* of that path (the ancestors still to be visited), so ++ needs no
+* parent pointer either.
+*/
+template <typename Key, typename Value>
+class StackAVLTree
+{
+public:
+    typedef StackAVLNode<Key, Value> NodeType;
+
+    StackAVLTree();
+    ~StackAVLTree();
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool isBalanced() const;
+    bool empty() const;
+    // bytes used by the nodes and what their keys and values own; O(n)
+    MemoryUsage memory_usage() const;
+
+public:
+    /**
+    * An in-order iterator holding a bounded stack of pending nodes.
+    * The top of the stack is the current node.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const Key,Value>& operator*() const;
+        std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class StackAVLTree<Key, Value>;
+        void pushLeftSpine(NodeType* n);
+        NodeType* current() const;
+
+        NodeType* stack_[STACKAVL_MAX_HEIGHT];
+        int depth_;
+    };
+
+public:
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    NodeType* internalFind(const Key& key) const;
+    void deleteSubtree(NodeType* current);
+
+    //HELPERS:
+    static NodeType* rotate(NodeType* n, bool& shorter);
+    void setSubtree(NodeType** path, int* dirs, int i, NodeType* subtree);
+
+protected:
+    NodeType* root_;
+};
+
+/*
+--------------------------------------------------------------
+Begin implementations for the StackAVLTree::iterator class.
+---------------------------------------------------------------
+*/
+
+/**
+* A default constructor that initializes the iterator to end().
+*/
+template<class Key, class Value>
+StackAVLTree<Key, Value>::iterator::iterator() :
+    depth_(0)
+{
+
+}
+
+/**
+* Pushes n and its chain of left children (the next nodes in order).
+*/
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::iterator::pushLeftSpine(NodeType* n)
+{
+    while(n != NULL){
+      stack_[depth_++] = n;
+      n = n->getLeft();
+    }
+}
+
+/**
+* The node the iterator is on, or NULL at end().
+*/
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::NodeType*
+StackAVLTree<Key, Value>::iterator::current() const
+{
+    return depth_ == 0 ? NULL : stack_[depth_ - 1];
+}
+
+/**
+* Provides access to the item.
+*/
+template<class Key, class Value>
+std::pair<const Key,Value> &
+StackAVLTree<Key, Value>::iterator::operator*() const
+{
+    return current()->getItem();
+}
+
+/**
+* Provides access to the address of the item.
+*/
+template<class Key, class Value>
+std::pair<const Key,Value> *
+StackAVLTree<Key, Value>::iterator::operator->() const
+{
+    return &(current()->getItem());
+}
+
+/**
+* Checks if 'this' iterator is on the same node as 'rhs'
+*/
+template<class Key, class Value>
+bool
+StackAVLTree<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    return current() == rhs.current();
+}
+
+/**
+* Checks if 'this' iterator is on a different node than 'rhs'
+*/
+template<class Key, class Value>
+bool
+StackAVLTree<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return current() != rhs.current();
+}
+
+/**
+* Advances the iterator's location using an in-order sequencing.
+* The current node is done; its right subtree comes next, then the
+* nearest pending ancestor already on the stack.
+*/
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::iterator&
+StackAVLTree<Key, Value>::iterator::operator++()
+{
+    NodeType* done = stack_[--depth_];
+    pushLeftSpine(done->getRight());
+    return *this;
+}
+
+/*
+-------------------------------------------------------------
+End implementations for the StackAVLTree::iterator class.
+-------------------------------------------------------------
+*/
+
+/*
+-----------------------------------------------------
+Begin implementations for the StackAVLTree class.
+-----------------------------------------------------
+*/
+
+/**
+* Default constructor for an empty tree.
+*/
+template<class Key, class Value>
+StackAVLTree<Key, Value>::StackAVLTree() :
+    root_(NULL)
+{
+
+}
+
+template<class Key, class Value>
+StackAVLTree<Key, Value>::~StackAVLTree()
+{
+    clear();
+}
+
+/**
+ * Returns true if tree is empty
+*/
+template<class Key, class Value>
+bool StackAVLTree<Key, Value>::empty() const
+{
+    return root_ == NULL;
+}
+
+/**
+* Reports the memory held by the nodes, each its own allocation.
+*/
+template<class Key, class Value>
+MemoryUsage StackAVLTree<Key, Value>::memory_usage() const
+{
+    MemoryUsage usage;
+    size_t nodes = 0;
+    for(iterator it = begin(); it != end(); ++it){
+      usage.addEntry<Key, Value>(*it);
+      nodes++;
+    }
+    usage.addNodes<Key, Value>(nodes, sizeof(NodeType));
+    return usage;
+}
+
+/**
+* Removes all contents of the tree.
+*/
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::clear()
+{
+    deleteSubtree(root_);
+    root_ = NULL;
+}
+
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::deleteSubtree(NodeType* current)
+{
+    if(current == NULL){
+      return;
+    }
+    deleteSubtree(current->getLeft());
+    deleteSubtree(current->getRight());
+    delete current;
+}
+
+/**
+* Returns an iterator to the "smallest" item in the tree
+*/
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::iterator
+StackAVLTree<Key, Value>::begin() const
+{
+    iterator it;
+    it.pushLeftSpine(root_);
+    return it;
+}
+
+/**
+* Returns an iterator whose value means INVALID
+*/
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::iterator
+StackAVLTree<Key, Value>::end() const
+{
+    return iterator();
+}
+
+/**
+* Returns an iterator to the item with the given key, or end().
+* Only the ancestors we step left from are still pending in key order,
+* so only those are kept on the iterator's stack.
+*/
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::iterator
+StackAVLTree<Key, Value>::find(const Key& key) const
+{
+    iterator it;
+    NodeType* current = root_;
+    while(current != NULL){
+      if(key == current->getKey()){
+        it.stack_[it.depth_++] = current;
+        return it;
+      }
+      if(key < current->getKey()){
+        it.stack_[it.depth_++] = current;
+        current = current->getLeft();
+      }
+      else {
+        current = current->getRight();
+      }
+    }
+    return iterator();
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value>
+Value& StackAVLTree<Key, Value>::operator[](const Key& key)
+{
+    NodeType* curr = internalFind(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->getValue();
+}
+template<class Key, class Value>
+Value const & StackAVLTree<Key, Value>::operator[](const Key& key) const
+{
+    NodeType* curr = internalFind(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->getValue();
+}
+
+/**
+* Helper function to find a node with given key, or NULL.
+*/
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::NodeType*
+StackAVLTree<Key, Value>::internalFind(const Key& key) const
+{
+    NodeType* current = root_;
+    while(current != NULL){
+      if(key == current->getKey()){
+        return current;
+      }
+      current = (key < current->getKey()) ? current->getLeft() : current->getRight();
+    }
+    return NULL;
+}
+
+/**
+ * Return true iff the tree is balanced. Inserts and removals rebalance
+ * before they return, so this is O(1).
+ */
+template<class Key, class Value>
+bool StackAVLTree<Key, Value>::isBalanced() const
+{
+    return true;
+}
+
+// HELPER: hang subtree where path[i] used to be (under path[i-1], or as root)
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::setSubtree(NodeType** path, int* dirs, int i, NodeType* subtree)
+{
+    if(i == 0){
+      root_ = subtree;
+    }
+    else {
+      path[i-1]->setChild(dirs[i-1], subtree);
+    }
+    path[i] = subtree;
+}
+
+// HELPER: rotate a node whose balance is -2 or 2 and return the new
+// subtree root. shorter tells whether the subtree lost height.
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::NodeType*
+StackAVLTree<Key, Value>::rotate(NodeType* n, bool& shorter)
+{
+    // dir: side of the taller child, sign: matching balance sign
+    int dir = n->getBalance() < 0 ? 0 : 1;
+    int sign = dir == 0 ? -1 : 1;
+    NodeType* c = n->getChild(dir);
+
+    // zig zig -- single rotation
+    if(c->getBalance() != -sign){
+      n->setChild(dir, c->getChild(1 - dir));
+      c->setChild(1 - dir, n);
+      if(c->getBalance() == 0){
+        n->setBalance(sign);
+        c->setBalance(-sign);
+        shorter = false;
+      }
+      else {
+        n->setBalance(0);
+        c->setBalance(0);
+        shorter = true;
+      }
+      return c;
+    }
+
+    // zig zag -- double rotation around g
+    NodeType* g = c->getChild(1 - dir);
+    int gBalance = g->getBalance();
+    c->setChild(1 - dir, g->getChild(dir));
+    n->setChild(dir, g->getChild(1 - dir));
+    g->setChild(dir, c);
+    g->setChild(1 - dir, n);
+    n->setBalance(gBalance == sign ? -sign : 0);
+    c->setBalance(gBalance == -sign ? sign : 0);
+    g->setBalance(0);
+    shorter = true;
+    return g;
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ */
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    NodeType* path[STACKAVL_MAX_HEIGHT];
+    int dirs[STACKAVL_MAX_HEIGHT];
+    int depth = 0;
+
+    // descend, recording the path
+    NodeType* current = root_;
+    while(current != NULL){
+      if(keyValuePair.first == current->getKey()){
+        current->setValue(keyValuePair.second);
+        return;
+      }
+      path[depth] = current;
+      dirs[depth] = (keyValuePair.first < current->getKey()) ? 0 : 1;
+      current = current->getChild(dirs[depth]);
+      depth++;
+    }
+
+    NodeType* newNode = new NodeType(keyValuePair.first, keyValuePair.second);
+    if(depth == 0){
+      root_ = newNode;
+      return;
+    }
+    path[depth-1]->setChild(dirs[depth-1], newNode);
+
+    // walk back up: the subtree below path[i] grew on side dirs[i]
+    for(int i = depth - 1; i >= 0; i--){
+      NodeType* n = path[i];
+      n->updateBalance(dirs[i] == 0 ? -1 : 1);
+      if(n->getBalance() == 0){
+        return;
+      }
+      if(n->getBalance() == -2 || n->getBalance() == 2){
+        bool shorter;
+        setSubtree(path, dirs, i, rotate(n, shorter));
+        // a rotation after an insert restores the old height
+        return;
+      }
+    }
+}
+
+/*
+ * Recall: The writeup specifies that if a node has 2 children you
+ * should swap with the predecessor and then remove.
+ */
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::remove(const Key& key)
+{
+    NodeType* path[STACKAVL_MAX_HEIGHT];
+    int dirs[STACKAVL_MAX_HEIGHT];
+    int depth = 0;
+
+    // descend to the node, recording the path
+    NodeType* current = root_;
+    while(current != NULL && !(key == current->getKey())){
+      path[depth] = current;
+      dirs[depth] = (key < current->getKey()) ? 0 : 1;
+      current = current->getChild(dirs[depth]);
+      depth++;
+    }
+    if(current == NULL){
+      return;
+    }
+    NodeType* remove = current;
+    int removeAt = depth;
+    path[depth] = remove;
+
+    if(remove->getLeft() != NULL && remove->getRight() != NULL){
+      // keep descending to the predecessor
+      dirs[depth++] = 0;
+      current = remove->getLeft();
+      while(current->getRight() != NULL){
+        path[depth] = current;
+        dirs[depth++] = 1;
+        current = current->getRight();
+      }
+      NodeType* pred = current;
+
+      // unlink pred, then let it take remove's place in the tree and path
+      if(depth - 1 == removeAt){
+        // pred is remove's left child and keeps its own left subtree
+      }
+      else {
+        path[depth-1]->setRight(pred->getLeft());
+        pred->setLeft(remove->getLeft());
+      }
+      pred->setRight(remove->getRight());
+      pred->setBalance(remove->getBalance());
+      setSubtree(path, dirs, removeAt, pred);
+    }
+    else {
+      // hang the only child (or nothing) in remove's place
+      NodeType* child = remove->getLeft() != NULL ? remove->getLeft() : remove->getRight();
+      if(depth == 0){
+        root_ = child;
+      }
+      else {
+        path[depth-1]->setChild(dirs[depth-1], child);
+      }
+    }
+    delete remove;
+
+    // walk back up: the subtree below path[i] shrank on side dirs[i]
+    for(int i = depth - 1; i >= 0; i--){
+      NodeType* n = path[i];
+      n->updateBalance(dirs[i] == 0 ? 1 : -1);
+      if(n->getBalance() == -1 || n->getBalance() == 1){
+        return;
+      }
+      if(n->getBalance() == -2 || n->getBalance() == 2){
+        bool shorter;
+        setSubtree(path, dirs, i, rotate(n, shorter));
+        if(!shorter){
+          return;
+        }
+      }
+    }
+}
+
+/*
+---------------------------------------------------
+End implementations for the StackAVLTree class.
+---------------------------------------------------
+*/
+
+#endif
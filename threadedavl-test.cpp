@@ -0,0 +1,37 @@
+#include <iostream>
+#include "threadedavl.h"
+
+using namespace std;
+
+
+int main(int argc, char *argv[])
+{
+    // Threaded AVL Tree tests
+    ThreadedAVLTree<char,int> tt;
+    tt.insert(std::make_pair('b',2));
+    tt.insert(std::make_pair('a',1));
+    tt.insert(std::make_pair('c',3));
+
+    cout << "ThreadedAVLTree contents:" << endl;
+    for(ThreadedAVLTree<char,int>::iterator it = tt.begin(); it != tt.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    cout << "Backwards:";
+    ThreadedAVLTree<char,int>::iterator it = tt.end();
+    while(it != tt.begin()) {
+        --it;
+        cout << " " << it->first;
+    }
+    cout << endl;
+    if(tt.find('b') != tt.end()) {
+        cout << "Found b" << endl;
+    }
+    else {
+        cout << "Did not find b" << endl;
+    }
+    cout << "Erasing b" << endl;
+    tt.remove('b');
+    cout << "Next after a: " << (++tt.find('a'))->first << endl;
+
+    return 0;
+}
@@ -0,0 +1,455 @@
+#ifndef THREADEDAVL_H
+#define THREADEDAVL_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <cstdint>
+#include "avlbst.h"
+
+/**
+* An AVL node that is also threaded onto the in-order list of the tree:
+* next_/prev_ point straight at the successor and predecessor.
+*/
+template <typename Key, typename Value>
+class ThreadedAVLNode : public AVLNode<Key, Value>
+{
+public:
+    ThreadedAVLNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent);
+    virtual ~ThreadedAVLNode();
+
+    ThreadedAVLNode<Key, Value>* getNext() const;
+    ThreadedAVLNode<Key, Value>* getPrev() const;
+    void setNext(ThreadedAVLNode<Key, Value>* next);
+    void setPrev(ThreadedAVLNode<Key, Value>* prev);
+
+protected:
+    ThreadedAVLNode<Key, Value>* next_;
+    ThreadedAVLNode<Key, Value>* prev_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the ThreadedAVLNode class.
+  -------------------------------------------------
+*/
+
+/**
+* An explicit constructor; the tree threads the node in after creating it.
+*/
+template<class Key, class Value>
+ThreadedAVLNode<Key, Value>::ThreadedAVLNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent) :
+    AVLNode<Key, Value>(key, value, parent), next_(NULL), prev_(NULL)
+{
+
+}
+
+/**
+* A destructor which does nothing.
+*/
+template<class Key, class Value>
+ThreadedAVLNode<Key, Value>::~ThreadedAVLNode()
+{
+
+}
+
+/**
+* A getter for the in-order successor thread.
+*/
+template<class Key, class Value>
+ThreadedAVLNode<Key, Value>* ThreadedAVLNode<Key, Value>::getNext() const
+{
+    return next_;
+}
+
+/**
+* A getter for the in-order predecessor thread.
+*/
+template<class Key, class Value>
+ThreadedAVLNode<Key, Value>* ThreadedAVLNode<Key, Value>::getPrev() const
+{
+    return prev_;
+}
+
+/**
+* A setter for the in-order successor thread.
+*/
+template<class Key, class Value>
+void ThreadedAVLNode<Key, Value>::setNext(ThreadedAVLNode<Key, Value>* next)
+{
+    next_ = next;
+}
+
+/**
+* A setter for the in-order predecessor thread.
+*/
+template<class Key, class Value>
+void ThreadedAVLNode<Key, Value>::setPrev(ThreadedAVLNode<Key, Value>* prev)
+{
+    prev_ = prev;
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the ThreadedAVLNode class.
+  -----------------------------------------------
+*/
+
+/**
+* An AVLTree whose nodes are threaded in key order, so iterator ++ and --
+* are a single pointer load in the worst case and a full scan touches
+* each node exactly once.
+*
+* Rotations and the node swaps done by remove move nodes around but never
+* change their key order, so the threads only change when a node is
+* created or freed.
+*/
+template <class Key, class Value>
+class ThreadedAVLTree : public AVLTree<Key, Value>
+{
+public:
+    typedef ThreadedAVLNode<Key, Value> NodeType;
+
+    /**
+    * A bidirectional iterator that follows the threads.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const Key,Value>& operator*() const;
+        std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+        iterator& operator--();
+
+    protected:
+        friend class ThreadedAVLTree<Key, Value>;
+        iterator(NodeType* ptr, const ThreadedAVLTree<Key, Value>* tree);
+        NodeType* current_;
+        // needed so --end() can find the maximum
+        const ThreadedAVLTree<Key, Value>* tree_;
+    };
+
+    using AVLTree<Key, Value>::insert;
+    iterator insert(iterator hint, const std::pair<const Key, Value> &new_item);
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    iterator erase(iterator pos);
+    iterator erase(iterator first, iterator last);
+    // AVLTree::split/join that also cut or splice the threads
+    void split(const Key& key, ThreadedAVLTree<Key, Value>& rest);
+    void join(ThreadedAVLTree<Key, Value>& other);
+
+protected:
+    virtual NodeType* createNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual size_t nodeSize() const;
+    virtual void removeNode(Node<Key, Value>* node);
+    virtual void removeRange(Node<Key, Value>* first, Node<Key, Value>* last);
+    iterator threadedAt(typename BinarySearchTree<Key, Value>::iterator it) const;
+};
+
+/*
+--------------------------------------------------------------
+Begin implementations for the ThreadedAVLTree::iterator class.
+---------------------------------------------------------------
+*/
+
+/**
+* Explicit constructor that initializes an iterator with a given node pointer.
+*/
+template<class Key, class Value>
+ThreadedAVLTree<Key, Value>::iterator::iterator(NodeType* ptr, const ThreadedAVLTree<Key, Value>* tree) :
+    current_(ptr), tree_(tree)
+{
+
+}
+
+/**
+* A default constructor that initializes the iterator to NULL.
+*/
+template<class Key, class Value>
+ThreadedAVLTree<Key, Value>::iterator::iterator() :
+    current_(NULL), tree_(NULL)
+{
+
+}
+
+/**
+* Provides access to the item.
+*/
+template<class Key, class Value>
+std::pair<const Key,Value> &
+ThreadedAVLTree<Key, Value>::iterator::operator*() const
+{
+    return current_->getItem();
+}
+
+/**
+* Provides access to the address of the item.
+*/
+template<class Key, class Value>
+std::pair<const Key,Value> *
+ThreadedAVLTree<Key, Value>::iterator::operator->() const
+{
+    return &(current_->getItem());
+}
+
+/**
+* Checks if 'this' iterator's internals have the same value
+* as 'rhs'
+*/
+template<class Key, class Value>
+bool
+ThreadedAVLTree<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    return current_ == rhs.current_;
+}
+
+/**
+* Checks if 'this' iterator's internals have a different value
+* as 'rhs'
+*/
+template<class Key, class Value>
+bool
+ThreadedAVLTree<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return current_ != rhs.current_;
+}
+
+/**
+* Advances to the in-order successor: one pointer load.
+*/
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::iterator&
+ThreadedAVLTree<Key, Value>::iterator::operator++()
+{
+    current_ = current_->getNext();
+    return (*this);
+}
+
+/**
+* Moves to the in-order predecessor; --end() is the maximum.
+*/
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::iterator&
+ThreadedAVLTree<Key, Value>::iterator::operator--()
+{
+    if(current_ == NULL){
+      current_ = static_cast<NodeType*>(tree_->rightmost_);
+    }
+    else {
+      current_ = current_->getPrev();
+    }
+    return (*this);
+}
+
+/*
+-------------------------------------------------------------
+End implementations for the ThreadedAVLTree::iterator class.
+-------------------------------------------------------------
+*/
+
+/*
+-----------------------------------------------------
+Begin implementations for the ThreadedAVLTree class.
+-----------------------------------------------------
+*/
+
+/**
+* Returns an iterator to the "smallest" item in the tree
+*/
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::iterator
+ThreadedAVLTree<Key, Value>::begin() const
+{
+    return iterator(static_cast<NodeType*>(this->leftmost_), this);
+}
+
+/**
+* Returns an iterator whose value means INVALID
+*/
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::iterator
+ThreadedAVLTree<Key, Value>::end() const
+{
+    return iterator(NULL, this);
+}
+
+/**
+* Returns an iterator to the item with the given key, k
+* or the end iterator if k does not exist in the tree
+*/
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::iterator
+ThreadedAVLTree<Key, Value>::find(const Key& key) const
+{
+    return iterator(static_cast<NodeType*>(this->internalFind(key)), this);
+}
+
+/*
+ * Hinted insert, see BinarySearchTree::insert(iterator, pair).
+ */
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::iterator
+ThreadedAVLTree<Key, Value>::insert(iterator hint, const std::pair<const Key, Value> &new_item)
+{
+    return threadedAt(AVLTree<Key, Value>::insert(this->iteratorAt(hint.current_), new_item));
+}
+
+/**
+* Removes the item at pos, returns the item after it.
+*/
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::iterator
+ThreadedAVLTree<Key, Value>::erase(iterator pos)
+{
+    NodeType* next = pos.current_->getNext();
+    removeNode(pos.current_);
+    return iterator(next, this);
+}
+
+/**
+* Removes every item in [first, last), returns last.
+*/
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::iterator
+ThreadedAVLTree<Key, Value>::erase(iterator first, iterator last)
+{
+    AVLTree<Key, Value>::erase(this->iteratorAt(first.current_), this->iteratorAt(last.current_));
+    return last;
+}
+
+/**
+* Splits as AVLTree::split does, then cuts the thread at the seam.
+*/
+template<class Key, class Value>
+void ThreadedAVLTree<Key, Value>::split(const Key& key, ThreadedAVLTree<Key, Value>& rest)
+{
+    AVLTree<Key, Value>::split(key, rest);
+    if(this->rightmost_ != NULL){
+      static_cast<NodeType*>(this->rightmost_)->setNext(NULL);
+    }
+    if(rest.leftmost_ != NULL){
+      static_cast<NodeType*>(rest.leftmost_)->setPrev(NULL);
+    }
+}
+
+/**
+* Joins as AVLTree::join does, threading the two sequences together.
+*/
+template<class Key, class Value>
+void ThreadedAVLTree<Key, Value>::join(ThreadedAVLTree<Key, Value>& other)
+{
+    if(&other != this && this->root_ != NULL && other.root_ != NULL){
+      NodeType* low;
+      NodeType* high;
+      if(other.rightmost_->getKey() < this->leftmost_->getKey()){
+        low = static_cast<NodeType*>(other.rightmost_);
+        high = static_cast<NodeType*>(this->leftmost_);
+      }
+      else {
+        low = static_cast<NodeType*>(this->rightmost_);
+        high = static_cast<NodeType*>(other.leftmost_);
+      }
+      low->setNext(high);
+      high->setPrev(low);
+    }
+    AVLTree<Key, Value>::join(other);
+}
+
+// HELPER: convert a base iterator into a threaded one
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::iterator
+ThreadedAVLTree<Key, Value>::threadedAt(typename BinarySearchTree<Key, Value>::iterator it) const
+{
+    return iterator(static_cast<NodeType*>(BinarySearchTree<Key, Value>::nodeAt(it)), this);
+}
+
+/**
+* Allocates a node and threads it in. A new node is always a leaf, so its
+* neighbours are its parent and the parent's thread on the same side.
+*/
+template<class Key, class Value>
+typename ThreadedAVLTree<Key, Value>::NodeType*
+ThreadedAVLTree<Key, Value>::createNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    NodeType* n = new NodeType(key, value, static_cast<AVLNode<Key, Value>*>(parent));
+    NodeType* p = static_cast<NodeType*>(parent);
+    if(p == NULL){
+      return n;
+    }
+
+    NodeType* prev;
+    NodeType* next;
+    if(key < p->getKey()){
+      prev = p->getPrev();
+      next = p;
+    }
+    else {
+      prev = p;
+      next = p->getNext();
+    }
+    n->setPrev(prev);
+    n->setNext(next);
+    if(prev != NULL){
+      prev->setNext(n);
+    }
+    if(next != NULL){
+      next->setPrev(n);
+    }
+    return n;
+}
+
+template<class Key, class Value>
+size_t ThreadedAVLTree<Key, Value>::nodeSize() const
+{
+    return sizeof(NodeType);
+}
+
+/*
+ * Unthreads the node, then removes it as usual.
+ */
+template<class Key, class Value>
+void ThreadedAVLTree<Key, Value>::removeNode(Node<Key, Value>* node)
+{
+    NodeType* n = static_cast<NodeType*>(node);
+    if(n->getPrev() != NULL){
+      n->getPrev()->setNext(n->getNext());
+    }
+    if(n->getNext() != NULL){
+      n->getNext()->setPrev(n->getPrev());
+    }
+    AVLTree<Key, Value>::removeNode(node);
+}
+
+/*
+ * Cuts [first, last) out of the thread in one step, then removes the
+ * range as usual.
+ */
+template<class Key, class Value>
+void ThreadedAVLTree<Key, Value>::removeRange(Node<Key, Value>* first, Node<Key, Value>* last)
+{
+    NodeType* prev = static_cast<NodeType*>(first)->getPrev();
+    NodeType* next = static_cast<NodeType*>(last);
+    if(prev != NULL){
+      prev->setNext(next);
+    }
+    if(next != NULL){
+      next->setPrev(prev);
+    }
+    AVLTree<Key, Value>::removeRange(first, last);
+}
+
+/*
+---------------------------------------------------
+End implementations for the ThreadedAVLTree class.
+---------------------------------------------------
+*/
+
+#endif
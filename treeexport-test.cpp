@@ -0,0 +1,66 @@
+#include <iostream>
+#include <string>
+#include <limits>
+#include <cstdint>
+#include "bst.h"
+#include "avlbst.h"
+#include "treeexport.h"
+
+using namespace std;
+
+
+int main(int argc, char *argv[])
+{
+    // Export tests: a small AVL tree in both formats, then samples
+    AVLTree<int,string> at;
+    for(int i = 1; i <= 10; i++) {
+        at.insert(std::make_pair(i * 10, string(i, 'x')));
+    }
+
+    ExportOptions annotated;
+    annotated.balances = true;
+    exportDot(cout, at, annotated);
+
+    annotated.values = true;
+    exportJson(cout, at, annotated);
+
+    // the top two levels only, then the first four nodes of the left subtree
+    ExportOptions sample;
+    sample.maxDepth = 1;
+    exportJson(cout, at, sample);
+    sample.maxDepth = -1;
+    sample.maxNodes = 4;
+    exportJson(cout, at.getRoot()->getLeft(), sample);
+
+    // an empty tree
+    BinarySearchTree<string,int> bt;
+    exportJson(cout, bt);
+    bt.insert(std::make_pair(string("say \"hi\""), 1));
+    exportDot(cout, bt);
+
+    // byte-sized numbers, and doubles JSON has no number for
+    AVLTree<uint8_t,double> nt;
+    nt.insert(std::make_pair((uint8_t)7, 0.5));
+    nt.insert(std::make_pair((uint8_t)3, std::numeric_limits<double>::quiet_NaN()));
+    nt.insert(std::make_pair((uint8_t)200, -std::numeric_limits<double>::infinity()));
+    ExportOptions withValues;
+    withValues.values = true;
+    exportJson(cout, nt, withValues);
+
+    // hang the root back under its own leftmost leaf, as its parent too:
+    // written as a broken link, not walked round the cycle
+    AVLNode<int,string>* root = const_cast<AVLNode<int,string>*>(static_cast<const AVLNode<int,string>*>(at.getRoot()));
+    AVLNode<int,string>* leaf = root;
+    while(leaf->getLeft() != NULL) {
+        leaf = leaf->getLeft();
+    }
+    root->setParent(leaf);
+    leaf->setLeft(root);
+    exportJson(cout, at);
+    exportDot(cout, at);
+    exportJson(cout, root->getLeft());
+    leaf->setLeft(NULL);
+    root->setParent(NULL);
+
+    return 0;
+}
@@ -0,0 +1,625 @@
+#ifndef TREEEXPORT_H
+#define TREEEXPORT_H
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+#include "bst.h"
+#include "avlbst.h"
+
+/**
+* What exportDot()/exportJson() write. The defaults write the whole
+* tree, keys only.
+*/
+struct ExportOptions
+{
+    ExportOptions();
+
+    // deepest level written, the starting node being level 0; -1 for no limit
+    int maxDepth;
+    // nodes written at most, in preorder; 0 for no limit
+    size_t maxNodes;
+    // write each node's value next to its key
+    bool values;
+    // write AVLNode balance factors; ignored for trees of other nodes
+    bool balances;
+};
+
+/**
+* Defaults: no limits, keys only.
+*/
+inline ExportOptions::ExportOptions() :
+    maxDepth(-1), maxNodes(0), values(false), balances(false)
+{
+
+}
+
+/**
+* Streams a tree, or the subtree under any of its nodes, to an ostream as
+* Graphviz DOT or as JSON, for trees far beyond what print() can show.
+*
+* The walk follows parent pointers instead of keeping a stack, so it
+* takes O(n) time for n nodes written and O(1) extra memory, whatever the
+* height of the tree. Children below maxDepth, or beyond the maxNodes
+* budget, are written as truncated placeholders, so a sample still shows
+* where the tree goes on. A child whose parent pointer does not lead back
+* is written as a broken link and not entered, and so is a child that is
+* the node the walk started from; a whole tree whose root has a parent is
+* written as a single broken link. Every node is then entered at most
+* once, and a corrupted tree cannot make the walk loop. Keys and values
+* are written with operator<<; in JSON, numbers stay numbers (NaN and
+* infinities become null) and everything else becomes a string.
+*
+* JSON nodes look like
+*   {"key": 5, "value": 1, "balance": -1, "left": {...}, "right": null}
+* with "value"/"balance" only when asked for, and {"truncated": true} or
+* {"brokenLink": true} in place of children that were not written.
+*/
+template <typename Key, typename Value>
+class TreeExporter
+{
+public:
+    typedef Node<Key, Value> NodeType;
+
+    static void writeDot(std::ostream& os, const NodeType* root, const ExportOptions& options = ExportOptions());
+    static void writeJson(std::ostream& os, const NodeType* root, const ExportOptions& options = ExportOptions());
+    static void writeDot(std::ostream& os, const BinarySearchTree<Key, Value>& tree,
+                         const ExportOptions& options = ExportOptions());
+    static void writeJson(std::ostream& os, const BinarySearchTree<Key, Value>& tree,
+                          const ExportOptions& options = ExportOptions());
+
+private:
+    // what becomes of a child slot
+    enum Slot { EMPTY, ENTER, TRUNCATED, BROKEN };
+
+    class DotFormat
+    {
+    public:
+        DotFormat(std::ostream& os, const ExportOptions& options, bool avl);
+        void begin();
+        void node(const NodeType* n);
+        void slot(const NodeType* parent, const NodeType* child, bool left, Slot slot);
+        void endNode(const NodeType* n);
+        void brokenRoot(const NodeType* root);
+        void end();
+
+    private:
+        std::ostream& os_;
+        const ExportOptions& options_;
+        bool avl_;
+    };
+
+    class JsonFormat
+    {
+    public:
+        JsonFormat(std::ostream& os, const ExportOptions& options, bool avl);
+        void begin();
+        void node(const NodeType* n);
+        void slot(const NodeType* parent, const NodeType* child, bool left, Slot slot);
+        void endNode(const NodeType* n);
+        void brokenRoot(const NodeType* root);
+        void end();
+
+    private:
+        std::ostream& os_;
+        const ExportOptions& options_;
+        bool avl_;
+    };
+
+    template <class Format>
+    static void walk(const NodeType* root, const ExportOptions& options, Format& format);
+    static Slot slotOf(const NodeType* root, const NodeType* parent, const NodeType* child, int depth,
+                       size_t written, const ExportOptions& options);
+    static bool isAVL(const NodeType* root);
+};
+
+// HELPER: operator<< output of any key or value, as a string
+template <typename T>
+std::string exportText(const T& item)
+{
+    std::ostringstream text;
+    text << item;
+    return text.str();
+}
+
+// HELPER: writes text between double quotes, escaped for DOT and JSON
+inline void exportQuoted(std::ostream& os, const std::string& text)
+{
+    static const char hex[] = "0123456789abcdef";
+    os << '"';
+    for(size_t i = 0; i < text.size(); i++){
+      unsigned char c = text[i];
+      if(c == '"' || c == '\\'){
+        os << '\\' << c;
+      }
+      else if(c == '\n'){
+        os << "\\n";
+      }
+      else if(c < 0x20){
+        os << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+      }
+      else {
+        os << c;
+      }
+    }
+    os << '"';
+}
+
+// HELPER: JSON numbers; the char types are written as the small integers
+// they hold, and NaN and the infinities, which JSON has no number for, as
+// null
+template <typename T>
+void exportJsonNumber(std::ostream& os, const T& item)
+{
+    os << item;
+}
+
+inline void exportJsonNumber(std::ostream& os, char item)
+{
+    os << static_cast<int>(item);
+}
+
+inline void exportJsonNumber(std::ostream& os, signed char item)
+{
+    os << static_cast<int>(item);
+}
+
+inline void exportJsonNumber(std::ostream& os, unsigned char item)
+{
+    os << static_cast<int>(item);
+}
+
+inline void exportJsonNumber(std::ostream& os, float item)
+{
+    if(std::isfinite(item)){
+      os << item;
+    }
+    else {
+      os << "null";
+    }
+}
+
+inline void exportJsonNumber(std::ostream& os, double item)
+{
+    if(std::isfinite(item)){
+      os << item;
+    }
+    else {
+      os << "null";
+    }
+}
+
+inline void exportJsonNumber(std::ostream& os, long double item)
+{
+    if(std::isfinite(item)){
+      os << item;
+    }
+    else {
+      os << "null";
+    }
+}
+
+// HELPER: JSON scalars; numbers are written as numbers, booleans as
+// true/false, anything else as a string
+template <typename T>
+void exportJsonScalar(std::ostream& os, const T& item, std::true_type)
+{
+    exportJsonNumber(os, item);
+}
+
+template <typename T>
+void exportJsonScalar(std::ostream& os, const T& item, std::false_type)
+{
+    exportQuoted(os, exportText(item));
+}
+
+inline void exportJsonScalar(std::ostream& os, const bool& item, std::true_type)
+{
+    os << (item ? "true" : "false");
+}
+
+template <typename T>
+void exportJsonScalar(std::ostream& os, const T& item)
+{
+    exportJsonScalar(os, item, std::integral_constant<bool, std::is_arithmetic<T>::value>());
+}
+
+/*
+  ------------------------------------------------
+  Begin implementations for the TreeExporter class.
+  ------------------------------------------------
+*/
+
+/**
+* Writes the subtree at root as a DOT digraph. Left edges leave from the
+* bottom-left of a node and right edges from the bottom-right, so dot
+* keeps the children in order.
+*/
+template<typename Key, typename Value>
+void TreeExporter<Key, Value>::writeDot(std::ostream& os, const NodeType* root, const ExportOptions& options)
+{
+    DotFormat format(os, options, options.balances && isAVL(root));
+    format.begin();
+    walk(root, options, format);
+    format.end();
+}
+
+/**
+* Writes the subtree at root as one JSON value: null for an empty tree,
+* otherwise nested node objects, one node per line.
+*/
+template<typename Key, typename Value>
+void TreeExporter<Key, Value>::writeJson(std::ostream& os, const NodeType* root, const ExportOptions& options)
+{
+    JsonFormat format(os, options, options.balances && isAVL(root));
+    format.begin();
+    if(root == NULL){
+      os << "null";
+    }
+    walk(root, options, format);
+    format.end();
+}
+
+/**
+* Writes tree as a DOT digraph, unless its root has a parent.
+*/
+template<typename Key, typename Value>
+void TreeExporter<Key, Value>::writeDot(std::ostream& os, const BinarySearchTree<Key, Value>& tree,
+                                        const ExportOptions& options)
+{
+    const NodeType* root = tree.getRoot();
+    if(root != NULL && root->getParent() != NULL){
+      // the parent may be a node below the root that hangs it back into
+      // its own subtree, so nothing under it is written
+      DotFormat format(os, options, false);
+      format.begin();
+      format.brokenRoot(root);
+      format.end();
+      return;
+    }
+    writeDot(os, root, options);
+}
+
+/**
+* Writes tree as JSON, unless its root has a parent.
+*/
+template<typename Key, typename Value>
+void TreeExporter<Key, Value>::writeJson(std::ostream& os, const BinarySearchTree<Key, Value>& tree,
+                                         const ExportOptions& options)
+{
+    const NodeType* root = tree.getRoot();
+    if(root != NULL && root->getParent() != NULL){
+      // as for writeDot()
+      JsonFormat format(os, options, false);
+      format.begin();
+      format.brokenRoot(root);
+      format.end();
+      return;
+    }
+    writeJson(os, root, options);
+}
+
+/**
+* Preorder walk of the subtree at root that climbs back up through the
+* parent pointers, so it needs no stack. Each node is announced, then its
+* left and right slots, then its end, which is the order both formats
+* nest in.
+*/
+template<typename Key, typename Value>
+template<class Format>
+void TreeExporter<Key, Value>::walk(const NodeType* root, const ExportOptions& options, Format& format)
+{
+    if(root == NULL){
+      return;
+    }
+    const NodeType* n = root;
+    int depth = 0;
+    size_t written = 0;
+    // 0: arrived from the parent, 1: back from the left child, 2: back
+    // from the right child
+    int stage = 0;
+
+    while(true){
+      if(stage == 0){
+        format.node(n);
+        written++;
+        Slot s = slotOf(root, n, n->getLeft(), depth, written, options);
+        format.slot(n, n->getLeft(), true, s);
+        if(s == ENTER){
+          n = n->getLeft();
+          depth++;
+          continue;
+        }
+        stage = 1;
+      }
+      if(stage == 1){
+        Slot s = slotOf(root, n, n->getRight(), depth, written, options);
+        format.slot(n, n->getRight(), false, s);
+        if(s == ENTER){
+          n = n->getRight();
+          depth++;
+          stage = 0;
+          continue;
+        }
+      }
+      format.endNode(n);
+      if(n == root){
+        return;
+      }
+      const NodeType* parent = n->getParent();
+      stage = (parent->getLeft() == n) ? 1 : 2;
+      n = parent;
+      depth--;
+    }
+}
+
+// HELPER: decides whether the child of parent (at depth) is written, in
+// a walk that started from root
+template<typename Key, typename Value>
+typename TreeExporter<Key, Value>::Slot
+TreeExporter<Key, Value>::slotOf(const NodeType* root, const NodeType* parent, const NodeType* child, int depth,
+                                 size_t written, const ExportOptions& options)
+{
+    if(child == NULL){
+      return EMPTY;
+    }
+    if(child->getParent() != parent || parent->getLeft() == parent->getRight() || child == root){
+      return BROKEN;
+    }
+    if((options.maxDepth >= 0 && depth >= options.maxDepth) ||
+       (options.maxNodes != 0 && written >= options.maxNodes)){
+      return TRUNCATED;
+    }
+    return ENTER;
+}
+
+// HELPER: every node of a tree is allocated by the same createNode, so
+// the root tells whether there are balances to write
+template<typename Key, typename Value>
+bool TreeExporter<Key, Value>::isAVL(const NodeType* root)
+{
+    return dynamic_cast<const AVLNode<Key, Value>*>(root) != NULL;
+}
+
+/*
+  ----------------------------------------------
+  End implementations for the TreeExporter class.
+  ----------------------------------------------
+*/
+
+/*
+  ----------------------------------------------------------
+  Begin implementations for the TreeExporter::DotFormat class.
+  ----------------------------------------------------------
+*/
+
+/**
+* Writes to os; avl says whether balances are written.
+*/
+template<typename Key, typename Value>
+TreeExporter<Key, Value>::DotFormat::DotFormat(std::ostream& os, const ExportOptions& options, bool avl) :
+    os_(os), options_(options), avl_(avl)
+{
+
+}
+
+/**
+* Opens the graph.
+*/
+template<typename Key, typename Value>
+void TreeExporter<Key, Value>::DotFormat::begin()
+{
+    os_ << "digraph BST {\n";
+    os_ << "  node [shape=ellipse];\n";
+}
+
+/**
+* One DOT node per tree node, named after its address.
+*/
+template<typename Key, typename Value>
+void TreeExporter<Key, Value>::DotFormat::node(const NodeType* n)
+{
+    std::string label = exportText(n->getKey());
+    if(options_.values){
+      label += ": " + exportText(n->getValue());
+    }
+    if(avl_){
+      label += "\n" + exportText((int)static_cast<const AVLNode<Key, Value>*>(n)->getBalance());
+    }
+    os_ << "  n" << (const void*)n << " [label=";
+    exportQuoted(os_, label);
+    os_ << "];\n";
+}
+
+/**
+* The edge to a child; placeholders for children that are not written.
+*/
+template<typename Key, typename Value>
+void TreeExporter<Key, Value>::DotFormat::slot(const NodeType* parent, const NodeType* child, bool left, Slot slot)
+{
+    const char* port = left ? "sw" : "se";
+    if(slot == ENTER){
+      os_ << "  n" << (const void*)parent << " -> n" << (const void*)child
+          << " [tailport=" << port << "];\n";
+    }
+    else if(slot != EMPTY){
+      const char* side = left ? "L" : "R";
+      os_ << "  t" << (const void*)parent << side << " [shape=plaintext, label="
+          << (slot == TRUNCATED ? "\"...\"" : "\"broken link\", fontcolor=red") << "];\n";
+      os_ << "  n" << (const void*)parent << " -> t" << (const void*)parent << side
+          << " [tailport=" << port << ", style=dashed];\n";
+    }
+}
+
+/**
+* Nothing to close in DOT.
+*/
+template<typename Key, typename Value>
+void TreeExporter<Key, Value>::DotFormat::endNode(const NodeType* n)
+{
+
+}
+
+/**
+* A red placeholder in place of a root that has a parent.
+*/
+template<typename Key, typename Value>
+void TreeExporter<Key, Value>::DotFormat::brokenRoot(const NodeType* root)
+{
+    os_ << "  t" << (const void*)root << " [shape=plaintext, label=\"broken link\", fontcolor=red];\n";
+}
+
+/**
+* Closes the graph. Lines are only flushed here, once, so writing a large
+* tree costs no more than the stream's own buffering.
+*/
+template<typename Key, typename Value>
+void TreeExporter<Key, Value>::DotFormat::end()
+{
+    os_ << "}\n";
+    os_.flush();
+}
+
+/*
+  --------------------------------------------------------
+  End implementations for the TreeExporter::DotFormat class.
+  --------------------------------------------------------
+*/
+
+/*
+  -----------------------------------------------------------
+  Begin implementations for the TreeExporter::JsonFormat class.
+  -----------------------------------------------------------
+*/
+
+/**
+* Writes to os; avl says whether balances are written.
+*/
+template<typename Key, typename Value>
+TreeExporter<Key, Value>::JsonFormat::JsonFormat(std::ostream& os, const ExportOptions& options, bool avl) :
+    os_(os), options_(options), avl_(avl)
+{
+
+}
+
+/**
+* Nothing comes before the root object.
+*/
+template<typename Key, typename Value>
+void TreeExporter<Key, Value>::JsonFormat::begin()
+{
+
+}
+
+/**
+* Opens a node object with its key, and value and balance if asked for.
+*/
+template<typename Key, typename Value>
+void TreeExporter<Key, Value>::JsonFormat::node(const NodeType* n)
+{
+    os_ << "\n{\"key\": ";
+    exportJsonScalar(os_, n->getKey());
+    if(options_.values){
+      os_ << ", \"value\": ";
+      exportJsonScalar(os_, n->getValue());
+    }
+    if(avl_){
+      os_ << ", \"balance\": " << (int)static_cast<const AVLNode<Key, Value>*>(n)->getBalance();
+    }
+}
+
+/**
+* Names the child slot; an entered child follows as the next node.
+*/
+template<typename Key, typename Value>
+void TreeExporter<Key, Value>::JsonFormat::slot(const NodeType* parent, const NodeType* child, bool left, Slot slot)
+{
+    os_ << (left ? ", \"left\": " : ", \"right\": ");
+    if(slot == EMPTY){
+      os_ << "null";
+    }
+    else if(slot == TRUNCATED){
+      os_ << "{\"truncated\": true}";
+    }
+    else if(slot == BROKEN){
+      os_ << "{\"brokenLink\": true}";
+    }
+}
+
+/**
+* Closes a node object.
+*/
+template<typename Key, typename Value>
+void TreeExporter<Key, Value>::JsonFormat::endNode(const NodeType* n)
+{
+    os_ << "}";
+}
+
+/**
+* A broken link in place of a root that has a parent.
+*/
+template<typename Key, typename Value>
+void TreeExporter<Key, Value>::JsonFormat::brokenRoot(const NodeType* root)
+{
+    os_ << "{\"brokenLink\": true}";
+}
+
+/**
+* Ends the document with a newline and flushes it, once for the whole
+* tree.
+*/
+template<typename Key, typename Value>
+void TreeExporter<Key, Value>::JsonFormat::end()
+{
+    os_ << "\n";
+    os_.flush();
+}
+
+/*
+  ---------------------------------------------------------
+  End implementations for the TreeExporter::JsonFormat class.
+  ---------------------------------------------------------
+*/
+
+/**
+* Writes the whole tree as DOT.
+*/
+template <typename Key, typename Value>
+void exportDot(std::ostream& os, const BinarySearchTree<Key, Value>& tree, const ExportOptions& options = ExportOptions())
+{
+    TreeExporter<Key, Value>::writeDot(os, tree, options);
+}
+
+/**
+* Writes the subtree under node as DOT.
+*/
+template <typename Key, typename Value>
+void exportDot(std::ostream& os, const Node<Key, Value>* node, const ExportOptions& options = ExportOptions())
+{
+    TreeExporter<Key, Value>::writeDot(os, node, options);
+}
+
+/**
+* Writes the whole tree as JSON.
+*/
+template <typename Key, typename Value>
+void exportJson(std::ostream& os, const BinarySearchTree<Key, Value>& tree, const ExportOptions& options = ExportOptions())
+{
+    TreeExporter<Key, Value>::writeJson(os, tree, options);
+}
+
+/**
+* Writes the subtree under node as JSON.
+*/
+template <typename Key, typename Value>
+void exportJson(std::ostream& os, const Node<Key, Value>* node, const ExportOptions& options = ExportOptions())
+{
+    TreeExporter<Key, Value>::writeJson(os, node, options);
+}
+
+#endif
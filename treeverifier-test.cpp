@@ -0,0 +1,79 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "bst.h"
+#include "avlbst.h"
+#include "treeverifier.h"
+
+using namespace std;
+
+// a periodic health check, as run from a monitoring thread
+static void checkBalance(const BinarySearchTree<int,int>* tree, bool* balanced)
+{
+    *balanced = tree->isBalanced();
+}
+
+int main(int argc, char *argv[])
+{
+    // Verifier tests: healthy trees, then one deliberately broken link
+    BinarySearchTree<int,int> bt;
+    AVLTree<int,int> at;
+    for(int i = 0; i < 200; i++) {
+        int key = (i * 37) % 200;
+        bt.insert(std::make_pair(key, i));
+        at.insert(std::make_pair(key, i));
+    }
+
+    VerifyReport<int,int> bstReport = verifyTree(bt, 2, 200);
+    cout << "BinarySearchTree:" << endl;
+    bstReport.print(cout);
+    VerifyReport<int,int> avlReport = verifyTree(at, 4, 200);
+    cout << "AVLTree:" << endl;
+    avlReport.print(cout);
+
+    // point a child's parent link elsewhere and break a balance factor
+    AVLNode<int,int>* root = const_cast<AVLNode<int,int>*>(static_cast<const AVLNode<int,int>*>(at.getRoot()));
+    AVLNode<int,int>* child = root->getLeft();
+    int8_t balance = root->getRight()->getBalance();
+    child->setParent(NULL);
+    root->getRight()->setBalance(balance + 2);
+    VerifyReport<int,int> broken = verifyTree(at, 1, 200);
+    cout << "Broken AVLTree, ok " << broken.ok() << ":" << endl;
+    broken.print(cout);
+    child->setParent(root);
+    root->getRight()->setBalance(balance);
+    cout << "Repaired AVLTree, ok " << verifyTree(at).ok() << endl;
+
+    // hang the root back under its own leftmost leaf, as its parent too:
+    // reported, not walked round the cycle
+    AVLNode<int,int>* leaf = root;
+    while(leaf->getLeft() != NULL) {
+        leaf = leaf->getLeft();
+    }
+    root->setParent(leaf);
+    leaf->setLeft(root);
+    VerifyReport<int,int> cycle = verifyTree(at, 1, 200);
+    cout << "Root on a cycle, ok " << cycle.ok() << ", with 4 threads ok " << verifyTree(at, 4, 200).ok() << ":" << endl;
+    cycle.print(cout);
+    leaf->setLeft(NULL);
+    root->setParent(NULL);
+    cout << "Repaired AVLTree, ok " << verifyTree(at).ok() << endl;
+
+    // concurrent checks on a tree whose appended spine is not settled yet
+    BinarySearchTree<int,int> appended;
+    for(int i = 0; i < 1000; i++) {
+        appended.insert(std::make_pair(i, i));
+    }
+    bool balanced[4];
+    vector<thread> checkers;
+    for(int t = 0; t < 4; t++) {
+        checkers.push_back(thread(checkBalance, &appended, &balanced[t]));
+    }
+    for(int t = 0; t < 4; t++) {
+        checkers[t].join();
+    }
+    cout << "Appended BST from 4 threads: balanced " << balanced[0] << balanced[1] << balanced[2] << balanced[3]
+         << ", verified ok " << verifyTree(appended, 2, 1000).ok() << endl;
+
+    return 0;
+}
@@ -0,0 +1,439 @@
+#ifndef TREEVERIFIER_H
+#define TREEVERIFIER_H
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+#include "bst.h"
+#include "avlbst.h"
+#include "treewalk.h"
+
+// Errors kept in a report; all of them are counted
+#define VERIFY_MAX_ERRORS 64
+// Pass as expectedNodes when the caller does not track the tree's size
+#define VERIFY_UNKNOWN_COUNT ((size_t)-1)
+
+/**
+* What a VerifyError found wrong.
+*/
+enum VerifyErrorKind
+{
+    // a key not strictly between the bounds its ancestors set
+    VERIFY_ORDER,
+    // a child whose parent pointer is not the node it hangs from
+    VERIFY_PARENT,
+    // an AVL balance factor that is not the real height difference, or
+    // a real height difference beyond one
+    VERIFY_BALANCE,
+    // a plain BST node whose stored height or imbalance flag is stale
+    VERIFY_HEIGHT,
+    // a node count that does not match the one the caller expected
+    VERIFY_COUNT,
+    // cached min()/max() that are not the leftmost/rightmost nodes
+    VERIFY_EXTREMES,
+    VERIFY_ERROR_KINDS
+};
+
+/**
+* One broken invariant. node is the offending node (NULL for tree-wide
+* errors) and other the node it was checked against: the ancestor whose
+* key bounds it for VERIFY_ORDER, the node it hangs from for
+* VERIFY_PARENT (NULL for a root with a parent). expected and found hold
+* the numbers that disagree. The pointers are only valid while the tree
+* is unchanged.
+*/
+template <typename Key, typename Value>
+struct VerifyError
+{
+    VerifyErrorKind kind;
+    const Node<Key, Value>* node;
+    const Node<Key, Value>* other;
+    int depth;
+    long long expected;
+    long long found;
+};
+
+/**
+* Everything verifyTree() found. A healthy tree has ok() == true; the
+* other fields say how much of the tree was checked.
+*/
+template <typename Key, typename Value>
+struct VerifyReport
+{
+    VerifyReport();
+
+    bool ok() const;
+    void print(std::ostream& os) const;
+    void merge(const VerifyReport<Key, Value>& other);
+    void add(VerifyErrorKind kind, const Node<Key, Value>* node, const Node<Key, Value>* other,
+             int depth, long long expected, long long found);
+
+    // nodes reached from the root; subtrees under a broken parent link
+    // are not entered
+    size_t nodes;
+    // -1 if a broken link left part of the tree unmeasured
+    int height;
+    size_t errorCount;
+    size_t kindCounts[VERIFY_ERROR_KINDS];
+    // the first VERIFY_MAX_ERRORS errors found
+    std::vector<VerifyError<Key, Value> > errors;
+};
+
+/*
+  ------------------------------------------------
+  Begin implementations for the VerifyReport class.
+  ------------------------------------------------
+*/
+
+/**
+* Default constructor, the report of an empty, healthy tree.
+*/
+template<typename Key, typename Value>
+VerifyReport<Key, Value>::VerifyReport() :
+    nodes(0), height(0), errorCount(0)
+{
+    for(int k = 0; k < VERIFY_ERROR_KINDS; k++){
+      kindCounts[k] = 0;
+    }
+}
+
+/**
+* True if no invariant is broken.
+*/
+template<typename Key, typename Value>
+bool VerifyReport<Key, Value>::ok() const
+{
+    return errorCount == 0;
+}
+
+/**
+* Prints the summary and one line per kept error.
+*/
+template<typename Key, typename Value>
+void VerifyReport<Key, Value>::print(std::ostream& os) const
+{
+    os << "nodes " << nodes << ", height " << height << ", errors " << errorCount << std::endl;
+    for(size_t i = 0; i < errors.size(); i++){
+      const VerifyError<Key, Value>& e = errors[i];
+      os << "  ";
+      switch(e.kind){
+        case VERIFY_ORDER:
+          os << "order: key " << e.node->getKey() << " at depth " << e.depth
+             << " is on the wrong side of ancestor " << e.other->getKey();
+          break;
+        case VERIFY_PARENT:
+          if(e.other == NULL){
+            os << "parent: root key " << e.node->getKey() << " has a parent";
+          }
+          else {
+            os << "parent: key " << e.node->getKey() << " at depth " << e.depth
+               << " does not point back to " << e.other->getKey();
+          }
+          break;
+        case VERIFY_BALANCE:
+          os << "balance: key " << e.node->getKey() << " at depth " << e.depth
+             << " has subtree heights differing by " << e.expected << ", balance " << e.found;
+          break;
+        case VERIFY_HEIGHT:
+          os << "height: key " << e.node->getKey() << " at depth " << e.depth
+             << " should have height " << e.expected << ", stores " << e.found;
+          break;
+        case VERIFY_COUNT:
+          os << "count: expected " << e.expected << " nodes, found " << e.found;
+          break;
+        default:
+          os << (e.found == 0 ? "extremes: min()" : "extremes: max()")
+             << " is not the " << (e.found == 0 ? "leftmost" : "rightmost") << " node";
+          break;
+      }
+      os << std::endl;
+    }
+}
+
+/**
+* Adds the counts and errors of other, which covers a disjoint set of
+* nodes. Heights are settled by the caller.
+*/
+template<typename Key, typename Value>
+void VerifyReport<Key, Value>::merge(const VerifyReport<Key, Value>& other)
+{
+    nodes += other.nodes;
+    errorCount += other.errorCount;
+    for(int k = 0; k < VERIFY_ERROR_KINDS; k++){
+      kindCounts[k] += other.kindCounts[k];
+    }
+    for(size_t i = 0; i < other.errors.size() && errors.size() < VERIFY_MAX_ERRORS; i++){
+      errors.push_back(other.errors[i]);
+    }
+}
+
+/**
+* Records one error, keeping it if there is still room.
+*/
+template<typename Key, typename Value>
+void VerifyReport<Key, Value>::add(VerifyErrorKind kind, const Node<Key, Value>* node, const Node<Key, Value>* other,
+                                   int depth, long long expected, long long found)
+{
+    errorCount++;
+    kindCounts[kind]++;
+    if(errors.size() < VERIFY_MAX_ERRORS){
+      VerifyError<Key, Value> e = { kind, node, other, depth, expected, found };
+      errors.push_back(e);
+    }
+}
+
+/*
+  ----------------------------------------------
+  End implementations for the VerifyReport class.
+  ----------------------------------------------
+*/
+
+/**
+* Checks the structural invariants of a BinarySearchTree or any tree
+* derived from it, for debug and canary builds that cannot afford to
+* assert on a live tree:
+*   - every key lies strictly between the keys of the ancestors that
+*     bound it;
+*   - every child points back to the node it hangs from, and the root
+*     has no parent;
+*   - AVL nodes store the real height difference, which is at most one;
+*     plain BST nodes store their real height and imbalance flag;
+*   - the cached min()/max() are the leftmost/rightmost nodes, and the
+*     node count is the expected one, when the caller knows it.
+*
+* The walk is a ParallelTreeWalk, like ShapeAnalyzer's: keys and links
+* are checked on the way down, heights and balances on the way up. A
+* child with a broken parent link is reported and not entered, and so is
+* a root with a parent, so every node is entered at most once, from the
+* one node its parent pointer names, and a corrupted tree cannot make
+* the walk loop. The tree must not change while it is verified.
+*/
+template <typename Key, typename Value>
+class TreeVerifier
+{
+public:
+    // threads == 0 uses one thread per core
+    static VerifyReport<Key, Value> run(const BinarySearchTree<Key, Value>& tree, unsigned threads = 0,
+                                        size_t expectedNodes = VERIFY_UNKNOWN_COUNT);
+
+private:
+    friend class ParallelTreeWalk<TreeVerifier<Key, Value> >;
+
+    typedef Node<Key, Value> NodeType;
+    typedef VerifyReport<Key, Value> Report;
+
+    // what the nodes of the tree store about their subtrees
+    enum NodeKind { PLAIN, BST_HEIGHTS, AVL_BALANCE };
+
+    // the ancestors whose keys bound a node's, NULL if unbounded
+    struct Context
+    {
+        const NodeType* lo;
+        const NodeType* hi;
+    };
+
+    TreeVerifier(const NodeType* root, NodeKind kind);
+
+    static NodeKind kindOf(const NodeType* root);
+    const NodeType* left(const NodeType* n) const;
+    const NodeType* right(const NodeType* n) const;
+    void down(const NodeType* n, const Context& context, int depth, VerifyReport<Key, Value>& report,
+              bool& enterLeft, bool& enterRight) const;
+    Context childContext(const NodeType* n, const Context& context, bool right) const;
+    int up(const NodeType* n, int depth, int leftHeight, int rightHeight, VerifyReport<Key, Value>& report) const;
+    static void checkExtremes(const BinarySearchTree<Key, Value>& tree, VerifyReport<Key, Value>& report);
+
+    const NodeType* root_;
+    NodeKind kind_;
+};
+
+/*
+  ------------------------------------------------
+  Begin implementations for the TreeVerifier class.
+  ------------------------------------------------
+*/
+
+/**
+* Verifies tree with up to threads threads. expectedNodes, if known, is
+* compared with the number of nodes reached.
+*/
+template<typename Key, typename Value>
+VerifyReport<Key, Value> TreeVerifier<Key, Value>::run(const BinarySearchTree<Key, Value>& tree, unsigned threads,
+                                                       size_t expectedNodes)
+{
+    VerifyReport<Key, Value> report;
+    const NodeType* root = tree.getRoot();
+    if(root != NULL && root->getParent() != NULL){
+      // the parent may be a node below the root that hangs it back into
+      // its own subtree, so nothing under it is walked
+      report.add(VERIFY_PARENT, root, NULL, 0, 0, 0);
+      report.height = -1;
+      return report;
+    }
+    NodeKind kind = kindOf(root);
+    if(kind == BST_HEIGHTS){
+      // appends at the extremes defer their height updates until asked;
+      // isBalanced() settles them under the tree's lock before the
+      // workers read any height
+      tree.isBalanced();
+    }
+
+    Context unbounded = { NULL, NULL };
+    report.height = ParallelTreeWalk<TreeVerifier<Key, Value> >::run(TreeVerifier<Key, Value>(root, kind), root,
+                                                                      unbounded, threads, report);
+
+    if(expectedNodes != VERIFY_UNKNOWN_COUNT && expectedNodes != report.nodes){
+      report.add(VERIFY_COUNT, NULL, NULL, 0, (long long)expectedNodes, (long long)report.nodes);
+    }
+    checkExtremes(tree, report);
+    return report;
+}
+
+/**
+* A verifier for the tree under root, whose nodes are all of kind.
+*/
+template<typename Key, typename Value>
+TreeVerifier<Key, Value>::TreeVerifier(const NodeType* root, NodeKind kind) :
+    root_(root), kind_(kind)
+{
+
+}
+
+// HELPER: every node of a tree is allocated by the same createNode, so
+// the root tells what the nodes store
+template<typename Key, typename Value>
+typename TreeVerifier<Key, Value>::NodeKind TreeVerifier<Key, Value>::kindOf(const NodeType* root)
+{
+    if(dynamic_cast<const AVLNode<Key, Value>*>(root) != NULL){
+      return AVL_BALANCE;
+    }
+    if(dynamic_cast<const BSTNode<Key, Value>*>(root) != NULL){
+      return BST_HEIGHTS;
+    }
+    return PLAIN;
+}
+
+template<typename Key, typename Value>
+const typename TreeVerifier<Key, Value>::NodeType* TreeVerifier<Key, Value>::left(const NodeType* n) const
+{
+    return n->getLeft();
+}
+
+template<typename Key, typename Value>
+const typename TreeVerifier<Key, Value>::NodeType* TreeVerifier<Key, Value>::right(const NodeType* n) const
+{
+    return n->getRight();
+}
+
+// HELPER: checks made on the way down: n's key against the bounds set by
+// its ancestors, and its children's parent pointers. A child that does
+// not point back to n, or that is the root, is not entered.
+template<typename Key, typename Value>
+void TreeVerifier<Key, Value>::down(const NodeType* n, const Context& context, int depth,
+                                    VerifyReport<Key, Value>& report, bool& enterLeft, bool& enterRight) const
+{
+    report.nodes++;
+    if(context.lo != NULL && !(context.lo->getKey() < n->getKey())){
+      report.add(VERIFY_ORDER, n, context.lo, depth, 0, 0);
+    }
+    if(context.hi != NULL && !(n->getKey() < context.hi->getKey())){
+      report.add(VERIFY_ORDER, n, context.hi, depth, 0, 0);
+    }
+    const NodeType* l = n->getLeft();
+    const NodeType* r = n->getRight();
+    enterLeft = (l != NULL && l->getParent() == n && l != root_);
+    enterRight = (r != NULL && r->getParent() == n && r != l && r != root_);
+    if(l != NULL && !enterLeft){
+      report.add(VERIFY_PARENT, l, n, depth + 1, 0, 0);
+    }
+    if(r != NULL && !enterRight){
+      report.add(VERIFY_PARENT, r, n, depth + 1, 0, 0);
+    }
+}
+
+// HELPER: n bounds its left subtree from above and its right from below
+template<typename Key, typename Value>
+typename TreeVerifier<Key, Value>::Context TreeVerifier<Key, Value>::childContext(const NodeType* n,
+                                                                                  const Context& context,
+                                                                                  bool right) const
+{
+    Context bounds = { right ? n : context.lo, right ? context.hi : n };
+    return bounds;
+}
+
+// HELPER: checks made on the way up, once both subtree heights are known
+// (-1 if a subtree was not entered, which skips the checks). Returns the
+// height of the subtree at n.
+template<typename Key, typename Value>
+int TreeVerifier<Key, Value>::up(const NodeType* n, int depth, int leftHeight, int rightHeight,
+                                 VerifyReport<Key, Value>& report) const
+{
+    if(leftHeight < 0 || rightHeight < 0){
+      return -1;
+    }
+    int height = std::max(leftHeight, rightHeight) + 1;
+    int diff = rightHeight - leftHeight;
+    if(kind_ == AVL_BALANCE){
+      int balance = static_cast<const AVLNode<Key, Value>*>(n)->getBalance();
+      if(balance != diff || diff < -1 || diff > 1){
+        report.add(VERIFY_BALANCE, n, NULL, depth, diff, balance);
+      }
+    }
+    else if(kind_ == BST_HEIGHTS){
+      const BSTNode<Key, Value>* b = static_cast<const BSTNode<Key, Value>*>(n);
+      bool unbalanced = std::abs(diff) > 1;
+      if(b->getHeight() != height || b->isUnbalanced() != unbalanced){
+        report.add(VERIFY_HEIGHT, n, NULL, depth, height, b->getHeight());
+      }
+    }
+    return height;
+}
+
+// HELPER: min() and max() must be the ends of the left and right spines.
+// Only run on a tree without link errors, where the spines are finite.
+template<typename Key, typename Value>
+void TreeVerifier<Key, Value>::checkExtremes(const BinarySearchTree<Key, Value>& tree, VerifyReport<Key, Value>& report)
+{
+    if(report.kindCounts[VERIFY_PARENT] != 0){
+      return;
+    }
+    const NodeType* leftmost = tree.getRoot();
+    const NodeType* rightmost = tree.getRoot();
+    while(leftmost != NULL && leftmost->getLeft() != NULL){
+      leftmost = leftmost->getLeft();
+    }
+    while(rightmost != NULL && rightmost->getRight() != NULL){
+      rightmost = rightmost->getRight();
+    }
+    typename BinarySearchTree<Key, Value>::iterator min = tree.min();
+    typename BinarySearchTree<Key, Value>::iterator max = tree.max();
+    bool minOk = (leftmost == NULL) ? (min == tree.end()) : (min != tree.end() && &(*min) == &leftmost->getItem());
+    bool maxOk = (rightmost == NULL) ? (max == tree.end()) : (max != tree.end() && &(*max) == &rightmost->getItem());
+    if(!minOk){
+      report.add(VERIFY_EXTREMES, leftmost, NULL, 0, 0, 0);
+    }
+    if(!maxOk){
+      report.add(VERIFY_EXTREMES, rightmost, NULL, 0, 0, 1);
+    }
+}
+
+/*
+  ----------------------------------------------
+  End implementations for the TreeVerifier class.
+  ----------------------------------------------
+*/
+
+/**
+* Shorthand for TreeVerifier<Key, Value>::run.
+*/
+template <typename Key, typename Value>
+VerifyReport<Key, Value> verifyTree(const BinarySearchTree<Key, Value>& tree, unsigned threads = 0,
+                                    size_t expectedNodes = VERIFY_UNKNOWN_COUNT)
+{
+    return TreeVerifier<Key, Value>::run(tree, threads, expectedNodes);
+}
+
+#endif
@@ -0,0 +1,223 @@
+#ifndef TREEWALK_H
+#define TREEWALK_H
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <unordered_map>
+#include <algorithm>
+#include <cstddef>
+
+// Subtrees handed out per thread, so uneven subtrees even out
+#define TREEWALK_TASKS_PER_THREAD 8
+// Deepest level the top of the tree is split at, which bounds the serial
+// part on long chains
+#define TREEWALK_SPLIT_LEVELS 24
+
+/**
+* A post-order walk of a whole binary tree shared out between threads,
+* for the tools that inspect every node in one pass (ShapeAnalyzer,
+* TreeVerifier). The top levels are visited breadth-first on the calling
+* thread until there are enough subtrees; threads take those off a shared
+* list and walk each with an explicit stack, into per-thread reports that
+* are merged at the end; then the top nodes are finished bottom-up, once
+* the heights of the subtrees below them are known.
+*
+* What happens at each node is up to the Visitor, which provides:
+*   - NodeType; Context, what a node passes down to its children; and
+*     Report, default constructible with merge(const Report&);
+*   - left(n) and right(n), the children of n;
+*   - down(n, context, depth, report, enterLeft, enterRight), which
+*     visits n on the way down and says which children to walk into;
+*   - childContext(n, context, right), the context for a child of n;
+*   - up(n, depth, leftHeight, rightHeight, report), which visits n on
+*     the way up and returns its height. An empty subtree has height 0,
+*     one that was not walked into -1.
+* All threads share the visitor, so these must be const.
+*/
+template <typename Visitor>
+class ParallelTreeWalk
+{
+public:
+    typedef typename Visitor::NodeType NodeType;
+    typedef typename Visitor::Context Context;
+    typedef typename Visitor::Report Report;
+
+    // threads == 0 uses one thread per core; returns the root's height
+    static int run(const Visitor& visitor, const NodeType* root, const Context& context, unsigned threads,
+                   Report& report);
+
+private:
+    struct Task
+    {
+        const NodeType* node;
+        Context context;
+        int depth;
+        int height;
+        // which children were walked into, for the top nodes
+        bool enterLeft;
+        bool enterRight;
+    };
+
+    struct Frame
+    {
+        const NodeType* node;
+        Context context;
+        int depth;
+        int leftHeight;
+        int stage;
+        bool enterLeft;
+        bool enterRight;
+    };
+
+    static int walk(const Visitor& visitor, const Task& task, Report& report, std::vector<Frame>& stack);
+    static void work(const Visitor* visitor, std::vector<Task>* tasks, std::atomic<size_t>* next, Report* report);
+};
+
+/*
+  ---------------------------------------------------
+  Begin implementations for the ParallelTreeWalk class.
+  ---------------------------------------------------
+*/
+
+/**
+* Walks the tree under root with up to threads threads, adding what the
+* visitor finds to report.
+*/
+template<typename Visitor>
+int ParallelTreeWalk<Visitor>::run(const Visitor& visitor, const NodeType* root, const Context& context,
+                                   unsigned threads, Report& report)
+{
+    if(root == NULL){
+      return 0;
+    }
+    if(threads == 0){
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    Task first = { root, context, 0, 0, false, false };
+    if(threads == 1){
+      std::vector<Frame> stack;
+      return walk(visitor, first, report, stack);
+    }
+
+    // split the top levels breadth-first until there are enough subtrees
+    std::vector<Task> top;
+    std::vector<Task> frontier(1, first);
+    size_t target = (size_t)threads * TREEWALK_TASKS_PER_THREAD;
+    for(int level = 0; level < TREEWALK_SPLIT_LEVELS && !frontier.empty() && frontier.size() < target; level++){
+      std::vector<Task> next;
+      for(size_t i = 0; i < frontier.size(); i++){
+        Task t = frontier[i];
+        visitor.down(t.node, t.context, t.depth, report, t.enterLeft, t.enterRight);
+        top.push_back(t);
+        if(t.enterLeft){
+          Task child = { visitor.left(t.node), visitor.childContext(t.node, t.context, false), t.depth + 1, 0, false, false };
+          next.push_back(child);
+        }
+        if(t.enterRight){
+          Task child = { visitor.right(t.node), visitor.childContext(t.node, t.context, true), t.depth + 1, 0, false, false };
+          next.push_back(child);
+        }
+      }
+      frontier.swap(next);
+    }
+
+    // walk the subtrees below the split in parallel
+    size_t workers = std::min((size_t)threads, frontier.size());
+    std::vector<Report> partial(workers);
+    std::atomic<size_t> nextTask(0);
+    std::vector<std::thread> pool;
+    for(size_t w = 1; w < workers; w++){
+      pool.push_back(std::thread(&ParallelTreeWalk<Visitor>::work, &visitor, &frontier, &nextTask, &partial[w]));
+    }
+    if(workers > 0){
+      work(&visitor, &frontier, &nextTask, &partial[0]);
+    }
+    for(size_t w = 0; w < pool.size(); w++){
+      pool[w].join();
+    }
+    for(size_t w = 0; w < workers; w++){
+      report.merge(partial[w]);
+    }
+
+    // finish the top nodes bottom-up, now that the subtree heights are known
+    std::unordered_map<const NodeType*, int> heights;
+    for(size_t i = 0; i < frontier.size(); i++){
+      heights[frontier[i].node] = frontier[i].height;
+    }
+    for(size_t i = top.size(); i-- > 0; ){
+      const NodeType* l = visitor.left(top[i].node);
+      const NodeType* r = visitor.right(top[i].node);
+      int lh = (l == NULL) ? 0 : (top[i].enterLeft ? heights[l] : -1);
+      int rh = (r == NULL) ? 0 : (top[i].enterRight ? heights[r] : -1);
+      heights[top[i].node] = visitor.up(top[i].node, top[i].depth, lh, rh, report);
+    }
+    return heights[root];
+}
+
+/**
+* Post-order walk of the subtree in task with an explicit stack. Returns
+* the height up() gives its root.
+*/
+template<typename Visitor>
+int ParallelTreeWalk<Visitor>::walk(const Visitor& visitor, const Task& task, Report& report,
+                                    std::vector<Frame>& stack)
+{
+    Frame start = { task.node, task.context, task.depth, 0, 0, false, false };
+    stack.push_back(start);
+    // height of the subtree finished last
+    int last = 0;
+
+    while(!stack.empty()){
+      Frame& f = stack.back();
+      if(f.stage == 0){
+        visitor.down(f.node, f.context, f.depth, report, f.enterLeft, f.enterRight);
+        f.stage = 1;
+        const NodeType* l = visitor.left(f.node);
+        if(f.enterLeft){
+          Frame child = { l, visitor.childContext(f.node, f.context, false), f.depth + 1, 0, 0, false, false };
+          stack.push_back(child);
+          continue;
+        }
+        last = (l == NULL) ? 0 : -1;
+      }
+      if(f.stage == 1){
+        f.leftHeight = last;
+        f.stage = 2;
+        const NodeType* r = visitor.right(f.node);
+        if(f.enterRight){
+          Frame child = { r, visitor.childContext(f.node, f.context, true), f.depth + 1, 0, 0, false, false };
+          stack.push_back(child);
+          continue;
+        }
+        last = (r == NULL) ? 0 : -1;
+      }
+      last = visitor.up(f.node, f.depth, f.leftHeight, last, report);
+      stack.pop_back();
+    }
+    return last;
+}
+
+// HELPER: thread body, takes subtrees off the shared list until it is empty
+template<typename Visitor>
+void ParallelTreeWalk<Visitor>::work(const Visitor* visitor, std::vector<Task>* tasks, std::atomic<size_t>* next,
+                                     Report* report)
+{
+    std::vector<Frame> stack;
+    while(true){
+      size_t i = next->fetch_add(1);
+      if(i >= tasks->size()){
+        return;
+      }
+      Task& t = (*tasks)[i];
+      t.height = walk(*visitor, t, *report, stack);
+    }
+}
+
+/*
+  -------------------------------------------------
+  End implementations for the ParallelTreeWalk class.
+  -------------------------------------------------
+*/
+
+#endif